@@ -0,0 +1,39 @@
+//
+//  DHAACAudioFilePlayer.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioFilePlayer.h"
+
+/**
+ * Player for the raw ADTS streams of `DHAACAudioRecorder`;
+ * The stream is indexed from its ADTS headers when the data is set, without decoding, so duration is exact at once; Packets are decoded while playing, and seeking decodes from the byte offset the index gives for the packet 2 packets before the new position;
+ * The 2112 priming frames of AudioToolbox's encoder at the start of the stream are dropped, so the first frame played is the first frame that was recorded; ADTS does not carry the priming, streams of another encoder keep the rest of theirs;
+ * A streaming player is not indexed, its ADTS packets are decoded as they are appended;
+ */
+@interface DHAACAudioFilePlayer : DHAudioFilePlayer
+
+/**
+ * Number of ADTS packets in the stream;
+ */
+@property (nonatomic, readonly) NSUInteger numberOfPackets;
+
+/**
+ * Number of PCM frames in the stream, without the priming; The duration is `numberOfFrames / sampleRate`;
+ */
+@property (nonatomic, readonly) UInt64 numberOfFrames;
+
+/**
+ * The packet that is playing at `time`;
+ */
+- (NSUInteger) packetIndexForTime:(NSTimeInterval)time;
+
+/**
+ * Byte offset of the packet that is playing at `time`, where decoding starts for a seek to `time` without pre-roll;
+ */
+- (UInt64) byteOffsetForTime:(NSTimeInterval)time;
+
+@end
@@ -0,0 +1,186 @@
+//
+//  DHAACAudioFilePlayer.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAACAudioFilePlayer.h"
+#import "DHADTSUtilities.h"
+#import "DHAudioStreamDecoder.h"
+#import "DHPCMFormatConverter.h"
+
+static const UInt64 kAACEncoderDelay = 2112;        //priming of AudioToolbox's AAC encoder, the default backend of `DHAACAudioConverter`
+static const size_t kADTSPreRollPackets = 2;        //the decoder needs the packet before for the overlap of the transform
+static const size_t kADTSPacketsPerRead = 16;
+
+//Owns an index that is never changed once built, so the main queue and the stream queue can both read the one they hold while a new one replaces it
+@interface DHADTSPacketIndexHolder : NSObject {
+    DHADTSPacketIndex packetIndex;
+}
+- (instancetype) initWithData:(NSData *)data;
+- (const DHADTSPacketIndex *) packetIndex;
+@end
+
+@implementation DHADTSPacketIndexHolder
+
+- (instancetype) initWithData:(NSData *)data
+{
+    self = [super init];
+    if (self) {
+        if (!DHADTSPacketIndexBuild(&packetIndex, [data bytes], [data length])) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    DHADTSPacketIndexDestroy(&packetIndex);
+}
+
+- (const DHADTSPacketIndex *) packetIndex
+{
+    return &packetIndex;
+}
+
+@end
+
+@interface DHAACAudioFilePlayer ()
+@property (atomic, strong) DHADTSPacketIndexHolder *indexHolder;
+@property (nonatomic, strong) NSData *adtsData;
+@property (nonatomic, strong) DHAudioStreamDecoder *packetDecoder;
+@property (nonatomic) size_t nextPacket;
+@property (nonatomic) UInt64 numberOfFramesToSkip;      //pre-roll and priming left to drop after a seek
+@property (atomic) UInt64 numberOfPrimingFrames;
+@end
+
+@implementation DHAACAudioFilePlayer
+
+#pragma mark - Preparation
+- (void) setupPlayerWithFile:(NSString *)filePath
+{
+    [self setupPlayerWithADTSData:[[self class] mappedDataWithContentsOfFile:filePath]];
+}
+
+- (void) setupPlayerWithData:(NSData *)data
+{
+    [self setupPlayerWithADTSData:data];
+}
+
+/**
+ * Only the ADTS headers are read, nothing is decoded until playback; Packets are decoded while playing from the byte offsets of the index;
+ */
+- (void) setupPlayerWithADTSData:(NSData *)data
+{
+    DHADTSPacketIndexHolder *holder = [[DHADTSPacketIndexHolder alloc] initWithData:data];
+    if (holder == nil) {
+        [self failPreparingWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"No ADTS frame found in data"}]];
+        return;
+    }
+    [self updatePreparationProgress:0.5];
+    const DHADTSPacketIndex *index = [holder packetIndex];
+    //Channel configuration 7 is 7.1
+    UInt32 numberOfChannels = index->channelConfiguration == 7 ? 8 : (UInt32)index->channelConfiguration;
+    AudioStreamBasicDescription format = [DHPCMFormatConverter signed16BitFormatWithSampleRate:index->sampleRate
+                                                                              numberOfChannels:numberOfChannels];
+    UInt64 numberOfFrames = DHADTSPacketIndexNumberOfFrames(index);
+    //The decoder is not running once the engine is reset, so what it reads can be replaced
+    [self resetPlaybackEngine];
+    self.adtsData = data;
+    self.indexHolder = holder;
+    self.numberOfPrimingFrames = MIN(kAACEncoderDelay, numberOfFrames);
+    [self setupPlaybackEngineWithFormat:format numberOfFrames:numberOfFrames - self.numberOfPrimingFrames];
+}
+
+- (AudioFileTypeID) streamingFileType
+{
+    return kAudioFileAAC_ADTSType;
+}
+
+#pragma mark - Packet Index
+- (NSUInteger) numberOfPackets
+{
+    DHADTSPacketIndexHolder *holder = self.indexHolder;
+    return holder ? [holder packetIndex]->numberOfPackets : 0;
+}
+
+- (UInt64) numberOfFrames
+{
+    DHADTSPacketIndexHolder *holder = self.indexHolder;
+    if (holder == nil) {
+        return 0;
+    }
+    return DHADTSPacketIndexNumberOfFrames([holder packetIndex]) - self.numberOfPrimingFrames;
+}
+
+- (NSUInteger) packetIndexForTime:(NSTimeInterval)time
+{
+    DHADTSPacketIndexHolder *holder = self.indexHolder;
+    if (holder == nil) {
+        return 0;
+    }
+    const DHADTSPacketIndex *index = [holder packetIndex];
+    UInt64 frame = (UInt64)(MAX(time, 0) * index->sampleRate) + self.numberOfPrimingFrames;
+    return DHADTSPacketIndexPacketForFrame(index, frame);
+}
+
+- (UInt64) byteOffsetForTime:(NSTimeInterval)time
+{
+    DHADTSPacketIndexHolder *holder = self.indexHolder;
+    if (holder == nil) {
+        return 0;
+    }
+    return DHADTSPacketIndexOffsetOfPacket([holder packetIndex], [self packetIndexForTime:time]);
+}
+
+#pragma mark - Decoding While Playing
+- (NSData *) nextPCMData
+{
+    const DHADTSPacketIndex *index = [self.indexHolder packetIndex];
+    const uint8_t *bytes = [self.adtsData bytes];
+    while (index && self.nextPacket < index->numberOfPackets) {
+        size_t endPacket = MIN(self.nextPacket + kADTSPacketsPerRead, index->numberOfPackets);
+        uint64_t begin = DHADTSPacketIndexOffsetOfPacket(index, self.nextPacket);
+        uint64_t end = DHADTSPacketIndexOffsetOfPacket(index, endPacket);
+        self.nextPacket = endPacket;
+        //Not copied, the decoder parses the bytes before it returns
+        NSData *packets = [NSData dataWithBytesNoCopy:(void *)(bytes + begin) length:(NSUInteger)(end - begin) freeWhenDone:NO];
+        NSData *pcmData = [self.packetDecoder decodeData:packets];
+        if (pcmData == nil) {
+            return nil;
+        }
+        UInt32 bytesPerFrame = self.pcmFormat.mBytesPerFrame;
+        UInt64 numberOfFrames = [pcmData length] / bytesPerFrame;
+        UInt64 numberOfFramesToSkip = MIN(self.numberOfFramesToSkip, numberOfFrames);
+        self.numberOfFramesToSkip -= numberOfFramesToSkip;
+        if (numberOfFramesToSkip < numberOfFrames) {
+            return [pcmData subdataWithRange:NSMakeRange((NSUInteger)(numberOfFramesToSkip * bytesPerFrame), (NSUInteger)((numberOfFrames - numberOfFramesToSkip) * bytesPerFrame))];
+        }
+    }
+    return [NSData data];
+}
+
+/**
+ * Start decoding at the byte offset of the packet 2 packets before `frame`, so the decoder has the overlap by the time it gets there, and drop what comes before;
+ * `frame` counts from the end of the priming;
+ */
+- (void) seekToFrame:(UInt64)frame
+{
+    const DHADTSPacketIndex *index = [self.indexHolder packetIndex];
+    if (index == NULL) {
+        return;
+    }
+    UInt64 streamFrame = frame + self.numberOfPrimingFrames;
+    size_t packet = DHADTSPacketIndexPacketForFrame(index, streamFrame);
+    packet = packet > kADTSPreRollPackets ? packet - kADTSPreRollPackets : 0;
+    //A new parser, as the bytes before the offset are not fed
+    self.packetDecoder = [[DHAudioStreamDecoder alloc] initWithFileType:kAudioFileAAC_ADTSType];
+    self.nextPacket = packet;
+    UInt64 packetFrame = (UInt64)packet * index->framesPerPacket;
+    self.numberOfFramesToSkip = streamFrame > packetFrame ? streamFrame - packetFrame : 0;
+}
+
+@end
@@ -34,6 +34,9 @@ typedef NS_ENUM (NSInteger, DHAudioPlayerStatus) {
 - (void) audioPlayerDecodeErrorDidOccur:(DHAudioFilePlayer *)player
                                   error:(NSError *)error;
 
+- (void) audioFilePlayer:(DHAudioFilePlayer *)audioPlayer
+didUpdatePreparationProgress:(float)progress;
+
 - (void) audioFilePlayer:(DHAudioFilePlayer *)audioPlayer
       didPauseDueToEvent:(DHAudioPauseEvent)event;
 
@@ -47,7 +50,9 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
 /**
  * DHAudioFilePlayer is a base class for audio file player; 
  * It uses AVAudioPlayer to enpower the audio play, so if the data is not supported by AVAudioPlayer, you need to subclass this class and do the decode yourself;
- * DHAudioFilePlayer supports only the type of data that is fully downloaded, and not incrementally adding data;
+ * Fully downloaded data is set with `filePath` or `data`; Data that is still downloading can be streamed: create the player with `initForStreamingWithAudioFormat:packetDuration:delegate:` and hand it every piece with `appendData:`;
+ * A streaming player queues each piece as it arrives and decodes it to PCM once the AudioQueue has room for it, starting as soon as `preBufferDuration` is buffered;
+ * Preparing the data, i.e. converting it and creating the AVAudioPlayer or indexing it, runs inside the initializer, or on `preparationQueue` when the player is created with one, e.g. while a list scrolls;
  */
 @interface DHAudioFilePlayer : NSObject
 /**
@@ -67,6 +72,13 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
  */
 @property (nonatomic) float volume;
 
+/**
+ * Playback speed, the pitch is kept; Between 0.5-3, default value is 1;
+ * Players that play through the playback engine time-stretch the decoded PCM as it is rendered (see `DHTimeStretch`), so a new rate is heard within one output buffer; Others use AVAudioPlayer's rate;
+ * `currentTime` and `duration` stay in the time of the audio;
+ */
+@property (nonatomic) float rate;
+
 /**
  * Packet duration;
  * Opus format will need this value to play the audio correctly;
@@ -88,6 +100,35 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
  */
 @property (nonatomic, weak) id<DHAudioFilePlayerDelegate> delegate;
 
+/**
+ * The queue on which the delegate is told about readiness, progress, decode errors and the end of the engine's playback;
+ * Default value is dispatch_get_main_queue()
+ */
+@property (nonatomic, strong) dispatch_queue_t delegateQueue;
+
+/**
+ * The queue the data is prepared on, nil to prepare inside the initializer; Set with the initializer;
+ * While it prepares, the status is `DHAudioPlayerStatusConvertingData`; A `play` in the meantime makes it `DHAudioPlayerStatusWaitingForData` and starts playback once the player is ready;
+ * The status changes and the waiting `play` happen on the main queue;
+ */
+@property (nonatomic, strong, readonly) dispatch_queue_t preparationQueue;
+
+/**
+ * Between 0 and 1, reported to the delegate as it advances; 1 once the player is ready;
+ */
+@property (nonatomic, readonly) float preparationProgress;
+
+/**
+ * Whether the player was created with `initForStreamingWithAudioFormat:packetDuration:delegate:`;
+ */
+@property (nonatomic, readonly) BOOL isStreaming;
+
+/**
+ * Streaming only: decoded audio that has to be buffered before playback starts, and again after the data ran out; Default value is 0.5 seconds;
+ * Set it before the first `appendData:`;
+ */
+@property (nonatomic) NSTimeInterval preBufferDuration;
+
 /**
  * Convenience Initializer
  * @param filePath the file path for the audio to play
@@ -132,6 +173,77 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
                   audioFormat:(AudioStreamBasicDescription)audioFormat
                      delegate:(id<DHAudioFilePlayerDelegate>)delegate;
 
+/**
+ * Initializer
+ * @param filePath the file path for the audio to play
+ * @param packetDuration the packetDuration for opus format
+ * @param audioFormat the audio format for the audio
+ * @param delegate the delegate
+ * @param delegateQueue the queue on which the delegate is running, nil for the main queue
+ * @param preparationQueue the queue to prepare the data on, nil to prepare inside the initializer
+ */
+- (instancetype) initWithFilePath:(NSString *) filePath
+                   packetDuration:(NSTimeInterval)packetDuration
+                      audioFormat:(AudioStreamBasicDescription)audioFormat
+                         delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                    delegateQueue:(dispatch_queue_t)delegateQueue
+                 preparationQueue:(dispatch_queue_t)preparationQueue;
+
+/**
+ * Initializer
+ * @param data the audio data to play
+ * @param packetDuration the packetDuration for opus format
+ * @param audioFormat the audio format for the audio
+ * @param delegate the delegate
+ * @param delegateQueue the queue on which the delegate is running, nil for the main queue
+ * @param preparationQueue the queue to prepare the data on, nil to prepare inside the initializer
+ */
+- (instancetype) initWithData:(NSData *) data
+               packetDuration:(NSTimeInterval)packetDuration
+                  audioFormat:(AudioStreamBasicDescription)audioFormat
+                     delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                delegateQueue:(dispatch_queue_t)delegateQueue
+             preparationQueue:(dispatch_queue_t)preparationQueue;
+
+/**
+ * Initializer for streaming; Nothing is decoded until `appendData:`;
+ * @param audioFormat the audio format for the audio
+ * @param packetDuration the packetDuration for opus format
+ * @param delegate the delegate, `audioPlayerIsReadyToPlay:` is called once the pre-buffer is filled
+ */
+- (instancetype) initForStreamingWithAudioFormat:(AudioStreamBasicDescription)audioFormat
+                                  packetDuration:(NSTimeInterval)packetDuration
+                                        delegate:(id<DHAudioFilePlayerDelegate>)delegate;
+
+/**
+ * Streaming only: append the next piece of the audio data, in the same encoding as `data` would be; It can be split anywhere;
+ * Decoding happens in the background, `play` can be called before any data arrived;
+ */
+- (void) appendData:(NSData *)data;
+
+/**
+ * Streaming only: all the data was appended; Playback runs to the end of what was buffered, then `audioPlayerDidFinishPlaying:successfully:` is called;
+ */
+- (void) finishAppendingData;
+
+/**
+ * Stop a preparation that has not finished; The status goes back to `DHAudioPlayerStatusInitialized` and the delegate is not told about the preparation anymore;
+ * Work that already started runs to its end, but is dropped; A player that is released before its turn on `preparationQueue` is not prepared at all;
+ */
+- (void) cancelPreparation;
+
+/**
+ * Give the player to `delegate`, e.g. a player that was prepared ahead with nobody listening (see `DHAudioFilePlayerFactory`'s prefetching); Takes effect on the main queue;
+ * If the player is ready to play already, `audioPlayerIsReadyToPlay:` is called once more for the new delegate, so it is told exactly once either way;
+ * @param delegateQueue nil for the main queue
+ */
+- (void) handOverToDelegate:(id<DHAudioFilePlayerDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue;
+
+/**
+ * Bytes the player holds in memory: its data, the data handed to AVAudioPlayer (mapped files included, their pages stay once read) and the playback engine's buffers;
+ */
+@property (nonatomic, readonly) NSUInteger memoryFootprint;
+
 /**
  * Start playing
  */
@@ -153,27 +265,108 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
 - (void) stop;
 
 /**
- * Duration of the audio file;
+ * Duration of the audio file; While streaming, duration of the audio decoded so far;
  */
 - (NSTimeInterval) duration;
 
 /**
- * Set current playing time;
+ * Set current playing time; Not supported while streaming;
+ * Players that decode while playing (see `setupPlaybackEngineWithFormat:numberOfFrames:`) seek by decoding from the new position;
  */
 - (void)setCurrentTime:(NSTimeInterval)currentTime;
 
+#pragma mark - Position
+
+/**
+ * The position that is heard now, in frames and in seconds;
+ * Players that play through the playback engine count the frames that went through the AudioQueue against its timeline (see `DHPlaybackClock`), so pauses, seeks, buffering and the output latency are accounted for to the frame; Others ask AVAudioPlayer;
+ * A streaming player counts from the start of the stream;
+ */
+- (UInt64) currentFrame;
+- (NSTimeInterval) currentTime;
+
+#pragma mark - Scrubbing
+
+/**
+ * Whether the player is between `beginScrubbing` and `endScrubbing`;
+ */
+@property (atomic, readonly) BOOL isScrubbing;
+
+/**
+ * Scrub, e.g. while a slider is dragged: every `scrubToTime:` plays a short grain (60 ms, faded in and out) at the target, at normal speed, once the previous grain played out, so the target is heard at once however fast it moves;
+ * `endScrubbing` continues playing from the last target if the player was playing, otherwise it stays there; `currentTime` is the last target meanwhile;
+ * Only players that decode while playing scrub, others just seek on `scrubToTime:`;
+ */
+- (void) beginScrubbing;
+- (void) scrubToTime:(NSTimeInterval)time;
+- (void) endScrubbing;
+
 #pragma mark - For Data that could not be played directly
 
 /**
  * If the audio data could not be played by AVAudioPlayer, like Opus, you need to override `setupPlayerWithFile` or `setupPlayerWithData`,decode the data in one of these two methods, and call `updateWithPlayableData` when the data is fully decoded.
+ * Both run on `preparationQueue` when there is one, do not touch UI from them;
  */
 - (void) setupPlayerWithFile:(NSString *)filePath;
 - (void) setupPlayerWithData:(NSData *)data;
 - (void) updateWithPlayableData:(NSData *)playableData;
 
+/**
+ * `update` runs on the main queue together with the player's own, when the preparation finishes and was not cancelled or replaced; State that is read on the main queue, like an index built while decoding, is published there rather than written from `preparationQueue`;
+ */
+- (void) updateWithPlayableData:(NSData *)playableData update:(void (^)(void))update;
+
+/**
+ * Subclasses report how far the preparation got, and end a failed one with `failPreparingWithError:` instead of calling the delegate, so the status and `delegateQueue` are respected;
+ */
+- (void) updatePreparationProgress:(float)progress;
+- (void) failPreparingWithError:(NSError *)error;
+
 /**
  * If the data needs to be decoded synchronously, update the data by calling this method when decode is done.
  */
 - (NSData *) playableDataWithData:(NSData *)data;
 
+/**
+ * The contents of `filePath` mapped into memory instead of read, see `DHMappedFile.h`; Pages are only loaded as the decoder touches them, so the file's size does not matter;
+ * `setupPlayerWithFile:` reads files with it, subclasses that decode files themselves should too; Returns nil if the file can not be opened;
+ */
++ (NSData *) mappedDataWithContentsOfFile:(NSString *)filePath;
+
+#pragma mark - For Streaming Data
+
+/**
+ * A streaming player calls these instead of the methods above, in order and on its own serial queue;
+ * `pcmDataWithAppendedData:` decodes one appended piece and returns its PCM, empty if no packet is complete yet, or nil on error; `streamingPCMFormat` is the Linear PCM format of that PCM, asked once the first PCM is returned;
+ * The default implementations decode `streamingFileType` (MP3) with AudioFileStream and AudioConverter, to 16-bit samples;
+ */
+- (NSData *) pcmDataWithAppendedData:(NSData *)data;
+- (AudioStreamBasicDescription) streamingPCMFormat;
+- (AudioFileTypeID) streamingFileType;
+
+#pragma mark - For Data that is decoded while playing
+
+/**
+ * Subclasses that can decode from any position, e.g. through a packet index, can play through the playback engine instead of AVAudioPlayer: nothing is decoded ahead, so the player is ready at once and seeking only decodes from the new position;
+ * Call `setupPlaybackEngineWithFormat:numberOfFrames:` from `setupPlayerWithFile:`/`setupPlayerWithData:` once the data is indexed, with the Linear PCM format and length of the decoded audio; `resetPlaybackEngine` drops a previous setup, call it before replacing what the hooks read from;
+ * `nextPCMData` returns the next decoded PCM, empty at the end or nil on error; `seekToFrame:` positions the decoder so `nextPCMData` continues at `frame`; Both are called on the player's serial stream queue;
+ */
+- (void) setupPlaybackEngineWithFormat:(AudioStreamBasicDescription)format
+                        numberOfFrames:(UInt64)numberOfFrames;
+
+/**
+ * Whether the player was set up with `setupPlaybackEngineWithFormat:numberOfFrames:`; Only such players can be items of a `DHQueueAudioFilePlayer`;
+ */
+@property (nonatomic, readonly) BOOL decodesWhilePlaying;
+
+/**
+ * The Linear PCM format and length of the decoded audio, as passed to `setupPlaybackEngineWithFormat:numberOfFrames:`; A streaming player has a `pcmFormat` once its first PCM is decoded;
+ */
+@property (nonatomic, readonly) AudioStreamBasicDescription pcmFormat;
+@property (nonatomic, readonly) UInt64 numberOfPlayableFrames;
+
+- (void) resetPlaybackEngine;
+- (NSData *) nextPCMData;
+- (void) seekToFrame:(UInt64)frame;
+
 @end
@@ -8,11 +8,56 @@
 
 #import "DHAudioFilePlayer.h"
 #import <AVFoundation/AVFoundation.h>
+#import "DHAudioQueueOutput.h"
+#import "DHAudioStreamDecoder.h"
+#import "DHAudioRingBuffer.h"
+#import "DHMappedFile.h"
+#import "DHPlaybackEngine.h"
 
-@interface DHAudioFilePlayer ()<AVAudioPlayerDelegate>
+static const NSTimeInterval kDefaultPreBufferDuration = 0.5;
+static const NSTimeInterval kMinimumStreamBufferDuration = 2;
+static const NSTimeInterval kSeekDecodeDuration = 0.2;       //decoded before the output (re)starts, more than its three buffers, so it does not start on silence
+static const NSTimeInterval kScrubGrainDuration = 0.06;
+static const NSTimeInterval kScrubFadeDuration = 0.005;
+
+#define STREAM_FEED_CHUNK_SIZE 16384
+
+//The generation of the setup running on this thread, 0 outside of one, see `prepareWithSetup:`
+static __thread NSUInteger currentPreparationGeneration = 0;
+
+@interface DHAudioFilePlayer ()<AVAudioPlayerDelegate, DHAudioQueueOutputDelegate> {
+    DHPlaybackEngine engine;
+    DHAudioRingBuffer pendingPCM;       //decoded PCM waiting for room in the engine
+}
 @property (nonatomic, strong) AVAudioPlayer *player;
-@property (nonatomic) NSTimeInterval startPlayingTime;
 @property (nonatomic) NSTimeInterval interruptedTime;
+
+//Preparation
+@property (nonatomic, strong, readwrite) dispatch_queue_t preparationQueue;
+@property (atomic) NSUInteger preparationGeneration;       //bumped by every preparation and cancellation
+@property (atomic, readwrite) float preparationProgress;
+
+//Streaming
+@property (nonatomic, readwrite) BOOL isStreaming;
+@property (nonatomic, strong) dispatch_queue_t streamQ;
+@property (nonatomic, strong) DHAudioQueueOutput *output;
+@property (nonatomic, strong) DHAudioStreamDecoder *streamDecoder;
+@property (nonatomic, readwrite) AudioStreamBasicDescription pcmFormat;
+@property (atomic) BOOL engineIsSetUp;
+@property (atomic) UInt64 numberOfBytesDecoded;
+@property (nonatomic) BOOL inputFinished;
+@property (nonatomic, strong) NSMutableArray<NSData *> *pendingInput;     //appended data waiting to be decoded, only used on streamQ
+@property (nonatomic) BOOL reportedReadyToPlay;
+
+//Decoding while playing, see `setupPlaybackEngineWithFormat:numberOfFrames:`
+@property (nonatomic) BOOL usesPlaybackEngine;
+@property (nonatomic) BOOL pullsPCMData;
+@property (nonatomic, readwrite) UInt64 numberOfPlayableFrames;
+
+//Scrubbing
+@property (atomic, readwrite) BOOL isScrubbing;
+@property (atomic) UInt64 scrubFrame;           //the latest target
+@property (nonatomic) UInt64 scrubbedFrame;     //the target of the last grain, only used on streamQ
 @end
 
 @implementation DHAudioFilePlayer
@@ -31,6 +76,21 @@
                    packetDuration:(NSTimeInterval)packetDuration
                       audioFormat:(AudioStreamBasicDescription)audioFormat
                          delegate:(id<DHAudioFilePlayerDelegate>)delegate
+{
+    return [self initWithFilePath:filePath
+                   packetDuration:packetDuration
+                      audioFormat:audioFormat
+                         delegate:delegate
+                    delegateQueue:nil
+                 preparationQueue:nil];
+}
+
+- (instancetype) initWithFilePath:(NSString *)filePath
+                   packetDuration:(NSTimeInterval)packetDuration
+                      audioFormat:(AudioStreamBasicDescription)audioFormat
+                         delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                    delegateQueue:(dispatch_queue_t)delegateQueue
+                 preparationQueue:(dispatch_queue_t)preparationQueue
 {
     self = [super init];
     if (self) {
@@ -39,7 +99,15 @@
         _packetDuration = packetDuration;
         _status = DHAudioPlayerStatusInitialized;
         _delegate = delegate;
-        [self setupPlayerWithFile:filePath];
+        _delegateQueue = delegateQueue;
+        _preparationQueue = preparationQueue;
+        _volume = 1;
+        _rate = 1;
+        _preBufferDuration = kDefaultPreBufferDuration;
+        _streamQ = dispatch_queue_create("Audio Stream Queue", NULL);
+        [self prepareWithSetup:^(DHAudioFilePlayer *player) {
+            [player setupPlayerWithFile:filePath];
+        }];
     }
     return self;
 }
@@ -58,6 +126,21 @@
                packetDuration:(NSTimeInterval)packetDuration
                   audioFormat:(AudioStreamBasicDescription)audioFormat
                      delegate:(id<DHAudioFilePlayerDelegate>)delegate
+{
+    return [self initWithData:data
+               packetDuration:packetDuration
+                  audioFormat:audioFormat
+                     delegate:delegate
+                delegateQueue:nil
+             preparationQueue:nil];
+}
+
+- (instancetype) initWithData:(NSData *)data
+               packetDuration:(NSTimeInterval)packetDuration
+                  audioFormat:(AudioStreamBasicDescription)audioFormat
+                     delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                delegateQueue:(dispatch_queue_t)delegateQueue
+             preparationQueue:(dispatch_queue_t)preparationQueue
 {
     self = [super init];
     if (self) {
@@ -66,65 +149,615 @@
         _packetDuration = packetDuration;
         _status = DHAudioPlayerStatusInitialized;
         _delegate = delegate;
-        [self setupPlayerWithData:data];
+        _delegateQueue = delegateQueue;
+        _preparationQueue = preparationQueue;
+        _volume = 1;
+        _rate = 1;
+        _preBufferDuration = kDefaultPreBufferDuration;
+        _streamQ = dispatch_queue_create("Audio Stream Queue", NULL);
+        [self prepareWithSetup:^(DHAudioFilePlayer *player) {
+            [player setupPlayerWithData:data];
+        }];
+    }
+    return self;
+}
+
+- (instancetype) initForStreamingWithAudioFormat:(AudioStreamBasicDescription)audioFormat
+                                  packetDuration:(NSTimeInterval)packetDuration
+                                        delegate:(id<DHAudioFilePlayerDelegate>)delegate
+{
+    self = [super init];
+    if (self) {
+        _audioFormat = audioFormat;
+        _packetDuration = packetDuration;
+        _status = DHAudioPlayerStatusInitialized;
+        _delegate = delegate;
+        _volume = 1;
+        _rate = 1;
+        _isStreaming = YES;
+        _usesPlaybackEngine = YES;
+        _pendingInput = [NSMutableArray array];
+        _preBufferDuration = kDefaultPreBufferDuration;
+        _streamQ = dispatch_queue_create("Audio Stream Queue", NULL);
     }
     return self;
 }
 
+- (void) dealloc
+{
+    //The output pulls from the engine, stop it before the engine goes away
+    [_output stop];
+    DHPlaybackEngineDestroy(&engine);
+    DHAudioRingBufferDestroy(&pendingPCM);
+}
+
 - (void) setFilePath:(NSString *)filePath
 {
     _filePath = filePath;
-    [self setupPlayerWithFile:filePath];
+    [self prepareWithSetup:^(DHAudioFilePlayer *player) {
+        [player setupPlayerWithFile:filePath];
+    }];
+}
+
+- (dispatch_queue_t) delegateQueue
+{
+    if (_delegateQueue == nil) {
+        _delegateQueue = dispatch_get_main_queue();
+    }
+    return _delegateQueue;
 }
 
 - (void) setupPlayerWithFile:(NSString *) filePath
 {
-    NSData *data = [NSData dataWithContentsOfFile:filePath];
-    _status = DHAudioPlayerStatusConvertingData;
+    NSData *data = [[self class] mappedDataWithContentsOfFile:filePath];
     [self updateWithPlayableData:[self playableDataWithData:data]];
-    _status = DHAudioPlayerStatusReadyToPlay;
 }
 
 - (void) setupPlayerWithData:(NSData *) data
 {
-    _status = DHAudioPlayerStatusConvertingData;
     [self updateWithPlayableData:[self playableDataWithData:data]];
-    _status = DHAudioPlayerStatusReadyToPlay;
 }
 
 - (void) updateWithPlayableData:(NSData *)data
 {
+    [self updateWithPlayableData:data update:nil];
+}
+
+- (void) updateWithPlayableData:(NSData *)data update:(void (^)(void))update
+{
+    [self updatePreparationProgress:0.5];
     NSError *error;
-    self.player = [[AVAudioPlayer alloc] initWithData:data error:&error];
+    AVAudioPlayer *player = [[AVAudioPlayer alloc] initWithData:data error:&error];
     if (error) {
-        if ([self.delegate respondsToSelector:@selector(audioPlayerDecodeErrorDidOccur:error:)]) {
-            [self.delegate audioPlayerDecodeErrorDidOccur:self error:error];
+        [self failPreparingWithError:error];
+        return;
+    }
+    player.delegate = self;
+    //The rate can only be enabled before preparing
+    player.enableRate = YES;
+    [player prepareToPlay];
+    [self finishPreparingWithUpdate:^{
+        self.player = player;
+        self.player.volume = self.volume;
+        self.player.rate = self.rate;
+        if (update) {
+            update();
         }
+    }];
+}
+
+- (NSData *) playableDataWithData:(NSData *)data
+{
+    return data;
+}
+
++ (NSData *) mappedDataWithContentsOfFile:(NSString *)filePath
+{
+    DHMappedFile file;
+    if (filePath == nil || !DHMappedFileOpen(&file, [filePath fileSystemRepresentation], DHMappedFileAccessSequential)) {
+        return nil;
+    }
+    if (file.length == 0) {
+        return [NSData data];
+    }
+    return [[NSData alloc] initWithBytesNoCopy:(void *)file.bytes length:file.length deallocator:^(void *bytes, NSUInteger length) {
+        DHMappedFile mappedFile = file;
+        DHMappedFileClose(&mappedFile);
+    }];
+}
+
+#pragma mark - Preparation
+//Run `setup` now, or on `preparationQueue`; `setup` ends with `finishPreparingWithUpdate:` or `failPreparingWithError:`
+//Every preparation gets a generation of its own; What a setup reports is dropped once a newer preparation or a cancellation replaced it, so an older setup that finishes last can not win
+- (void) prepareWithSetup:(void (^)(DHAudioFilePlayer *player))setup
+{
+    NSUInteger generation = ++self.preparationGeneration;
+    self.preparationProgress = 0;
+    if (self.status != DHAudioPlayerStatusWaitingForData) {
+        self.status = DHAudioPlayerStatusConvertingData;
+    }
+    if (self.preparationQueue == nil) {
+        [self runPreparationSetup:setup generation:generation];
         return;
     }
-    self.player.delegate = self;
-    [self.player prepareToPlay];
-    if ([self.delegate respondsToSelector:@selector(audioPlayerIsReadyToPlay:)]) {
-        [self.delegate audioPlayerIsReadyToPlay:self];
+    //A player that is released or cancelled before its turn, e.g. by a cell that scrolled away, is not prepared at all
+    __weak DHAudioFilePlayer *weakSelf = self;
+    dispatch_async(self.preparationQueue, ^{
+        DHAudioFilePlayer *player = weakSelf;
+        if (player == nil || player.preparationGeneration != generation) {
+            return;
+        }
+        [player runPreparationSetup:setup generation:generation];
+    });
+}
+
+- (void) runPreparationSetup:(void (^)(DHAudioFilePlayer *player))setup generation:(NSUInteger)generation
+{
+    //Setups run synchronously, what they report on this thread belongs to `generation`
+    NSUInteger outerGeneration = currentPreparationGeneration;
+    currentPreparationGeneration = generation;
+    setup(self);
+    currentPreparationGeneration = outerGeneration;
+}
+
+//The generation that what is reported now belongs to: the running setup's, else the latest
+- (NSUInteger) reportingPreparationGeneration
+{
+    return currentPreparationGeneration != 0 ? currentPreparationGeneration : self.preparationGeneration;
+}
+
+//Runs `block` now when preparing inside the initializer, else on the main queue where the actions run; Dropped once cancelled or replaced
+- (void) performPreparationBlock:(void (^)(void))block
+{
+    if (self.preparationQueue == nil) {
+        block();
+        return;
+    }
+    NSUInteger generation = [self reportingPreparationGeneration];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (self.preparationGeneration == generation) {
+            block();
+        }
+    });
+}
+
+- (void) finishPreparingWithUpdate:(void (^)(void))update
+{
+    [self performPreparationBlock:^{
+        if (update) {
+            update();
+        }
+        BOOL waitingForData = self.status == DHAudioPlayerStatusWaitingForData;
+        if (waitingForData || self.status == DHAudioPlayerStatusConvertingData) {
+            self.status = DHAudioPlayerStatusReadyToPlay;
+        }
+        [self updatePreparationProgress:1];
+        //Whoever is the delegate now is told, see `handOverToDelegate:delegateQueue:`
+        id<DHAudioFilePlayerDelegate> delegate = self.delegate;
+        dispatch_async(self.delegateQueue, ^{
+            if ([delegate respondsToSelector:@selector(audioPlayerIsReadyToPlay:)]) {
+                [delegate audioPlayerIsReadyToPlay:self];
+            }
+        });
+        if (waitingForData) {
+            [self play];
+        }
+    }];
+}
+
+- (void) failPreparingWithError:(NSError *)error
+{
+    [self performPreparationBlock:^{
+        self.status = DHAudioPlayerStatusStopped;
+        dispatch_async(self.delegateQueue, ^{
+            if ([self.delegate respondsToSelector:@selector(audioPlayerDecodeErrorDidOccur:error:)]) {
+                [self.delegate audioPlayerDecodeErrorDidOccur:self error:error];
+            }
+        });
+    }];
+}
+
+- (void) updatePreparationProgress:(float)progress
+{
+    if ([self reportingPreparationGeneration] != self.preparationGeneration || progress <= self.preparationProgress) {
+        return;
     }
-    if (self.status == DHAudioPlayerStatusWaitingForData) {
-        self.status = DHAudioPlayerStatusReadyToPlay;
-        [self play];
+    self.preparationProgress = MIN(progress, 1);
+    dispatch_async(self.delegateQueue, ^{
+        if ([self.delegate respondsToSelector:@selector(audioFilePlayer:didUpdatePreparationProgress:)]) {
+            [self.delegate audioFilePlayer:self didUpdatePreparationProgress:progress];
+        }
+    });
+}
+
+- (void) handOverToDelegate:(id<DHAudioFilePlayerDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue
+{
+    void (^handOver)(void) = ^{
+        self.delegate = delegate;
+        self.delegateQueue = delegateQueue;
+        //Runs on the main queue like `finishPreparingWithUpdate:`, so the readiness is either told here or there
+        if (self.status == DHAudioPlayerStatusReadyToPlay) {
+            dispatch_async(self.delegateQueue, ^{
+                if ([delegate respondsToSelector:@selector(audioPlayerIsReadyToPlay:)]) {
+                    [delegate audioPlayerIsReadyToPlay:self];
+                }
+            });
+        }
+    };
+    if ([NSThread isMainThread]) {
+        handOver();
+    } else {
+        dispatch_async(dispatch_get_main_queue(), handOver);
     }
 }
 
-- (NSData *) playableDataWithData:(NSData *)data
+- (NSUInteger) memoryFootprint
 {
-    return data;
+    NSData *playerData = self.player.data;
+    NSUInteger footprint = [playerData length];
+    if (self.data != playerData) {
+        footprint += [self.data length];
+    }
+    if (self.engineIsSetUp) {
+        footprint += engine.capacity * engine.bytesPerFrame + pendingPCM.capacity;
+    }
+    return footprint;
+}
+
+- (void) cancelPreparation
+{
+    if (self.status != DHAudioPlayerStatusConvertingData && !(self.status == DHAudioPlayerStatusWaitingForData && !self.isStreaming)) {
+        return;
+    }
+    self.preparationGeneration++;
+    self.status = DHAudioPlayerStatusInitialized;
+}
+
+#pragma mark - Streaming
+- (void) appendData:(NSData *)data
+{
+    if (!self.isStreaming || [data length] == 0) {
+        return;
+    }
+    NSData *appendedData = [data copy];
+    dispatch_async(self.streamQ, ^{
+        if (self.inputFinished) {
+            return;
+        }
+        //Kept as it came, it is decoded once the engine has room for it, so a long stream does not pile up as PCM
+        [self.pendingInput addObject:appendedData];
+        [self feedEngine];
+    });
+}
+
+- (void) finishAppendingData
+{
+    if (!self.isStreaming) {
+        return;
+    }
+    dispatch_async(self.streamQ, ^{
+        if (self.inputFinished) {
+            return;
+        }
+        self.inputFinished = YES;
+        [self feedEngine];
+        if (!self.engineIsSetUp) {
+            [self reportDecodeErrorWithMessage:@"No audio was decoded from the appended data"];
+        }
+    });
+}
+
+- (NSData *) pcmDataWithAppendedData:(NSData *)data
+{
+    return [self.streamDecoder decodeData:data];
+}
+
+- (AudioStreamBasicDescription) streamingPCMFormat
+{
+    return self.streamDecoder.outputFormat;
+}
+
+- (AudioFileTypeID) streamingFileType
+{
+    return kAudioFileMP3Type;
+}
+
+- (DHAudioStreamDecoder *) streamDecoder
+{
+    if (!_streamDecoder) {
+        _streamDecoder = [[DHAudioStreamDecoder alloc] initWithFileType:[self streamingFileType]];
+    }
+    return _streamDecoder;
+}
+
+//Called on streamQ; Decodes the oldest appended piece into `pendingPCM`, the first PCM sets the engine up
+//Returns NO if nothing was waiting
+- (BOOL) decodeNextAppendedData
+{
+    if ([self.pendingInput count] == 0) {
+        return NO;
+    }
+    NSData *appendedData = [self.pendingInput firstObject];
+    [self.pendingInput removeObjectAtIndex:0];
+    NSData *pcmData = [self pcmDataWithAppendedData:appendedData];
+    if (pcmData == nil) {
+        [self reportDecodeErrorWithMessage:@"Error while decoding appended data"];
+        return YES;
+    }
+    [self enqueuePCMData:pcmData];
+    return YES;
+}
+
+//Called on streamQ
+- (void) enqueuePCMData:(NSData *)pcmData
+{
+    if ([pcmData length] == 0) {
+        return;
+    }
+    if (!self.engineIsSetUp && ![self setupEngineWithFormat:[self streamingPCMFormat] preBufferDuration:self.preBufferDuration]) {
+        self.inputFinished = YES;
+        [self.pendingInput removeAllObjects];
+        [self reportDecodeErrorWithMessage:@"Error while setting up playback engine"];
+        return;
+    }
+    if (DHAudioRingBufferWrite(&pendingPCM, [pcmData bytes], [pcmData length]) != [pcmData length]) {
+        [self reportDecodeErrorWithMessage:@"Error while buffering decoded data"];
+        return;
+    }
+    self.numberOfBytesDecoded += [pcmData length];
+}
+
+- (BOOL) setupEngineWithFormat:(AudioStreamBasicDescription)format preBufferDuration:(NSTimeInterval)preBufferDuration
+{
+    if (format.mFormatID != kAudioFormatLinearPCM || format.mBytesPerFrame == 0 || format.mSampleRate <= 0) {
+        return NO;
+    }
+    size_t preBufferFrames = (size_t)(format.mSampleRate * MAX(preBufferDuration, 0));
+    size_t capacity = MAX(preBufferFrames * 2, (size_t)(format.mSampleRate * kMinimumStreamBufferDuration));
+    if (!DHPlaybackEngineInit(&engine, format.mBytesPerFrame, capacity, preBufferFrames) ||
+        !DHAudioRingBufferInit(&pendingPCM, 0)) {
+        return NO;
+    }
+    //Without a time stretch for the format the engine keeps playing at rate 1
+    BOOL isFloat = (format.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+    if (DHPlaybackEngineSetupTimeStretch(&engine, format.mChannelsPerFrame, isFloat, format.mSampleRate)) {
+        DHPlaybackEngineSetRate(&engine, self.rate);
+    }
+    self.pcmFormat = format;
+    self.engineIsSetUp = YES;
+    if (self.isStreaming) {
+        //A player that decodes while playing starts a waiting `play` when its preparation finishes
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (self.status == DHAudioPlayerStatusWaitingForData) {
+                [self play];
+            }
+        });
+    }
+    return YES;
+}
+
+//Called on streamQ
+- (void) feedEngine
+{
+    //The engine takes the format of the first PCM, decode until there is some
+    while (!self.engineIsSetUp) {
+        if (![self decodeNextAppendedData]) {
+            break;
+        }
+    }
+    if (self.isScrubbing) {
+        [self feedScrubGrain];
+        return;
+    }
+    [self feedEngineUpToNumberOfFrames:SIZE_MAX];
+}
+
+//Called on streamQ; Moves whole frames from `pendingPCM` into the engine until it is full or holds `numberOfBufferedFrames`, decoding more on the way from the player's PCM or the appended data
+//Only one piece is decoded ahead of the engine, so the PCM held stays within the engine's capacity and one piece, however long the stream is
+- (void) feedEngineUpToNumberOfFrames:(size_t)numberOfBufferedFrames
+{
+    if (!self.engineIsSetUp) {
+        return;
+    }
+    uint8_t chunk[STREAM_FEED_CHUNK_SIZE];
+    size_t bytesPerFrame = engine.bytesPerFrame;
+    while (DHPlaybackEngineAvailableFrames(&engine) > 0 && DHPlaybackEngineBufferedFrames(&engine) < numberOfBufferedFrames) {
+        if (pendingPCM.length < bytesPerFrame && self.pullsPCMData && !self.inputFinished) {
+            NSData *pcmData = [self nextPCMData];
+            if (pcmData == nil) {
+                [self reportDecodeErrorWithMessage:@"Error while decoding data"];
+            }
+            if ([pcmData length] == 0) {
+                self.inputFinished = YES;
+            } else {
+                DHAudioRingBufferWrite(&pendingPCM, [pcmData bytes], [pcmData length]);
+            }
+            continue;
+        }
+        if (pendingPCM.length < bytesPerFrame && [self decodeNextAppendedData]) {
+            continue;
+        }
+        size_t numberOfFrames = MIN(DHPlaybackEngineAvailableFrames(&engine), pendingPCM.length / bytesPerFrame);
+        numberOfFrames = MIN(numberOfFrames, numberOfBufferedFrames - DHPlaybackEngineBufferedFrames(&engine));
+        numberOfFrames = MIN(numberOfFrames, STREAM_FEED_CHUNK_SIZE / bytesPerFrame);
+        if (numberOfFrames == 0) {
+            break;
+        }
+        DHAudioRingBufferRead(&pendingPCM, chunk, numberOfFrames * bytesPerFrame);
+        DHPlaybackEngineWrite(&engine, chunk, numberOfFrames);
+    }
+    BOOL finished = self.inputFinished && pendingPCM.length < bytesPerFrame && [self.pendingInput count] == 0;
+    if (finished) {
+        DHPlaybackEngineFinish(&engine);
+    }
+    if (!self.reportedReadyToPlay && (finished || DHPlaybackEngineBufferedFrames(&engine) >= engine.preBufferFrames)) {
+        self.reportedReadyToPlay = YES;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (self.status == DHAudioPlayerStatusInitialized) {
+                self.status = DHAudioPlayerStatusReadyToPlay;
+            }
+        });
+        dispatch_async(self.delegateQueue, ^{
+            if ([self.delegate respondsToSelector:@selector(audioPlayerIsReadyToPlay:)]) {
+                [self.delegate audioPlayerIsReadyToPlay:self];
+            }
+        });
+    }
+}
+
+- (void) playStream
+{
+    if (!self.engineIsSetUp) {
+        self.status = DHAudioPlayerStatusWaitingForData;
+        return;
+    }
+    if (![self startOutput]) {
+        return;
+    }
+    [self addInterruptionObservers];
+    self.status = DHAudioPlayerStatusPlaying;
+}
+
+- (BOOL) startOutput
+{
+    if (!self.output) {
+        self.output = [[DHAudioQueueOutput alloc] initWithEngine:&engine format:self.pcmFormat delegate:self];
+        self.output.volume = self.volume;
+    }
+    if (![self.output start]) {
+        [self reportDecodeErrorWithMessage:@"Error while starting audio queue"];
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Decoding While Playing
+- (void) setupPlaybackEngineWithFormat:(AudioStreamBasicDescription)format
+                        numberOfFrames:(UInt64)numberOfFrames
+{
+    [self resetPlaybackEngine];
+    __block BOOL isSetUp = NO;
+    dispatch_sync(self.streamQ, ^{
+        self.usesPlaybackEngine = YES;
+        self.pullsPCMData = YES;
+        self.numberOfPlayableFrames = numberOfFrames;
+        self.reportedReadyToPlay = YES;
+        //Decoding is local, so there is no pre-buffer to wait for
+        isSetUp = [self setupEngineWithFormat:format preBufferDuration:0];
+        if (isSetUp) {
+            [self seekToFrame:0];
+            [self feedEngineUpToNumberOfFrames:(size_t)(format.mSampleRate * kSeekDecodeDuration)];
+        }
+    });
+    if (!isSetUp) {
+        [self failPreparingWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"Error while setting up playback engine"}]];
+        return;
+    }
+    //The rest is decoded once the output pulls, so a player that is never played costs no more than this
+    [self finishPreparingWithUpdate:nil];
+}
+
+- (void) resetPlaybackEngine
+{
+    [self.output stop];
+    self.output = nil;
+    dispatch_sync(self.streamQ, ^{
+        DHPlaybackEngineDestroy(&engine);
+        DHAudioRingBufferDestroy(&pendingPCM);
+        self.engineIsSetUp = NO;
+        self.inputFinished = NO;
+        self.numberOfBytesDecoded = 0;
+    });
+}
+
+- (BOOL) decodesWhilePlaying
+{
+    return self.pullsPCMData;
+}
+
+- (NSData *) nextPCMData
+{
+    return [NSData data];
+}
+
+- (void) seekToFrame:(UInt64)frame
+{
+}
+
+- (void) seekPlaybackEngineToFrame:(UInt64)frame
+{
+    [self seekPlaybackEngineToFrame:frame restartsOutput:self.status == DHAudioPlayerStatusPlaying];
+}
+
+//`restartsOutput` NO leaves the output stopped at `frame`, e.g. for `stop`, which repositions before it changes the status
+- (void) seekPlaybackEngineToFrame:(UInt64)frame restartsOutput:(BOOL)restartsOutput
+{
+    if (!self.engineIsSetUp) {
+        return;
+    }
+    frame = MIN(frame, self.numberOfPlayableFrames);
+    //Both sides of the engine have to be idle to reset it: the output is stopped, and the decoder is not running on streamQ
+    [self.output stop];
+    dispatch_sync(self.streamQ, ^{
+        DHPlaybackEngineReset(&engine, frame);
+        DHAudioRingBufferReset(&pendingPCM);
+        self.inputFinished = NO;
+        [self seekToFrame:frame];
+        //Faster playback goes through the decoded frames faster
+        [self feedEngineUpToNumberOfFrames:(size_t)(self.pcmFormat.mSampleRate * kSeekDecodeDuration * MAX(self.rate, 1))];
+    });
+    dispatch_async(self.streamQ, ^{
+        [self feedEngine];
+    });
+    if (restartsOutput) {
+        [self.output start];
+    }
+}
+
+- (void) reportDecodeErrorWithMessage:(NSString *)message
+{
+    NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : message}];
+    dispatch_async(self.delegateQueue, ^{
+        if ([self.delegate respondsToSelector:@selector(audioPlayerDecodeErrorDidOccur:error:)]) {
+            [self.delegate audioPlayerDecodeErrorDidOccur:self error:error];
+        }
+    });
+}
+
+#pragma mark - DHAudioQueueOutputDelegate
+- (void) audioQueueOutputDidRenderBuffer:(DHAudioQueueOutput *)output
+{
+    dispatch_async(self.streamQ, ^{
+        [self feedEngine];
+    });
+}
+
+- (void) audioQueueOutputDidFinishPlaying:(DHAudioQueueOutput *)output
+{
+    [self.output stop];
+    self.status = DHAudioPlayerStatusStopped;
+    [self removeObserver];
+    if (self.pullsPCMData) {
+        //Like AVAudioPlayer, play again from the start
+        [self seekPlaybackEngineToFrame:0];
+    }
+    dispatch_async(self.delegateQueue, ^{
+        if ([self.delegate respondsToSelector:@selector(audioPlayerDidFinishPlaying:successfully:)]) {
+            [self.delegate audioPlayerDidFinishPlaying:self successfully:YES];
+        }
+    });
 }
 
 #pragma mark - Actions
 - (void) play
 {
-    if (self.status != DHAudioPlayerStatusConvertingData) {
+    if (self.usesPlaybackEngine) {
+        [self playStream];
+        return;
+    }
+    if (self.status != DHAudioPlayerStatusConvertingData && self.status != DHAudioPlayerStatusWaitingForData) {
         [self addInterruptionObservers];
         [self.player play];
-        self.startPlayingTime = CACurrentMediaTime();
         self.status = DHAudioPlayerStatusPlaying;
     } else {
         self.status = DHAudioPlayerStatusWaitingForData;
@@ -142,13 +775,27 @@
 
 - (void) pausePlayer
 {
-    [self.player pause];
+    if (self.usesPlaybackEngine) {
+        [self.output pause];
+    } else {
+        [self.player pause];
+    }
     self.status = DHAudioPlayerStatusPaused;
 }
 
 - (void) stop
 {
-    [self.player stop];
+    [self endScrubbingRestartingOutput:NO];
+    if (self.pullsPCMData) {
+        //What was rendered but not heard yet is dropped with the AudioQueue, decode it again
+        UInt64 frame = [self currentFrame];
+        [self.output stop];
+        [self seekPlaybackEngineToFrame:frame restartsOutput:NO];
+    } else if (self.usesPlaybackEngine) {
+        [self.output stop];
+    } else {
+        [self.player stop];
+    }
     self.status = DHAudioPlayerStatusStopped;
     [self removeObserver];
 }
@@ -164,7 +811,11 @@
 
 - (void) resumePlayer
 {
-    [self.player play];
+    if (self.usesPlaybackEngine) {
+        [self.output start];
+    } else {
+        [self.player play];
+    }
     self.status = DHAudioPlayerStatusPlaying;
 }
 
@@ -183,18 +834,159 @@
 {
     _volume = volume;
     [self.player setVolume:volume];
+    [self.output setVolume:volume];
+}
+
+- (void) setRate:(float)rate
+{
+    _rate = MIN(MAX(rate, DHTIMESTRETCH_MINIMUM_RATE), DHTIMESTRETCH_MAXIMUM_RATE);
+    [self.player setRate:_rate];
+    //Grains are played at the normal speed while scrubbing, `endScrubbing` applies the rate
+    if (self.engineIsSetUp && !self.isScrubbing) {
+        DHPlaybackEngineSetRate(&engine, _rate);
+    }
 }
 
 - (NSTimeInterval) duration
 {
+    if (self.pullsPCMData) {
+        return (NSTimeInterval)self.numberOfPlayableFrames / self.pcmFormat.mSampleRate;
+    }
+    if (self.isStreaming) {
+        if (!self.engineIsSetUp) {
+            return 0;
+        }
+        AudioStreamBasicDescription format = self.pcmFormat;
+        return (NSTimeInterval)(self.numberOfBytesDecoded / format.mBytesPerFrame) / format.mSampleRate;
+    }
     return [self.player duration];
 }
 
 - (void) setCurrentTime:(NSTimeInterval)currentTime
 {
+    if (self.isScrubbing) {
+        [self scrubToTime:currentTime];
+        return;
+    }
+    if (self.pullsPCMData) {
+        [self seekPlaybackEngineToFrame:(UInt64)(MAX(currentTime, 0) * self.pcmFormat.mSampleRate)];
+        return;
+    }
+    if (self.isStreaming) {
+        return;
+    }
     [self.player setCurrentTime:currentTime];
 }
 
+#pragma mark - Position
+- (UInt64) currentFrame
+{
+    if (!self.usesPlaybackEngine) {
+        return (UInt64)(MAX([self.player currentTime], 0) * self.player.format.sampleRate);
+    }
+    if (self.isScrubbing) {
+        return self.scrubFrame;
+    }
+    UInt64 frame;
+    if ([self.output getCurrentFrame:&frame]) {
+        return frame;
+    }
+    if (!self.engineIsSetUp) {
+        return 0;
+    }
+    //No AudioQueue, so nothing was heard since the engine was reset at the position
+    return DHPlaybackEngineRenderPosition(&engine);
+}
+
+- (NSTimeInterval) currentTime
+{
+    if (!self.usesPlaybackEngine) {
+        return [self.player currentTime];
+    }
+    if (!self.engineIsSetUp) {
+        return 0;
+    }
+    return (NSTimeInterval)[self currentFrame] / self.pcmFormat.mSampleRate;
+}
+
+#pragma mark - Scrubbing
+- (void) beginScrubbing
+{
+    if (!self.pullsPCMData || !self.engineIsSetUp || self.isScrubbing) {
+        return;
+    }
+    UInt64 frame = [self currentFrame];
+    [self.output stop];
+    dispatch_sync(self.streamQ, ^{
+        //Grains are written into the empty engine one by one, the normal feed stays out of it
+        DHPlaybackEngineReset(&engine, frame);
+        DHAudioRingBufferReset(&pendingPCM);
+        self.inputFinished = NO;
+        self.scrubFrame = frame;
+        self.scrubbedFrame = frame;
+        DHPlaybackEngineSetRate(&engine, 1);
+        self.isScrubbing = YES;
+    });
+    [self startOutput];
+}
+
+- (void) scrubToTime:(NSTimeInterval)time
+{
+    if (!self.isScrubbing) {
+        [self setCurrentTime:time];
+        return;
+    }
+    self.scrubFrame = MIN((UInt64)(MAX(time, 0) * self.pcmFormat.mSampleRate), self.numberOfPlayableFrames);
+    dispatch_async(self.streamQ, ^{
+        [self feedScrubGrain];
+    });
+}
+
+- (void) endScrubbing
+{
+    [self endScrubbingRestartingOutput:self.status == DHAudioPlayerStatusPlaying];
+}
+
+- (void) endScrubbingRestartingOutput:(BOOL)restartsOutput
+{
+    if (!self.isScrubbing) {
+        return;
+    }
+    dispatch_sync(self.streamQ, ^{
+        self.isScrubbing = NO;
+        DHPlaybackEngineSetRate(&engine, self.rate);
+    });
+    //Playback continues from the last target if it was playing, else the output stays stopped there
+    [self seekPlaybackEngineToFrame:self.scrubFrame restartsOutput:restartsOutput];
+}
+
+//Called on streamQ; Once the last grain played out, play one at the latest target, so fast moves are heard as a series of short snippets rather than queuing up
+- (void) feedScrubGrain
+{
+    UInt64 frame = self.scrubFrame;
+    if (frame == self.scrubbedFrame || DHPlaybackEngineBufferedFrames(&engine) > 0) {
+        return;
+    }
+    self.scrubbedFrame = frame;
+    AudioStreamBasicDescription format = self.pcmFormat;
+    NSUInteger length = (NSUInteger)(format.mSampleRate * kScrubGrainDuration) * format.mBytesPerFrame;
+    NSMutableData *grain = [NSMutableData dataWithCapacity:length];
+    [self seekToFrame:frame];
+    while ([grain length] < length) {
+        NSData *pcmData = [self nextPCMData];
+        if ([pcmData length] == 0) {
+            break;
+        }
+        [grain appendData:pcmData];
+    }
+    size_t numberOfFrames = MIN([grain length], length) / format.mBytesPerFrame;
+    BOOL isFloat = (format.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+    if ((isFloat && format.mBitsPerChannel == 32) || (!isFloat && format.mBitsPerChannel == 16)) {
+        DHPlaybackGrainApplyEnvelope([grain mutableBytes], numberOfFrames, format.mChannelsPerFrame, isFloat, (size_t)(format.mSampleRate * kScrubFadeDuration));
+    }
+    DHPlaybackEngineWrite(&engine, [grain bytes], numberOfFrames);
+}
+
 #pragma mark - AVAudioPlayerDelegate
 - (void) audioPlayerDidFinishPlaying:(AVAudioPlayer *)player successfully:(BOOL)flag
 {
@@ -217,7 +1009,7 @@
     
     if ([interruptionType intValue] == AVAudioSessionInterruptionTypeBegan) {
         [self pausePlayer];
-        self.interruptedTime = CACurrentMediaTime() - self.startPlayingTime;
+        self.interruptedTime = [self currentTime];
         if ([self.delegate respondsToSelector:@selector(audioFilePlayer:didPauseDueToEvent:)]) {
             [self.delegate audioFilePlayer:self didPauseDueToEvent:DHAudioPauseEventInterruption];
         }
@@ -10,6 +10,39 @@
 #import "DHAudioFilePlayer.h"
 #import "DHAudioAttributes.h"
 
+typedef NS_ENUM(NSInteger, DHAudioPrefetchPriority) {
+    DHAudioPrefetchPriorityLow,
+    DHAudioPrefetchPriorityNormal,
+    DHAudioPrefetchPriorityHigh,
+};
+
+/**
+ * Audio that is likely to be played soon, see `prefetchItems:`;
+ * Set either `filePath` or `data`, as for the player;
+ */
+@interface DHAudioPrefetchItem : NSObject
+
++ (instancetype) itemWithAudioType:(DHAudioType)audioType
+                          filePath:(NSString *)filePath
+                       audioFormat:(AudioStreamBasicDescription)audioFormat
+                    packetDuration:(NSTimeInterval)packetDuration
+                          priority:(DHAudioPrefetchPriority)priority;
+
++ (instancetype) itemWithAudioType:(DHAudioType)audioType
+                              data:(NSData *)data
+                       audioFormat:(AudioStreamBasicDescription)audioFormat
+                    packetDuration:(NSTimeInterval)packetDuration
+                          priority:(DHAudioPrefetchPriority)priority;
+
+@property (nonatomic, readonly) DHAudioType audioType;
+@property (nonatomic, strong, readonly) NSString *filePath;
+@property (nonatomic, strong, readonly) NSData *data;
+@property (nonatomic, readonly) AudioStreamBasicDescription audioFormat;
+@property (nonatomic, readonly) NSTimeInterval packetDuration;
+@property (nonatomic, readonly) DHAudioPrefetchPriority priority;
+
+@end
+
 @interface DHAudioFilePlayerFactory : NSObject
 
 + (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
@@ -28,6 +61,17 @@
                                       delegate:(id<DHAudioFilePlayerDelegate>)delegate;
 
 
+/**
+ * A player that prepares `data` on `preparationQueue` instead of blocking the caller, see `preparationQueue`;
+ */
++ (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
+                                          data:(NSData *)data
+                                   audioFormat:(AudioStreamBasicDescription) audioFormat
+                                packetDuration:(NSTimeInterval)packetDuration
+                                      delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                 delegateQueue:(dispatch_queue_t)delegateQueue
+                              preparationQueue:(dispatch_queue_t)preparationQueue;
+
 + (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
                                       filePath:(NSString *)filePath
                                    audioFormat:(AudioStreamBasicDescription) audioFormat;
@@ -42,4 +86,50 @@
                                    audioFormat:(AudioStreamBasicDescription) audioFormat
                                 packetDuration:(NSTimeInterval)packetDuration
                                       delegate:(id<DHAudioFilePlayerDelegate>)delegate;
+
+/**
+ * A player that prepares the file on `preparationQueue` instead of blocking the caller, see `preparationQueue`;
+ */
++ (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
+                                      filePath:(NSString *)filePath
+                                   audioFormat:(AudioStreamBasicDescription) audioFormat
+                                packetDuration:(NSTimeInterval)packetDuration
+                                      delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                 delegateQueue:(dispatch_queue_t)delegateQueue
+                              preparationQueue:(dispatch_queue_t)preparationQueue;
+
+/**
+ * A player for data that is still arriving, see `appendData:`;
+ */
++ (DHAudioFilePlayer *) streamingFilePlayerForAudioType:(DHAudioType)audioType
+                                            audioFormat:(AudioStreamBasicDescription)audioFormat
+                                         packetDuration:(NSTimeInterval)packetDuration
+                                               delegate:(id<DHAudioFilePlayerDelegate>)delegate;
+
+#pragma mark - Prefetching
+
+/**
+ * Prepare players for `items` ahead of time, e.g. the next messages of a conversation thread, so playing one of them does not wait for decoding;
+ * Items are prepared one at a time on a background worker of utility QoS, higher `priority` first and in the order of `items` within a priority; Players that decode while playing are only indexed and decode their start, the rest is decoded as they play;
+ * The file player methods above hand out the prefetched player for the same type, `filePath` (or equal `data`), `audioFormat` and `packetDuration` instead of creating one, through `handOverToDelegate:delegateQueue:`, so it may be ready to play at once; A player is handed out once, and a player that failed to prepare is replaced by a new one, which reports the error; The methods without a `preparationQueue` only hand out a player that finished preparing, as they return prepared players;
+ * Every call replaces the list: items that are not in it anymore are not prefetched, and their players are the first to go when memory runs short;
+ */
++ (void) prefetchItems:(NSArray<DHAudioPrefetchItem *> *)items;
+
+/**
+ * Stop prefetching and release the prefetched players;
+ */
++ (void) cancelPrefetching;
+
+/**
+ * Bytes the prefetched players may hold, see `memoryFootprint`; Players of the lowest priority, last in the list, are released first to stay under it, and an item is not prefetched if only players it outranks could make room for it; Default value is 16 MB;
+ * Every prefetched player is released on a memory warning;
+ */
++ (void) setPrefetchMemoryBudget:(NSUInteger)prefetchMemoryBudget;
++ (NSUInteger) prefetchMemoryBudget;
+
+/**
+ * Bytes the prefetched players that were not handed out hold now;
+ */
++ (NSUInteger) prefetchMemoryUsage;
 @end
@@ -10,6 +10,403 @@
 #import "DHAudioFilePlayer.h"
 #import "DHPCMAudioFilePlayer.h"
 #import "DHOpusAudioFilePlayer.h"
+#import "DHAACAudioFilePlayer.h"
+#import <UIKit/UIKit.h>
+
+static const NSUInteger kDefaultPrefetchMemoryBudget = 16 * 1024 * 1024;
+
+@interface DHAudioFilePlayerFactory ()
++ (Class) playerClassForAudioType:(DHAudioType)audioType;
++ (DHAudioFilePlayer *) takePrefetchedPlayerForItem:(DHAudioPrefetchItem *)item
+                                           delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                      delegateQueue:(dispatch_queue_t)delegateQueue
+                                   preparationQueue:(dispatch_queue_t)preparationQueue;
+@end
+
+#pragma mark - DHAudioPrefetchItem
+@interface DHAudioPrefetchItem ()
+@property (nonatomic, readwrite) DHAudioType audioType;
+@property (nonatomic, strong, readwrite) NSString *filePath;
+@property (nonatomic, strong, readwrite) NSData *data;
+@property (nonatomic, readwrite) AudioStreamBasicDescription audioFormat;
+@property (nonatomic, readwrite) NSTimeInterval packetDuration;
+@property (nonatomic, readwrite) DHAudioPrefetchPriority priority;
+- (BOOL) matchesItem:(DHAudioPrefetchItem *)item;
+@end
+
+@implementation DHAudioPrefetchItem
+
++ (instancetype) itemWithAudioType:(DHAudioType)audioType
+                          filePath:(NSString *)filePath
+                       audioFormat:(AudioStreamBasicDescription)audioFormat
+                    packetDuration:(NSTimeInterval)packetDuration
+                          priority:(DHAudioPrefetchPriority)priority
+{
+    DHAudioPrefetchItem *item = [[DHAudioPrefetchItem alloc] init];
+    item.audioType = audioType;
+    item.filePath = filePath;
+    item.audioFormat = audioFormat;
+    item.packetDuration = packetDuration;
+    item.priority = priority;
+    return item;
+}
+
++ (instancetype) itemWithAudioType:(DHAudioType)audioType
+                              data:(NSData *)data
+                       audioFormat:(AudioStreamBasicDescription)audioFormat
+                    packetDuration:(NSTimeInterval)packetDuration
+                          priority:(DHAudioPrefetchPriority)priority
+{
+    DHAudioPrefetchItem *item = [[DHAudioPrefetchItem alloc] init];
+    item.audioType = audioType;
+    item.data = data;
+    item.audioFormat = audioFormat;
+    item.packetDuration = packetDuration;
+    item.priority = priority;
+    return item;
+}
+
+//The same audio decoded the same way: a player prepared with another format or packet duration would play it differently
+- (BOOL) matchesItem:(DHAudioPrefetchItem *)item
+{
+    AudioStreamBasicDescription audioFormat = item.audioFormat;
+    AudioStreamBasicDescription ownAudioFormat = self.audioFormat;
+    if (item.audioType != self.audioType ||
+        item.packetDuration != self.packetDuration ||
+        memcmp(&audioFormat, &ownAudioFormat, sizeof(AudioStreamBasicDescription)) != 0) {
+        return NO;
+    }
+    if (item.filePath) {
+        return [item.filePath isEqualToString:self.filePath];
+    }
+    return item.data != nil && (item.data == self.data || [item.data isEqualToData:self.data]);
+}
+
+@end
+
+#pragma mark - DHAudioFilePlayerPrefetcher
+@interface DHPrefetchEntry : NSObject
+@property (nonatomic, strong) DHAudioPrefetchItem *item;
+@property (nonatomic) NSUInteger order;                     //position in the latest list, NSNotFound once it left it
+@property (nonatomic, strong) DHAudioFilePlayer *player;
+@property (nonatomic) NSUInteger estimatedFootprint;        //until the player knows its own
+@property (nonatomic) NSUInteger measuredFootprint;         //the player's `memoryFootprint` once prepared, 0 until then
+- (NSUInteger) footprint;
+- (NSComparisonResult) compareRank:(DHPrefetchEntry *)entry;
+@end
+
+@implementation DHPrefetchEntry
+
+//Both are only touched on stateQ, the player is not asked here as it changes on the main queue
+- (NSUInteger) footprint
+{
+    return MAX(self.estimatedFootprint, self.measuredFootprint);
+}
+
+//Ascending when `entry` ranks below
+- (NSComparisonResult) compareRank:(DHPrefetchEntry *)entry
+{
+    BOOL isListed = self.order != NSNotFound;
+    if (isListed != (entry.order != NSNotFound)) {
+        return isListed ? NSOrderedAscending : NSOrderedDescending;
+    }
+    if (self.item.priority != entry.item.priority) {
+        return self.item.priority > entry.item.priority ? NSOrderedAscending : NSOrderedDescending;
+    }
+    if (self.order != entry.order) {
+        return self.order < entry.order ? NSOrderedAscending : NSOrderedDescending;
+    }
+    return NSOrderedSame;
+}
+
+@end
+
+/**
+ * The state behind the factory's prefetching: entries waiting to be prefetched, highest rank first, and the prefetched ones; All of it is only touched on stateQ, the players prepare on workerQ;
+ */
+@interface DHAudioFilePlayerPrefetcher : NSObject
+@property (nonatomic, strong) dispatch_queue_t stateQ;
+@property (nonatomic, strong) dispatch_queue_t workerQ;
+@property (nonatomic, strong) NSMutableArray<DHPrefetchEntry *> *pendingEntries;
+@property (nonatomic, strong) NSMutableArray<DHPrefetchEntry *> *prefetchedEntries;
+@property (nonatomic) BOOL isWorking;
+@property (nonatomic) NSUInteger memoryBudget;
+@end
+
+@implementation DHAudioFilePlayerPrefetcher
+
++ (instancetype) sharedPrefetcher
+{
+    static DHAudioFilePlayerPrefetcher *sharedPrefetcher;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPrefetcher = [[DHAudioFilePlayerPrefetcher alloc] init];
+    });
+    return sharedPrefetcher;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self) {
+        _stateQ = dispatch_queue_create("Audio Prefetch State Queue", NULL);
+        _workerQ = dispatch_queue_create("Audio Prefetch Queue", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _pendingEntries = [NSMutableArray array];
+        _prefetchedEntries = [NSMutableArray array];
+        _memoryBudget = kDefaultPrefetchMemoryBudget;
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void) prefetchItems:(NSArray<DHAudioPrefetchItem *> *)items
+{
+    dispatch_sync(self.stateQ, ^{
+        for (DHPrefetchEntry *entry in self.prefetchedEntries) {
+            entry.order = NSNotFound;
+        }
+        NSMutableArray *pendingEntries = [NSMutableArray arrayWithCapacity:[items count]];
+        [items enumerateObjectsUsingBlock:^(DHAudioPrefetchItem *item, NSUInteger index, BOOL *stop) {
+            DHPrefetchEntry *entry = [self entryInEntries:self.prefetchedEntries matchingItem:item] ?: [self entryInEntries:pendingEntries matchingItem:item];
+            if (entry) {
+                //Prefetched already, or listed twice: it keeps its best rank
+                if (entry.order == NSNotFound || item.priority > entry.item.priority) {
+                    entry.order = index;
+                    entry.item = item;
+                }
+                return;
+            }
+            entry = [[DHPrefetchEntry alloc] init];
+            entry.item = item;
+            entry.order = index;
+            [pendingEntries addObject:entry];
+        }];
+        [pendingEntries sortUsingSelector:@selector(compareRank:)];
+        self.pendingEntries = pendingEntries;
+        [self evictToBudget:_memoryBudget];
+        [self startWorking];
+    });
+}
+
+//Called on stateQ
+- (DHPrefetchEntry *) entryInEntries:(NSArray<DHPrefetchEntry *> *)entries matchingItem:(DHAudioPrefetchItem *)item
+{
+    for (DHPrefetchEntry *entry in entries) {
+        if ([entry.item matchesItem:item]) {
+            return entry;
+        }
+    }
+    return nil;
+}
+
+- (void) cancelPrefetching
+{
+    dispatch_sync(self.stateQ, ^{
+        [self.pendingEntries removeAllObjects];
+        [self evictToBudget:0];
+    });
+}
+
+- (void) setMemoryBudget:(NSUInteger)memoryBudget
+{
+    dispatch_sync(self.stateQ, ^{
+        _memoryBudget = memoryBudget;
+        [self evictToBudget:memoryBudget];
+        [self startWorking];
+    });
+}
+
+- (NSUInteger) memoryBudget
+{
+    __block NSUInteger memoryBudget;
+    dispatch_sync(self.stateQ, ^{
+        memoryBudget = _memoryBudget;
+    });
+    return memoryBudget;
+}
+
+- (NSUInteger) memoryUsage
+{
+    __block NSUInteger memoryUsage;
+    dispatch_sync(self.stateQ, ^{
+        memoryUsage = [self prefetchedFootprint];
+    });
+    return memoryUsage;
+}
+
+- (DHAudioFilePlayer *) takePlayerForItem:(DHAudioPrefetchItem *)item
+{
+    __block DHAudioFilePlayer *player;
+    dispatch_sync(self.stateQ, ^{
+        NSPredicate *predicate = [NSPredicate predicateWithBlock:^BOOL(DHPrefetchEntry *entry, NSDictionary *bindings) {
+            return ![entry.item matchesItem:item];
+        }];
+        //The caller creates the player itself if it was not prefetched yet
+        [self.pendingEntries filterUsingPredicate:predicate];
+        for (DHPrefetchEntry *entry in self.prefetchedEntries) {
+            if ([entry.item matchesItem:item]) {
+                [self.prefetchedEntries removeObject:entry];
+                player = entry.player;
+                break;
+            }
+        }
+        [self startWorking];
+    });
+    return player;
+}
+
+#pragma mark - Worker
+//Called on stateQ
+- (void) startWorking
+{
+    if (self.isWorking || [self.pendingEntries count] == 0) {
+        return;
+    }
+    self.isWorking = YES;
+    dispatch_async(self.workerQ, ^{
+        [self prefetchNext];
+    });
+}
+
+//Called on workerQ; Creates the player for the entry of highest rank, whose preparation is queued right behind this block, then comes back after it
+- (void) prefetchNext
+{
+    __block DHPrefetchEntry *startedEntry = nil;
+    dispatch_sync(self.stateQ, ^{
+        while ([self.pendingEntries count] > 0) {
+            DHPrefetchEntry *entry = [self.pendingEntries firstObject];
+            NSUInteger footprint = [self estimatedFootprintOfItem:entry.item];
+            if (footprint > _memoryBudget) {
+                [self.pendingEntries removeObjectAtIndex:0];
+                continue;
+            }
+            if (![self makeRoom:footprint forEntry:entry]) {
+                break;
+            }
+            [self.pendingEntries removeObjectAtIndex:0];
+            entry.estimatedFootprint = footprint;
+            entry.player = [self playerForItem:entry.item];
+            if (entry.player == nil) {
+                continue;
+            }
+            [self.prefetchedEntries addObject:entry];
+            startedEntry = entry;
+            break;
+        }
+        if (startedEntry == nil) {
+            self.isWorking = NO;
+        }
+    });
+    if (startedEntry) {
+        DHAudioFilePlayer *player = startedEntry.player;
+        dispatch_async(self.workerQ, ^{
+            [self publishFootprintOfEntry:startedEntry player:player];
+            [self prefetchNext];
+        });
+    }
+}
+
+//Called on workerQ once the entry's setup ran; Its finish step is on the main queue already, so the footprint is measured there right behind it, and kept on stateQ
+- (void) publishFootprintOfEntry:(DHPrefetchEntry *)entry player:(DHAudioFilePlayer *)player
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSUInteger footprint = player.memoryFootprint;
+        dispatch_async(self.stateQ, ^{
+            entry.measuredFootprint = footprint;
+            //The estimate may have been short
+            [self evictToBudget:_memoryBudget];
+        });
+    });
+}
+
+- (DHAudioFilePlayer *) playerForItem:(DHAudioPrefetchItem *)item
+{
+    Class playerClass = [DHAudioFilePlayerFactory playerClassForAudioType:item.audioType];
+    //Nobody listens until it is handed out, see `handOverToDelegate:delegateQueue:`
+    if (item.filePath) {
+        return [[playerClass alloc] initWithFilePath:item.filePath
+                                      packetDuration:item.packetDuration
+                                         audioFormat:item.audioFormat
+                                            delegate:nil
+                                       delegateQueue:nil
+                                    preparationQueue:self.workerQ];
+    }
+    return [[playerClass alloc] initWithData:item.data
+                              packetDuration:item.packetDuration
+                                 audioFormat:item.audioFormat
+                                    delegate:nil
+                               delegateQueue:nil
+                            preparationQueue:self.workerQ];
+}
+
+#pragma mark - Memory Budget
+//Until the player is prepared, what it is going to hold is guessed from its input
+- (NSUInteger) estimatedFootprintOfItem:(DHAudioPrefetchItem *)item
+{
+    if (item.data) {
+        return [item.data length];
+    }
+    return (NSUInteger)[[[NSFileManager defaultManager] attributesOfItemAtPath:item.filePath error:nil] fileSize];
+}
+
+//Called on stateQ
+- (NSUInteger) prefetchedFootprint
+{
+    NSUInteger footprint = 0;
+    for (DHPrefetchEntry *entry in self.prefetchedEntries) {
+        footprint += [entry footprint];
+    }
+    return footprint;
+}
+
+//Called on stateQ; Evicts entries ranked below `entry` until `footprint` more fit, if that is enough
+- (BOOL) makeRoom:(NSUInteger)footprint forEntry:(DHPrefetchEntry *)entry
+{
+    NSUInteger usage = [self prefetchedFootprint];
+    NSUInteger evictable = 0;
+    for (DHPrefetchEntry *prefetchedEntry in self.prefetchedEntries) {
+        if ([prefetchedEntry compareRank:entry] == NSOrderedDescending) {
+            evictable += [prefetchedEntry footprint];
+        }
+    }
+    if (usage - evictable + footprint > _memoryBudget) {
+        return NO;
+    }
+    [self evictToBudget:_memoryBudget - footprint];
+    return YES;
+}
+
+//Called on stateQ; Lowest rank first
+- (void) evictToBudget:(NSUInteger)budget
+{
+    [self.prefetchedEntries sortUsingSelector:@selector(compareRank:)];
+    NSUInteger usage = [self prefetchedFootprint];
+    while (usage > budget && [self.prefetchedEntries count] > 0) {
+        DHPrefetchEntry *entry = [self.prefetchedEntries lastObject];
+        [self.prefetchedEntries removeLastObject];
+        usage -= MIN([entry footprint], usage);
+        DHAudioFilePlayer *player = entry.player;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [player cancelPreparation];
+        });
+    }
+}
+
+- (void) didReceiveMemoryWarning:(NSNotification *)notification
+{
+    dispatch_async(self.stateQ, ^{
+        [self evictToBudget:0];
+    });
+}
+
+@end
+
+#pragma mark - DHAudioFilePlayerFactory
 @implementation DHAudioFilePlayerFactory
 + (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
                                             data:(NSData *)data
@@ -39,26 +436,35 @@
                                   packetDuration:(NSTimeInterval)packetDuration
                                         delegate:(id<DHAudioFilePlayerDelegate>)delegate
 {
-    switch (audioType) {
-        case DHAudioTypeAAC:
-        case DHAudioTypeMP3:
-            return [[DHAudioFilePlayer alloc] initWithData:data
-                                              packetDuration:packetDuration
-                                                 audioFormat:audioFormat
-                                                    delegate:delegate];
-        case DHAudioTypeOpus:
-            return [[DHOpusAudioFilePlayer alloc] initWithData:data
-                                                  packetDuration:packetDuration
-                                                     audioFormat:audioFormat
-                                                        delegate:delegate];
-        case DHAudioTypeLinearPCM:
-            return [[DHPCMAudioFilePlayer alloc] initWithData:data
-                                                 packetDuration:packetDuration
-                                                    audioFormat:audioFormat
-                                                       delegate:delegate];
-        default:
-            break;
+    return [DHAudioFilePlayerFactory filePlayerForAudioType:audioType
+                                                         data:data
+                                                  audioFormat:audioFormat
+                                               packetDuration:packetDuration
+                                                     delegate:delegate
+                                                delegateQueue:nil
+                                             preparationQueue:nil];
+}
+
++ (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
+                                            data:(NSData *)data
+                                     audioFormat:(AudioStreamBasicDescription) audioFormat
+                                  packetDuration:(NSTimeInterval)packetDuration
+                                        delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                   delegateQueue:(dispatch_queue_t)delegateQueue
+                                preparationQueue:(dispatch_queue_t)preparationQueue
+{
+    DHAudioPrefetchItem *item = [DHAudioPrefetchItem itemWithAudioType:audioType data:data audioFormat:audioFormat packetDuration:packetDuration priority:DHAudioPrefetchPriorityNormal];
+    DHAudioFilePlayer *prefetchedPlayer = [DHAudioFilePlayerFactory takePrefetchedPlayerForItem:item delegate:delegate delegateQueue:delegateQueue preparationQueue:preparationQueue];
+    if (prefetchedPlayer) {
+        return prefetchedPlayer;
     }
+    Class playerClass = [DHAudioFilePlayerFactory playerClassForAudioType:audioType];
+    return [[playerClass alloc] initWithData:data
+                              packetDuration:packetDuration
+                                 audioFormat:audioFormat
+                                    delegate:delegate
+                               delegateQueue:delegateQueue
+                            preparationQueue:preparationQueue];
 }
 
 + (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
@@ -88,26 +494,128 @@
                                      audioFormat:(AudioStreamBasicDescription)audioFormat
                                   packetDuration:(NSTimeInterval)packetDuration
                                         delegate:(id<DHAudioFilePlayerDelegate>)delegate
+{
+    return [DHAudioFilePlayerFactory filePlayerForAudioType:audioType
+                                                     filePath:filePath
+                                                  audioFormat:audioFormat
+                                               packetDuration:packetDuration
+                                                     delegate:delegate
+                                                delegateQueue:nil
+                                             preparationQueue:nil];
+}
+
++ (DHAudioFilePlayer *) filePlayerForAudioType:(DHAudioType)audioType
+                                        filePath:(NSString *)filePath
+                                     audioFormat:(AudioStreamBasicDescription)audioFormat
+                                  packetDuration:(NSTimeInterval)packetDuration
+                                        delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                   delegateQueue:(dispatch_queue_t)delegateQueue
+                                preparationQueue:(dispatch_queue_t)preparationQueue
+{
+    DHAudioPrefetchItem *item = [DHAudioPrefetchItem itemWithAudioType:audioType filePath:filePath audioFormat:audioFormat packetDuration:packetDuration priority:DHAudioPrefetchPriorityNormal];
+    DHAudioFilePlayer *prefetchedPlayer = [DHAudioFilePlayerFactory takePrefetchedPlayerForItem:item delegate:delegate delegateQueue:delegateQueue preparationQueue:preparationQueue];
+    if (prefetchedPlayer) {
+        return prefetchedPlayer;
+    }
+    Class playerClass = [DHAudioFilePlayerFactory playerClassForAudioType:audioType];
+    return [[playerClass alloc] initWithFilePath:filePath
+                                  packetDuration:packetDuration
+                                     audioFormat:audioFormat
+                                        delegate:delegate
+                                   delegateQueue:delegateQueue
+                                preparationQueue:preparationQueue];
+}
+
++ (DHAudioFilePlayer *) streamingFilePlayerForAudioType:(DHAudioType)audioType
+                                            audioFormat:(AudioStreamBasicDescription)audioFormat
+                                         packetDuration:(NSTimeInterval)packetDuration
+                                               delegate:(id<DHAudioFilePlayerDelegate>)delegate
 {
     switch (audioType) {
         case DHAudioTypeAAC:
+            return [[DHAACAudioFilePlayer alloc] initForStreamingWithAudioFormat:audioFormat
+                                                                  packetDuration:packetDuration
+                                                                        delegate:delegate];
         case DHAudioTypeMP3:
-            return [[DHAudioFilePlayer alloc] initWithFilePath:filePath
-                                                  packetDuration:packetDuration
-                                                     audioFormat:audioFormat
-                                                        delegate:delegate];
+            return [[DHAudioFilePlayer alloc] initForStreamingWithAudioFormat:audioFormat
+                                                               packetDuration:packetDuration
+                                                                     delegate:delegate];
         case DHAudioTypeOpus:
-            return [[DHOpusAudioFilePlayer alloc] initWithFilePath:filePath
-                                                      packetDuration:packetDuration
-                                                         audioFormat:audioFormat
-                                                            delegate:delegate];
+            return [[DHOpusAudioFilePlayer alloc] initForStreamingWithAudioFormat:audioFormat
+                                                                   packetDuration:packetDuration
+                                                                         delegate:delegate];
         case DHAudioTypeLinearPCM:
-            return [[DHPCMAudioFilePlayer alloc] initWithFilePath:filePath
-                                                     packetDuration:packetDuration
-                                                        audioFormat:audioFormat
-                                                           delegate:delegate];
+            return [[DHPCMAudioFilePlayer alloc] initForStreamingWithAudioFormat:audioFormat
+                                                                  packetDuration:packetDuration
+                                                                        delegate:delegate];
         default:
-            break;
+            return nil;
+    }
+}
+
++ (Class) playerClassForAudioType:(DHAudioType)audioType
+{
+    switch (audioType) {
+        case DHAudioTypeAAC:
+            return [DHAACAudioFilePlayer class];
+        case DHAudioTypeMP3:
+            return [DHAudioFilePlayer class];
+        case DHAudioTypeOpus:
+            return [DHOpusAudioFilePlayer class];
+        case DHAudioTypeLinearPCM:
+            return [DHPCMAudioFilePlayer class];
+        default:
+            return nil;
     }
 }
+
+#pragma mark - Prefetching
+//Without a `preparationQueue` the caller gets a prepared player, as one created here would be; A prefetched player that is still preparing can not be waited for, as it finishes on the main queue, so it is dropped and a new one is created
++ (DHAudioFilePlayer *) takePrefetchedPlayerForItem:(DHAudioPrefetchItem *)item
+                                           delegate:(id<DHAudioFilePlayerDelegate>)delegate
+                                      delegateQueue:(dispatch_queue_t)delegateQueue
+                                   preparationQueue:(dispatch_queue_t)preparationQueue
+{
+    DHAudioFilePlayer *prefetchedPlayer = [[DHAudioFilePlayerPrefetcher sharedPrefetcher] takePlayerForItem:item];
+    if (prefetchedPlayer == nil) {
+        return nil;
+    }
+    //The status is read here rather than on the prefetcher's queue, as it changes on the main queue; A failed preparation is reported to nobody, a new player reports it to the caller
+    if (prefetchedPlayer.status == DHAudioPlayerStatusStopped) {
+        return nil;
+    }
+    if (preparationQueue == nil && prefetchedPlayer.status == DHAudioPlayerStatusConvertingData) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [prefetchedPlayer cancelPreparation];
+        });
+        return nil;
+    }
+    [prefetchedPlayer handOverToDelegate:delegate delegateQueue:delegateQueue];
+    return prefetchedPlayer;
+}
+
++ (void) prefetchItems:(NSArray<DHAudioPrefetchItem *> *)items
+{
+    [[DHAudioFilePlayerPrefetcher sharedPrefetcher] prefetchItems:items];
+}
+
++ (void) cancelPrefetching
+{
+    [[DHAudioFilePlayerPrefetcher sharedPrefetcher] cancelPrefetching];
+}
+
++ (void) setPrefetchMemoryBudget:(NSUInteger)prefetchMemoryBudget
+{
+    [[DHAudioFilePlayerPrefetcher sharedPrefetcher] setMemoryBudget:prefetchMemoryBudget];
+}
+
++ (NSUInteger) prefetchMemoryBudget
+{
+    return [DHAudioFilePlayerPrefetcher sharedPrefetcher].memoryBudget;
+}
+
++ (NSUInteger) prefetchMemoryUsage
+{
+    return [[DHAudioFilePlayerPrefetcher sharedPrefetcher] memoryUsage];
+}
 @end
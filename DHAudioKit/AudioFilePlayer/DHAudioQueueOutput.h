@@ -0,0 +1,75 @@
+//
+//  DHAudioQueueOutput.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "DHPlaybackEngine.h"
+
+@class DHAudioQueueOutput;
+@protocol DHAudioQueueOutputDelegate <NSObject>
+
+/**
+ * Called on the audio queue's thread every time a buffer was rendered, so the producer can refill the engine; Do not block in it;
+ */
+- (void) audioQueueOutputDidRenderBuffer:(DHAudioQueueOutput *)output;
+
+/**
+ * Called on the main queue once the engine finished and the last buffer was played;
+ */
+- (void) audioQueueOutputDidFinishPlaying:(DHAudioQueueOutput *)output;
+
+@end
+
+/**
+ * The platform side of streaming playback: an AudioQueue whose buffers are filled by pulling from a `DHPlaybackEngine`;
+ * The engine is not owned, it has to outlive the output;
+ */
+@interface DHAudioQueueOutput : NSObject
+
+/**
+ * Initializer
+ * @param engine the engine to pull from
+ * @param format the Linear PCM format of the engine's frames
+ * @param delegate the delegate
+ */
+- (instancetype) initWithEngine:(DHPlaybackEngine *)engine
+                         format:(AudioStreamBasicDescription)format
+                       delegate:(id<DHAudioQueueOutputDelegate>)delegate;
+
+@property (nonatomic, weak) id<DHAudioQueueOutputDelegate> delegate;
+@property (nonatomic, readonly) AudioStreamBasicDescription format;
+
+/**
+ * Duration of one AudioQueue buffer, the latency of the output; Default value is 0.05 seconds; Set it before `start`;
+ */
+@property (nonatomic) NSTimeInterval bufferDuration;
+
+/**
+ * The volume for the output; Between 0-1;
+ */
+@property (nonatomic) float volume;
+
+/**
+ * Create the AudioQueue if needed and start pulling; Resumes after `pause`;
+ * @return NO if the AudioQueue could not be created or started
+ */
+- (BOOL) start;
+- (void) pause;
+
+/**
+ * Stop immediately and release the AudioQueue;
+ */
+- (void) stop;
+
+/**
+ * The position of the engine's stream that is playing now, from the queue's timeline and the buffers rendered into it, see `DHPlaybackClock`;
+ * @return NO if there is no AudioQueue or nothing was rendered yet
+ */
+- (BOOL) getCurrentFrame:(UInt64 *)frame;
+
+@end
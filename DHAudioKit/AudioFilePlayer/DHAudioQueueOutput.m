@@ -0,0 +1,182 @@
+//
+//  DHAudioQueueOutput.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioQueueOutput.h"
+
+static const int kNumberBuffers = 3;
+static const NSTimeInterval kDefaultBufferDuration = 0.05;
+
+static void HandleOutputBuffer(void *inUserData, AudioQueueRef inAQ, AudioQueueBufferRef inBuffer);
+static void HandleIsRunningChanged(void *inUserData, AudioQueueRef inAQ, AudioQueuePropertyID inID);
+
+@interface DHAudioQueueOutput () {
+    DHPlaybackEngine *engine;
+    AudioQueueRef queue;
+    AudioQueueBufferRef buffers[kNumberBuffers];
+    DHPlaybackClock clock;
+}
+@property (nonatomic, readwrite) AudioStreamBasicDescription format;
+@property (atomic) BOOL draining;       //the engine finished, the queue plays out what is enqueued
+@property (nonatomic) Float64 lastSampleTime;
+@end
+
+@implementation DHAudioQueueOutput
+
+- (instancetype) initWithEngine:(DHPlaybackEngine *)playbackEngine
+                         format:(AudioStreamBasicDescription)format
+                       delegate:(id<DHAudioQueueOutputDelegate>)delegate
+{
+    self = [super init];
+    if (self) {
+        engine = playbackEngine;
+        _format = format;
+        _delegate = delegate;
+        _bufferDuration = kDefaultBufferDuration;
+        _volume = 1;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [self stop];
+}
+
+#pragma mark - Actions
+- (BOOL) start
+{
+    if (queue == NULL && ![self createAudioQueue]) {
+        return NO;
+    }
+    return AudioQueueStart(queue, NULL) == noErr;
+}
+
+- (void) pause
+{
+    if (queue) {
+        AudioQueuePause(queue);
+    }
+}
+
+- (void) stop
+{
+    if (queue == NULL) {
+        return;
+    }
+    self.draining = NO;
+    AudioQueueStop(queue, true);
+    AudioQueueDispose(queue, true);
+    queue = NULL;
+}
+
+- (BOOL) getCurrentFrame:(UInt64 *)frame
+{
+    if (queue == NULL) {
+        return NO;
+    }
+    AudioTimeStamp timeStamp;
+    //The time can not be read before the queue started, or e.g. while the hardware is reconfigured; The last one read is close enough then
+    if (AudioQueueGetCurrentTime(queue, NULL, &timeStamp, NULL) == noErr && (timeStamp.mFlags & kAudioTimeStampSampleTimeValid)) {
+        self.lastSampleTime = timeStamp.mSampleTime;
+    }
+    uint64_t currentFrame;
+    if (!DHPlaybackClockFrameAtTime(&clock, self.lastSampleTime, &currentFrame)) {
+        return NO;
+    }
+    *frame = currentFrame;
+    return YES;
+}
+
+- (void) setVolume:(float)volume
+{
+    _volume = volume;
+    if (queue) {
+        AudioQueueSetParameter(queue, kAudioQueueParam_Volume, volume);
+    }
+}
+
+#pragma mark - Audio Queue
+- (BOOL) createAudioQueue
+{
+    AudioStreamBasicDescription format = self.format;
+    OSStatus status = AudioQueueNewOutput(&format, HandleOutputBuffer, (__bridge void *)self, NULL, kCFRunLoopCommonModes, 0, &queue);
+    if (status != noErr) {
+        queue = NULL;
+        return NO;
+    }
+    AudioQueueAddPropertyListener(queue, kAudioQueueProperty_IsRunning, HandleIsRunningChanged, (__bridge void *)self);
+    AudioQueueSetParameter(queue, kAudioQueueParam_Volume, self.volume);
+
+    UInt32 framesPerBuffer = MAX((UInt32)(format.mSampleRate * self.bufferDuration), 1);
+    self.draining = NO;
+    //A new queue's timeline starts at 0
+    DHPlaybackClockReset(&clock);
+    self.lastSampleTime = 0;
+    for (int i = 0; i < kNumberBuffers; i++) {
+        AudioQueueAllocateBuffer(queue, framesPerBuffer * format.mBytesPerFrame, &buffers[i]);
+        //Prime the queue, while the engine is still buffering this enqueues silence
+        [self renderBuffer:buffers[i]];
+    }
+    return YES;
+}
+
+- (void) renderBuffer:(AudioQueueBufferRef)buffer
+{
+    if (self.draining) {
+        return;
+    }
+    UInt32 bytesPerFrame = self.format.mBytesPerFrame;
+    size_t numberOfFrames = buffer->mAudioDataBytesCapacity / bytesPerFrame;
+    uint64_t firstFrame = DHPlaybackEngineRenderPosition(engine);
+    size_t rendered = DHPlaybackEngineRender(engine, buffer->mAudioData, numberOfFrames);
+    if (DHPlaybackEngineGetState(engine) == DHPlaybackEngineStateFinished) {
+        if (rendered == 0) {
+            //Let the enqueued buffers play out, `HandleIsRunningChanged` reports the end
+            self.draining = YES;
+            AudioQueueStop(queue, false);
+            return;
+        }
+        //Do not pad the last buffer with silence
+        numberOfFrames = rendered;
+    }
+    buffer->mAudioDataByteSize = (UInt32)(numberOfFrames * bytesPerFrame);
+    uint32_t numberOfStreamFrames = (uint32_t)(DHPlaybackEngineRenderPosition(engine) - firstFrame);
+    DHPlaybackClockScheduleBuffer(&clock, firstFrame, numberOfStreamFrames, (uint32_t)rendered, (uint32_t)numberOfFrames);
+    AudioQueueEnqueueBuffer(queue, buffer, 0, NULL);
+    [self.delegate audioQueueOutputDidRenderBuffer:self];
+}
+
+- (void) queueDidStopRunning
+{
+    if (!self.draining) {
+        return;
+    }
+    self.draining = NO;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.delegate audioQueueOutputDidFinishPlaying:self];
+    });
+}
+
+@end
+
+#pragma mark - Audio Queue Callbacks
+static void HandleOutputBuffer(void *inUserData, AudioQueueRef inAQ, AudioQueueBufferRef inBuffer)
+{
+    DHAudioQueueOutput *output = (__bridge DHAudioQueueOutput *)inUserData;
+    [output renderBuffer:inBuffer];
+}
+
+static void HandleIsRunningChanged(void *inUserData, AudioQueueRef inAQ, AudioQueuePropertyID inID)
+{
+    UInt32 isRunning = 0;
+    UInt32 size = sizeof(isRunning);
+    if (AudioQueueGetProperty(inAQ, kAudioQueueProperty_IsRunning, &isRunning, &size) == noErr && !isRunning) {
+        DHAudioQueueOutput *output = (__bridge DHAudioQueueOutput *)inUserData;
+        [output queueDidStopRunning];
+    }
+}
@@ -0,0 +1,36 @@
+//
+//  DHAudioStreamDecoder.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+
+/**
+ * Decodes a compressed stream that arrives in pieces, e.g. MP3 or ADTS AAC, to 16-bit interleaved Linear PCM;
+ * Packets are parsed with AudioFileStream and decoded with AudioConverter as soon as they are complete; Use it from a single queue;
+ */
+@interface DHAudioStreamDecoder : NSObject
+
+/**
+ * Initializer
+ * @param fileType hint for the stream parser, e.g. `kAudioFileMP3Type` or `kAudioFileAAC_ADTSType`
+ */
+- (instancetype) initWithFileType:(AudioFileTypeID)fileType;
+
+/**
+ * The format of the decoded data; Its sample rate and channels are only known once the first packets were parsed, `isReady` tells;
+ */
+@property (nonatomic, readonly) AudioStreamBasicDescription outputFormat;
+@property (nonatomic, readonly) BOOL isReady;
+
+/**
+ * Parse `data` and decode every complete packet;
+ * @return the decoded PCM, empty if no packet was complete yet, nil if the stream could not be parsed or decoded
+ */
+- (NSData *) decodeData:(NSData *)data;
+
+@end
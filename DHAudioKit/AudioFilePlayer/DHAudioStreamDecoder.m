@@ -0,0 +1,182 @@
+//
+//  DHAudioStreamDecoder.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioStreamDecoder.h"
+#import "DHPCMFormatConverter.h"
+
+static const OSStatus kDHAudioStreamDecoderNoMoreInput = 'dhni';
+static const UInt32 kDHAudioStreamDecoderFramesPerRound = 4096;
+
+//The packets of one parser callback, handed to the converter one at a time
+typedef struct {
+    const uint8_t *bytes;
+    const AudioStreamPacketDescription *descriptions;
+    UInt32 numberOfPackets;
+    UInt32 index;
+    UInt32 numberOfChannels;
+    AudioStreamPacketDescription current;
+} DHAudioStreamPackets;
+
+static void HandleStreamProperty(void *inClientData, AudioFileStreamID inAudioFileStream, AudioFileStreamPropertyID inPropertyID, AudioFileStreamPropertyFlags *ioFlags);
+static void HandleStreamPackets(void *inClientData, UInt32 inNumberBytes, UInt32 inNumberPackets, const void *inInputData, AudioStreamPacketDescription *inPacketDescriptions);
+static OSStatus ProvideStreamPackets(AudioConverterRef inAudioConverter, UInt32 *ioNumberDataPackets, AudioBufferList *ioData, AudioStreamPacketDescription **outDataPacketDescription, void *inUserData);
+
+@interface DHAudioStreamDecoder () {
+    AudioFileStreamID stream;
+    AudioConverterRef converter;
+}
+@property (nonatomic, readwrite) AudioStreamBasicDescription outputFormat;
+@property (nonatomic, readwrite) BOOL isReady;
+@property (nonatomic, strong) NSMutableData *decodedData;      //output of the current `decodeData:` call
+@property (nonatomic) BOOL failed;
+@end
+
+@implementation DHAudioStreamDecoder
+
+- (instancetype) initWithFileType:(AudioFileTypeID)fileType
+{
+    self = [super init];
+    if (self) {
+        OSStatus status = AudioFileStreamOpen((__bridge void *)self, HandleStreamProperty, HandleStreamPackets, fileType, &stream);
+        if (status != noErr) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    if (stream) {
+        AudioFileStreamClose(stream);
+    }
+    if (converter) {
+        AudioConverterDispose(converter);
+    }
+}
+
+- (NSData *) decodeData:(NSData *)data
+{
+    if (self.failed) {
+        return nil;
+    }
+    self.decodedData = [NSMutableData data];
+    if ([data length] > 0) {
+        OSStatus status = AudioFileStreamParseBytes(stream, (UInt32)[data length], [data bytes], 0);
+        if (status != noErr) {
+            self.failed = YES;
+        }
+    }
+    NSData *decodedData = self.failed ? nil : self.decodedData;
+    self.decodedData = nil;
+    return decodedData;
+}
+
+#pragma mark - Parsing
+- (void) streamIsReadyToProducePackets
+{
+    AudioStreamBasicDescription inputFormat;
+    UInt32 size = sizeof(inputFormat);
+    if (AudioFileStreamGetProperty(stream, kAudioFileStreamProperty_DataFormat, &size, &inputFormat) != noErr) {
+        self.failed = YES;
+        return;
+    }
+    AudioStreamBasicDescription outputFormat = [DHPCMFormatConverter signed16BitFormatWithSampleRate:inputFormat.mSampleRate
+                                                                                    numberOfChannels:inputFormat.mChannelsPerFrame];
+    if (AudioConverterNew(&inputFormat, &outputFormat, &converter) != noErr) {
+        converter = NULL;
+        self.failed = YES;
+        return;
+    }
+    //Streams with an out-of-band decoder configuration carry it as a magic cookie
+    UInt32 cookieSize = 0;
+    if (AudioFileStreamGetPropertyInfo(stream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, NULL) == noErr && cookieSize > 0) {
+        NSMutableData *cookie = [NSMutableData dataWithLength:cookieSize];
+        if (AudioFileStreamGetProperty(stream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, [cookie mutableBytes]) == noErr) {
+            AudioConverterSetProperty(converter, kAudioConverterDecompressionMagicCookie, cookieSize, [cookie bytes]);
+        }
+    }
+    self.outputFormat = outputFormat;
+    self.isReady = YES;
+}
+
+#pragma mark - Decoding
+- (void) decodePackets:(const void *)bytes
+       numberOfPackets:(UInt32)numberOfPackets
+    packetDescriptions:(const AudioStreamPacketDescription *)packetDescriptions
+{
+    if (converter == NULL || packetDescriptions == NULL || self.failed) {
+        return;
+    }
+    DHAudioStreamPackets packets = {0};
+    packets.bytes = bytes;
+    packets.descriptions = packetDescriptions;
+    packets.numberOfPackets = numberOfPackets;
+    packets.numberOfChannels = self.outputFormat.mChannelsPerFrame;
+
+    UInt32 bytesPerFrame = self.outputFormat.mBytesPerFrame;
+    while (true) {
+        NSUInteger offset = [self.decodedData length];
+        [self.decodedData increaseLengthBy:kDHAudioStreamDecoderFramesPerRound * bytesPerFrame];
+        AudioBufferList outputBuffers;
+        outputBuffers.mNumberBuffers = 1;
+        outputBuffers.mBuffers[0].mNumberChannels = self.outputFormat.mChannelsPerFrame;
+        outputBuffers.mBuffers[0].mDataByteSize = kDHAudioStreamDecoderFramesPerRound * bytesPerFrame;
+        outputBuffers.mBuffers[0].mData = (uint8_t *)[self.decodedData mutableBytes] + offset;
+
+        UInt32 numberOfFrames = kDHAudioStreamDecoderFramesPerRound;
+        OSStatus status = AudioConverterFillComplexBuffer(converter, ProvideStreamPackets, &packets, &numberOfFrames, &outputBuffers, NULL);
+        [self.decodedData setLength:offset + numberOfFrames * bytesPerFrame];
+        if (status == kDHAudioStreamDecoderNoMoreInput || (status == noErr && numberOfFrames == 0)) {
+            break;
+        }
+        if (status != noErr) {
+            self.failed = YES;
+            break;
+        }
+    }
+}
+
+@end
+
+#pragma mark - Callbacks
+static void HandleStreamProperty(void *inClientData, AudioFileStreamID inAudioFileStream, AudioFileStreamPropertyID inPropertyID, AudioFileStreamPropertyFlags *ioFlags)
+{
+    if (inPropertyID == kAudioFileStreamProperty_ReadyToProducePackets) {
+        DHAudioStreamDecoder *decoder = (__bridge DHAudioStreamDecoder *)inClientData;
+        [decoder streamIsReadyToProducePackets];
+    }
+}
+
+static void HandleStreamPackets(void *inClientData, UInt32 inNumberBytes, UInt32 inNumberPackets, const void *inInputData, AudioStreamPacketDescription *inPacketDescriptions)
+{
+    DHAudioStreamDecoder *decoder = (__bridge DHAudioStreamDecoder *)inClientData;
+    [decoder decodePackets:inInputData numberOfPackets:inNumberPackets packetDescriptions:inPacketDescriptions];
+}
+
+static OSStatus ProvideStreamPackets(AudioConverterRef inAudioConverter, UInt32 *ioNumberDataPackets, AudioBufferList *ioData, AudioStreamPacketDescription **outDataPacketDescription, void *inUserData)
+{
+    DHAudioStreamPackets *packets = inUserData;
+    if (packets->index >= packets->numberOfPackets) {
+        //Stops this round, the converter keeps its state for the packets of the next callback
+        *ioNumberDataPackets = 0;
+        return kDHAudioStreamDecoderNoMoreInput;
+    }
+    packets->current = packets->descriptions[packets->index];
+    ioData->mNumberBuffers = 1;
+    ioData->mBuffers[0].mNumberChannels = packets->numberOfChannels;
+    ioData->mBuffers[0].mData = (void *)(packets->bytes + packets->current.mStartOffset);
+    ioData->mBuffers[0].mDataByteSize = packets->current.mDataByteSize;
+    packets->current.mStartOffset = 0;
+    if (outDataPacketDescription) {
+        *outDataPacketDescription = &packets->current;
+    }
+    *ioNumberDataPackets = 1;
+    packets->index++;
+    return noErr;
+}
@@ -0,0 +1,74 @@
+//
+//  DHDecodedAudioCache.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A process-wide cache of decoded PCM, so audio that is played again is not decoded again, whichever player instance plays it;
+ * Entries are kept in memory up to `memoryBudget` and evicted least recently used first; With a `diskDirectory`, evicted entries are written there and mapped back in on a later miss;
+ * `DHOpusAudioFilePlayer` caches a stream once it was played from start to end; All methods are thread safe;
+ */
+@interface DHDecodedAudioCache : NSObject
+
++ (instancetype) sharedCache;
+
+/**
+ * Bytes of decoded PCM kept in memory; Default value is 32 MB; Entries larger than this are not cached;
+ */
+@property (nonatomic) NSUInteger memoryBudget;
+
+/**
+ * Directory for the disk tier, nil to keep entries in memory only; Default value is nil;
+ */
+@property (nonatomic, copy) NSString *diskDirectory;
+
+/**
+ * Bytes kept in `diskDirectory`, the least recently used files are deleted first; Default value is 256 MB;
+ */
+@property (nonatomic) unsigned long long diskBudget;
+
+#pragma mark - Keys
+
+/**
+ * Key for the contents of `data`, a SHA-256 of its bytes;
+ */
++ (NSString *) keyForData:(NSData *)data;
+
+/**
+ * Key for the file at `filePath` as it is now: its path, size and modification date, so nothing is read from the file;
+ * @return nil if the file does not exist
+ */
++ (NSString *) keyForFileAtPath:(NSString *)filePath;
+
+#pragma mark - Entries
+
+/**
+ * The cached PCM for `key`, from memory or else from the disk tier, or nil on a miss;
+ */
+- (NSData *) pcmDataForKey:(NSString *)key;
+
+- (void) setPCMData:(NSData *)pcmData forKey:(NSString *)key;
+
+- (void) removePCMDataForKey:(NSString *)key;
+
+/**
+ * Empty the memory tier, and the disk tier with it if `includingDisk`;
+ */
+- (void) removeAllPCMDataIncludingDisk:(BOOL)includingDisk;
+
+#pragma mark - Statistics
+
+@property (nonatomic, readonly) NSUInteger numberOfHits;
+@property (nonatomic, readonly) NSUInteger numberOfDiskHits;       //part of `numberOfHits`
+@property (nonatomic, readonly) NSUInteger numberOfMisses;
+@property (nonatomic, readonly) NSUInteger numberOfEvictions;
+@property (nonatomic, readonly) NSUInteger memoryUsage;            //bytes of PCM in memory
+
+- (void) resetStatistics;
+
+@end
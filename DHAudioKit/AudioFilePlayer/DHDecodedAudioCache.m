@@ -0,0 +1,352 @@
+//
+//  DHDecodedAudioCache.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHDecodedAudioCache.h"
+#import "DHAudioFilePlayer.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <UIKit/UIKit.h>
+
+static const NSUInteger kDefaultMemoryBudget = 32 * 1024 * 1024;
+static const unsigned long long kDefaultDiskBudget = 256 * 1024 * 1024;
+static NSString * const kDiskEntryExtension = @"pcm";
+
+@interface DHDecodedAudioCache ()
+@property (nonatomic, strong) dispatch_queue_t cacheQ;
+@property (nonatomic, strong) dispatch_queue_t diskQ;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSData *> *entries;
+@property (nonatomic, strong) NSMutableOrderedSet<NSString *> *recentKeys;     //least recently used first
+@property (nonatomic, readwrite) NSUInteger numberOfHits;
+@property (nonatomic, readwrite) NSUInteger numberOfDiskHits;
+@property (nonatomic, readwrite) NSUInteger numberOfMisses;
+@property (nonatomic, readwrite) NSUInteger numberOfEvictions;
+@property (nonatomic, readwrite) NSUInteger memoryUsage;
+@end
+
+@implementation DHDecodedAudioCache
+
++ (instancetype) sharedCache
+{
+    static DHDecodedAudioCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[DHDecodedAudioCache alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self) {
+        _cacheQ = dispatch_queue_create("Decoded Audio Cache Queue", NULL);
+        _diskQ = dispatch_queue_create("Decoded Audio Cache Disk Queue", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _entries = [NSMutableDictionary dictionary];
+        _recentKeys = [NSMutableOrderedSet orderedSet];
+        _memoryBudget = kDefaultMemoryBudget;
+        _diskBudget = kDefaultDiskBudget;
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void) setMemoryBudget:(NSUInteger)memoryBudget
+{
+    dispatch_sync(self.cacheQ, ^{
+        _memoryBudget = memoryBudget;
+        [self evictToBudget:memoryBudget];
+    });
+}
+
+- (void) setDiskDirectory:(NSString *)diskDirectory
+{
+    if (diskDirectory) {
+        [[NSFileManager defaultManager] createDirectoryAtPath:diskDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    dispatch_sync(self.cacheQ, ^{
+        _diskDirectory = [diskDirectory copy];
+    });
+}
+
+#pragma mark - Keys
++ (NSString *) keyForData:(NSData *)data
+{
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256([data bytes], (CC_LONG)[data length], digest);
+    return [self hexStringWithDigest:digest];
+}
+
++ (NSString *) keyForFileAtPath:(NSString *)filePath
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:nil];
+    if (attributes == nil) {
+        return nil;
+    }
+    NSString *identity = [NSString stringWithFormat:@"%@|%llu|%f", filePath, [attributes fileSize], [[attributes fileModificationDate] timeIntervalSince1970]];
+    NSData *identityData = [identity dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256([identityData bytes], (CC_LONG)[identityData length], digest);
+    return [self hexStringWithDigest:digest];
+}
+
++ (NSString *) hexStringWithDigest:(const unsigned char *)digest
+{
+    NSMutableString *string = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [string appendFormat:@"%02x", digest[i]];
+    }
+    return string;
+}
+
+#pragma mark - Entries
+- (NSData *) pcmDataForKey:(NSString *)key
+{
+    if (key == nil) {
+        return nil;
+    }
+    __block NSData *pcmData;
+    dispatch_sync(self.cacheQ, ^{
+        pcmData = self.entries[key];
+        if (pcmData) {
+            [self.recentKeys removeObject:key];
+            [self.recentKeys addObject:key];
+            _numberOfHits++;
+            return;
+        }
+        pcmData = [self diskEntryForKey:key];
+        if (pcmData) {
+            _numberOfHits++;
+            _numberOfDiskHits++;
+            [self insertPCMData:pcmData forKey:key];
+            return;
+        }
+        _numberOfMisses++;
+    });
+    return pcmData;
+}
+
+- (void) setPCMData:(NSData *)pcmData forKey:(NSString *)key
+{
+    if (key == nil || pcmData == nil) {
+        return;
+    }
+    NSData *entry = [pcmData copy];
+    dispatch_sync(self.cacheQ, ^{
+        [self insertPCMData:entry forKey:key];
+    });
+}
+
+- (void) removePCMDataForKey:(NSString *)key
+{
+    if (key == nil) {
+        return;
+    }
+    dispatch_sync(self.cacheQ, ^{
+        [self removeEntryForKey:key];
+        NSString *path = [self diskPathForKey:key];
+        if (path) {
+            dispatch_async(self.diskQ, ^{
+                [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+            });
+        }
+    });
+}
+
+- (void) removeAllPCMDataIncludingDisk:(BOOL)includingDisk
+{
+    dispatch_sync(self.cacheQ, ^{
+        [self.entries removeAllObjects];
+        [self.recentKeys removeAllObjects];
+        _memoryUsage = 0;
+        NSString *directory = self.diskDirectory;
+        if (includingDisk && directory) {
+            dispatch_async(self.diskQ, ^{
+                for (NSString *file in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:nil]) {
+                    if ([[file pathExtension] isEqualToString:kDiskEntryExtension]) {
+                        [[NSFileManager defaultManager] removeItemAtPath:[directory stringByAppendingPathComponent:file] error:nil];
+                    }
+                }
+            });
+        }
+    });
+}
+
+//Called on cacheQ
+- (void) insertPCMData:(NSData *)pcmData forKey:(NSString *)key
+{
+    if ([pcmData length] > self.memoryBudget) {
+        return;
+    }
+    [self removeEntryForKey:key];
+    [self evictToBudget:self.memoryBudget - [pcmData length]];
+    self.entries[key] = pcmData;
+    [self.recentKeys addObject:key];
+    _memoryUsage += [pcmData length];
+}
+
+//Called on cacheQ
+- (void) removeEntryForKey:(NSString *)key
+{
+    NSData *pcmData = self.entries[key];
+    if (pcmData) {
+        _memoryUsage -= [pcmData length];
+        [self.entries removeObjectForKey:key];
+        [self.recentKeys removeObject:key];
+    }
+}
+
+//Called on cacheQ; Drops the least recently used entries until `memoryUsage` fits `budget`, spilling them to disk
+- (void) evictToBudget:(NSUInteger)budget
+{
+    while (_memoryUsage > budget && [self.recentKeys count] > 0) {
+        NSString *key = [self.recentKeys firstObject];
+        [self spillPCMData:self.entries[key] forKey:key];
+        [self removeEntryForKey:key];
+        _numberOfEvictions++;
+    }
+}
+
+- (void) didReceiveMemoryWarning:(NSNotification *)notification
+{
+    dispatch_async(self.cacheQ, ^{
+        [self evictToBudget:0];
+    });
+}
+
+#pragma mark - Disk Tier
+//Called on cacheQ
+- (NSString *) diskPathForKey:(NSString *)key
+{
+    if (self.diskDirectory == nil) {
+        return nil;
+    }
+    return [[self.diskDirectory stringByAppendingPathComponent:key] stringByAppendingPathExtension:kDiskEntryExtension];
+}
+
+//Called on cacheQ
+- (NSData *) diskEntryForKey:(NSString *)key
+{
+    NSString *path = [self diskPathForKey:key];
+    if (path == nil) {
+        return nil;
+    }
+    NSData *pcmData = [DHAudioFilePlayer mappedDataWithContentsOfFile:path];
+    if (pcmData) {
+        //The modification date orders the disk tier
+        dispatch_async(self.diskQ, ^{
+            [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate : [NSDate date]} ofItemAtPath:path error:nil];
+        });
+    }
+    return pcmData;
+}
+
+//Called on cacheQ
+- (void) spillPCMData:(NSData *)pcmData forKey:(NSString *)key
+{
+    NSString *path = [self diskPathForKey:key];
+    NSString *directory = self.diskDirectory;
+    unsigned long long diskBudget = self.diskBudget;
+    if (path == nil || pcmData == nil) {
+        return;
+    }
+    dispatch_async(self.diskQ, ^{
+        if (![[NSFileManager defaultManager] fileExistsAtPath:path]) {
+            [pcmData writeToFile:path atomically:YES];
+        }
+        [self trimDiskDirectory:directory toBudget:diskBudget];
+    });
+}
+
+//Called on diskQ
+- (void) trimDiskDirectory:(NSString *)directory toBudget:(unsigned long long)budget
+{
+    NSURL *directoryURL = [NSURL fileURLWithPath:directory];
+    NSArray *keys = @[NSURLFileSizeKey, NSURLContentModificationDateKey];
+    NSMutableArray<NSURL *> *files = [NSMutableArray array];
+    unsigned long long usage = 0;
+    for (NSURL *url in [[NSFileManager defaultManager] contentsOfDirectoryAtURL:directoryURL includingPropertiesForKeys:keys options:0 error:nil]) {
+        if (![[url pathExtension] isEqualToString:kDiskEntryExtension]) {
+            continue;
+        }
+        NSNumber *size;
+        [url getResourceValue:&size forKey:NSURLFileSizeKey error:nil];
+        usage += [size unsignedLongLongValue];
+        [files addObject:url];
+    }
+    if (usage <= budget) {
+        return;
+    }
+    [files sortUsingComparator:^NSComparisonResult(NSURL *url1, NSURL *url2) {
+        NSDate *date1, *date2;
+        [url1 getResourceValue:&date1 forKey:NSURLContentModificationDateKey error:nil];
+        [url2 getResourceValue:&date2 forKey:NSURLContentModificationDateKey error:nil];
+        return [date1 compare:date2];
+    }];
+    for (NSURL *url in files) {
+        if (usage <= budget) {
+            break;
+        }
+        NSNumber *size;
+        [url getResourceValue:&size forKey:NSURLFileSizeKey error:nil];
+        if ([[NSFileManager defaultManager] removeItemAtURL:url error:nil]) {
+            usage -= [size unsignedLongLongValue];
+        }
+    }
+}
+
+#pragma mark - Statistics
+- (NSUInteger) numberOfHits
+{
+    __block NSUInteger value;
+    dispatch_sync(self.cacheQ, ^{ value = _numberOfHits; });
+    return value;
+}
+
+- (NSUInteger) numberOfDiskHits
+{
+    __block NSUInteger value;
+    dispatch_sync(self.cacheQ, ^{ value = _numberOfDiskHits; });
+    return value;
+}
+
+- (NSUInteger) numberOfMisses
+{
+    __block NSUInteger value;
+    dispatch_sync(self.cacheQ, ^{ value = _numberOfMisses; });
+    return value;
+}
+
+- (NSUInteger) numberOfEvictions
+{
+    __block NSUInteger value;
+    dispatch_sync(self.cacheQ, ^{ value = _numberOfEvictions; });
+    return value;
+}
+
+- (NSUInteger) memoryUsage
+{
+    __block NSUInteger value;
+    dispatch_sync(self.cacheQ, ^{ value = _memoryUsage; });
+    return value;
+}
+
+- (void) resetStatistics
+{
+    dispatch_sync(self.cacheQ, ^{
+        _numberOfHits = 0;
+        _numberOfDiskHits = 0;
+        _numberOfMisses = 0;
+        _numberOfEvictions = 0;
+    });
+}
+
+@end
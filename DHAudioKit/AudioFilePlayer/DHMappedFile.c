@@ -0,0 +1,81 @@
+//
+//  DHMappedFile.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DHMappedFile.h"
+
+static int DHMappedFileAdviceForAccess(DHMappedFileAccess access)
+{
+    switch (access) {
+        case DHMappedFileAccessSequential:
+            return MADV_SEQUENTIAL;
+        case DHMappedFileAccessRandom:
+            return MADV_RANDOM;
+        case DHMappedFileAccessWillNeed:
+            return MADV_WILLNEED;
+        case DHMappedFileAccessDontNeed:
+            return MADV_DONTNEED;
+        default:
+            return MADV_NORMAL;
+    }
+}
+
+int DHMappedFileOpen(DHMappedFile *file, const char *path, DHMappedFileAccess access)
+{
+    memset(file, 0, sizeof(DHMappedFile));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+        close(fd);
+        return 0;
+    }
+    if (status.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+    void *bytes = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping keeps the file alive, the descriptor is not needed anymore
+    close(fd);
+    if (bytes == MAP_FAILED) {
+        return 0;
+    }
+    file->bytes = bytes;
+    file->length = (size_t)status.st_size;
+    DHMappedFileAdvise(file, 0, file->length, access);
+    return 1;
+}
+
+void DHMappedFileClose(DHMappedFile *file)
+{
+    if (file->bytes) {
+        munmap((void *)file->bytes, file->length);
+    }
+    memset(file, 0, sizeof(DHMappedFile));
+}
+
+void DHMappedFileAdvise(const DHMappedFile *file, size_t offset, size_t length, DHMappedFileAccess access)
+{
+    if (file->bytes == NULL || offset >= file->length) {
+        return;
+    }
+    if (length > file->length - offset) {
+        length = file->length - offset;
+    }
+    //madvise wants a page aligned start
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % pageSize;
+    madvise((void *)(file->bytes + start), length + (offset - start), DHMappedFileAdviceForAccess(access));
+}
@@ -0,0 +1,51 @@
+//
+//  DHMappedFile.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHMappedFile_h
+#define DHMappedFile_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A read-only file mapped with `mmap`, exposed as a span of bytes; Pages are read from disk when they are first touched, and are clean, so the system can drop them under memory pressure;
+ * Opening takes the same time for any file size;
+ */
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+} DHMappedFile;
+
+/**
+ * How the bytes are going to be read, passed on to `madvise`;
+ */
+typedef enum {
+    DHMappedFileAccessNormal,
+    DHMappedFileAccessSequential,       //read ahead aggressively and drop pages behind, for scans and decoding
+    DHMappedFileAccessRandom,           //no read ahead, for index lookups
+    DHMappedFileAccessWillNeed,         //start reading a range in now, e.g. the target of a seek
+    DHMappedFileAccessDontNeed,         //a range will not be read again
+} DHMappedFileAccess;
+
+/**
+ * Map the file at `path`; An empty file is mapped as an empty span;
+ * @return 0 if the file can not be opened or mapped
+ */
+int DHMappedFileOpen(DHMappedFile *file, const char *path, DHMappedFileAccess access);
+
+/**
+ * Unmap the file; The span must not be used afterwards;
+ */
+void DHMappedFileClose(DHMappedFile *file);
+
+/**
+ * Give an access hint for `length` bytes from `offset`; The range is widened to whole pages;
+ */
+void DHMappedFileAdvise(const DHMappedFile *file, size_t offset, size_t length, DHMappedFileAccess access);
+
+#endif /* DHMappedFile_h */
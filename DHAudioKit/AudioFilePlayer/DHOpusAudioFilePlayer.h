@@ -8,6 +8,27 @@
 
 #import "DHAudioFilePlayer.h"
 
+/**
+ * Player for the length-framed streams of `DHOpusAudioConverter`;
+ * The stream is indexed from its framing when the data is set, without decoding, so duration is exact at once; Packets are decoded while playing, and seeking decodes from the packet ~80 ms before the new position;
+ * `audioFormat` is the PCM format to decode to; The encoder delay (`DHOpusEncoderDelay`) at the start of the stream is dropped, so the first frame played is the first frame that was recorded, and streams play back to back without a gap in a `DHQueueAudioFilePlayer`;
+ * A stream played from start to end is kept in `DHDecodedAudioCache`, so playing it again, with this or another player, does not decode it again;
+ */
 @interface DHOpusAudioFilePlayer : DHAudioFilePlayer
 
+/**
+ * Number of Opus packets in the stream;
+ */
+@property (nonatomic, readonly) NSUInteger numberOfPackets;
+
+/**
+ * Number of PCM frames in the stream, without the encoder delay; The duration is `numberOfFrames / sampleRate`;
+ */
+@property (nonatomic, readonly) UInt64 numberOfFrames;
+
+/**
+ * The packet that is playing at `time`;
+ */
+- (NSUInteger) packetIndexForTime:(NSTimeInterval)time;
+
 @end
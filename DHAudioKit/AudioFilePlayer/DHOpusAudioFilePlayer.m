@@ -8,65 +8,186 @@
 
 #import "DHOpusAudioFilePlayer.h"
 #import "DHOpusDecoder.h"
+#import "DHOpusUtilities.h"
+#import "DHDecodedAudioCache.h"
 
-@interface DHOpusAudioFilePlayer() <DHOpusDecoderDelegate>
+static const NSTimeInterval kOpusPreRollDuration = 0.08;
+static const NSUInteger kCachedFramesPerRead = 4096;
+
+@interface DHOpusAudioFilePlayer () {
+    DHOpusPacketIndex packetIndex;
+}
 @property (nonatomic, strong) DHOpusDecoder *decoder;
+@property (nonatomic, strong) NSData *opusData;
+@property (nonatomic) size_t nextPacket;
+@property (nonatomic) uint64_t nextPacketOffset;
+@property (nonatomic) UInt64 numberOfFramesToSkip;      //pre-roll left to drop after a seek
+@property (nonatomic) UInt64 numberOfPrimingFrames;     //encoder delay at the start of the stream, never played
+
+//Decoded audio cache
+@property (nonatomic, strong) NSString *cacheKey;
+@property (nonatomic, strong) NSData *cachedPCMData;            //a hit, played instead of decoding
+@property (nonatomic) NSUInteger cachedPCMOffset;
+@property (nonatomic, strong) NSMutableData *decodedPCMData;    //a miss, what was decoded since the start, cached when it reaches the end
 @end
 
 @implementation DHOpusAudioFilePlayer
 
+- (void) dealloc
+{
+    DHOpusPacketIndexDestroy(&packetIndex);
+}
+
 - (void) setupPlayerWithFile:(NSString *)filePath
 {
-    NSData *data = [NSData dataWithContentsOfFile:filePath];
-    [self.decoder decodeOpusData:data];
-    self.status = DHAudioPlayerStatusConvertingData;
+    //The file's identity is enough for a key, nothing has to be hashed
+    [self setupPlayerWithOpusData:[[self class] mappedDataWithContentsOfFile:filePath]
+                         cacheKey:[DHDecodedAudioCache keyForFileAtPath:filePath]];
 }
 
 - (void) setupPlayerWithData:(NSData *)data
 {
-    [self.decoder decodeOpusData:data];
-    self.status = DHAudioPlayerStatusConvertingData;
+    [self setupPlayerWithOpusData:data cacheKey:[DHDecodedAudioCache keyForData:data]];
+}
+
+- (void) setupPlayerWithOpusData:(NSData *)data cacheKey:(NSString *)key
+{
+    [self resetPlaybackEngine];
+    DHOpusPacketIndexDestroy(&packetIndex);
+    self.opusData = data;
+    self.cachedPCMData = nil;
+    self.decodedPCMData = nil;
+    //The same stream decodes differently to another format
+    AudioStreamBasicDescription format = self.audioFormat;
+    self.cacheKey = key ? [NSString stringWithFormat:@"%@-%.0f-%u-%u", key, format.mSampleRate, (unsigned int)format.mChannelsPerFrame, (unsigned int)format.mBitsPerChannel] : nil;
+    //Only the framing and TOC bytes are read, nothing is decoded until playback
+    if (!DHOpusPacketIndexBuild(&packetIndex, [data bytes], [data length], (int)self.audioFormat.mSampleRate)) {
+        [self failPreparingWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"No Opus packet found in data"}]];
+        return;
+    }
+    [self updatePreparationProgress:0.5];
+    self.numberOfPrimingFrames = MIN((UInt64)DHOpusEncoderDelay((int)self.audioFormat.mSampleRate), packetIndex.numberOfFrames);
+    [self setupPlaybackEngineWithFormat:self.audioFormat numberOfFrames:packetIndex.numberOfFrames - self.numberOfPrimingFrames];
 }
 
 - (DHOpusDecoder *) decoder
 {
     if (!_decoder) {
-        _decoder = [[DHOpusDecoder alloc] initWithSampleRate:self.audioFormat.mSampleRate
-                                              numberOfChannels:self.audioFormat.mChannelsPerFrame
-                                                packetDuration:self.packetDuration
-                                                      delegate:self];
+        _decoder = [[DHOpusDecoder alloc] initWithAudioFormat:self.audioFormat
+                                               packetDuration:self.packetDuration
+                                                     delegate:nil];
     }
     return _decoder;
 }
 
-#pragma mark - DHOpusDecoderDelegate
-- (void) opusDecoder:(DHOpusDecoder *)decoder
-didFinishDecodingWithResultPCMData:(NSData *)pcmData
+#pragma mark - Packet Index
+- (NSUInteger) numberOfPackets
 {
-    [self updateWithPlayableData:[self playablePCMDataWithData:pcmData]];
+    return packetIndex.numberOfPackets;
 }
 
-- (NSData *) playablePCMDataWithData:(NSData *)data
+- (UInt64) numberOfFrames
 {
-    char path[256];
-    NSString *filePath = [[NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) firstObject]
-                          stringByAppendingString:@"/temp_pcm_intermidate.wav"];
-    [filePath getCString:path maxLength:256 encoding:NSUTF8StringEncoding];
-    
-    if ([[NSFileManager defaultManager] fileExistsAtPath:filePath]) {
-        [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    return packetIndex.numberOfFrames - self.numberOfPrimingFrames;
+}
+
+- (NSUInteger) packetIndexForTime:(NSTimeInterval)time
+{
+    return DHOpusPacketIndexPacketForFrame(&packetIndex, (UInt64)(MAX(time, 0) * self.audioFormat.mSampleRate) + self.numberOfPrimingFrames);
+}
+
+#pragma mark - Decoding While Playing
+- (NSData *) nextPCMData
+{
+    if (self.cachedPCMData) {
+        return [self nextCachedPCMData];
+    }
+    NSData *pcmData = [self nextDecodedPCMData];
+    if (pcmData == nil) {
+        self.decodedPCMData = nil;
+    }
+    if (self.decodedPCMData) {
+        [self.decodedPCMData appendData:pcmData];
+        if ([pcmData length] == 0) {
+            [[DHDecodedAudioCache sharedCache] setPCMData:self.decodedPCMData forKey:self.cacheKey];
+            self.decodedPCMData = nil;
+        }
     }
-    
-    AudioFileID audioFile;
-    AudioStreamBasicDescription mDataFormat = self.audioFormat;
-    
-    CFURLRef audioFileURL = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *)path, strlen(path), false);
-    AudioFileCreateWithURL(audioFileURL, kAudioFileWAVEType, &mDataFormat, kAudioFileFlags_EraseFile, &audioFile);
-    UInt32 fileLength = (UInt32)[data length];
-    AudioFileWriteBytes(audioFile, false, 0, &fileLength, [data bytes]);
-    AudioFileClose(audioFile);
-    
-    return [NSData dataWithContentsOfFile:filePath];
+    return pcmData;
 }
-@end
 
+- (NSData *) nextCachedPCMData
+{
+    NSUInteger length = MIN([self.cachedPCMData length] - self.cachedPCMOffset, kCachedFramesPerRead * self.audioFormat.mBytesPerFrame);
+    NSData *pcmData = [self.cachedPCMData subdataWithRange:NSMakeRange(self.cachedPCMOffset, length)];
+    self.cachedPCMOffset += length;
+    return pcmData;
+}
+
+- (NSData *) nextDecodedPCMData
+{
+    const uint8_t *bytes = [self.opusData bytes];
+    size_t length = [self.opusData length];
+    while (self.nextPacket < packetIndex.numberOfPackets) {
+        size_t packetLength = 0;
+        uint64_t offset = self.nextPacketOffset;
+        size_t headerLength = DHOpusReadPacketLength(bytes + offset, length - (size_t)offset, &packetLength);
+        self.nextPacket++;
+        self.nextPacketOffset = offset + headerLength + packetLength;
+
+        NSData *pcmData = [self.decoder pcmDataWithPacket:bytes + offset + headerLength length:packetLength];
+        if (pcmData == nil || self.numberOfFramesToSkip == 0) {
+            return pcmData;
+        }
+        UInt32 bytesPerFrame = self.audioFormat.mBytesPerFrame;
+        UInt64 numberOfFrames = [pcmData length] / bytesPerFrame;
+        UInt64 numberOfFramesToSkip = MIN(self.numberOfFramesToSkip, numberOfFrames);
+        self.numberOfFramesToSkip -= numberOfFramesToSkip;
+        if (numberOfFramesToSkip < numberOfFrames) {
+            return [pcmData subdataWithRange:NSMakeRange((NSUInteger)(numberOfFramesToSkip * bytesPerFrame), (NSUInteger)((numberOfFrames - numberOfFramesToSkip) * bytesPerFrame))];
+        }
+    }
+    return [NSData data];
+}
+
+/**
+ * Start decoding ~80 ms before `frame`, so the decoder has converged by the time it gets there, and drop what comes before;
+ * `frame` counts from the end of the encoder delay, the cached PCM starts there too;
+ */
+- (void) seekToFrame:(UInt64)frame
+{
+    DHDecodedAudioCache *cache = [DHDecodedAudioCache sharedCache];
+    if (frame == 0 && self.cachedPCMData == nil) {
+        self.cachedPCMData = [cache pcmDataForKey:self.cacheKey];
+    }
+    if (self.cachedPCMData) {
+        UInt32 bytesPerFrame = self.audioFormat.mBytesPerFrame;
+        self.cachedPCMOffset = (NSUInteger)MIN(frame * bytesPerFrame, [self.cachedPCMData length] / bytesPerFrame * bytesPerFrame);
+        return;
+    }
+    //Only a play from the start decodes the whole stream, anything else is not worth collecting
+    NSUInteger expectedLength = (NSUInteger)(self.numberOfFrames * self.audioFormat.mBytesPerFrame);
+    BOOL collects = frame == 0 && self.cacheKey && expectedLength <= cache.memoryBudget;
+    self.decodedPCMData = collects ? [NSMutableData dataWithCapacity:expectedLength] : nil;
+
+    UInt64 streamFrame = frame + self.numberOfPrimingFrames;
+    UInt64 numberOfPreRollFrames = (UInt64)(self.audioFormat.mSampleRate * kOpusPreRollDuration);
+    size_t packet = DHOpusPacketIndexPacketForFrame(&packetIndex, streamFrame > numberOfPreRollFrames ? streamFrame - numberOfPreRollFrames : 0);
+    [self.decoder resetState];
+    self.nextPacket = packet;
+    self.nextPacketOffset = DHOpusPacketIndexOffsetOfPacket(&packetIndex, packet);
+    UInt64 packetFrame = DHOpusPacketIndexFrameOfPacket(&packetIndex, packet);
+    self.numberOfFramesToSkip = streamFrame > packetFrame ? streamFrame - packetFrame : 0;
+}
+
+#pragma mark - Streaming
+- (NSData *) pcmDataWithAppendedData:(NSData *)data
+{
+    return [self.decoder pcmDataWithOpusData:data];
+}
+
+- (AudioStreamBasicDescription) streamingPCMFormat
+{
+    return self.audioFormat;
+}
+@end
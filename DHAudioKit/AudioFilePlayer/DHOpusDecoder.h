@@ -7,6 +7,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
 @class DHOpusDecoder;
 @protocol DHOpusDecoderDelegate <NSObject>
 
@@ -24,11 +25,53 @@
                      packetDuration:(float)packetDuration      //单位为秒，Opus 只支持2.5, 5, 10, 20, 40 or 60 ms
                            delegate:(id<DHOpusDecoderDelegate>)delegate;
 
+/**
+ * Initializer; The output sample format follows `format`: 32-bit float Linear PCM is decoded with `opus_decode_float`, anything else with `opus_decode` to 16-bit samples;
+ * @param format The PCM format to decode to, its sample rate has to be one Opus supports
+ */
+- (instancetype) initWithAudioFormat:(AudioStreamBasicDescription)format
+                      packetDuration:(float)packetDuration
+                            delegate:(id<DHOpusDecoderDelegate>)delegate;
+
 @property (nonatomic, weak) id<DHOpusDecoderDelegate> delegate;
+
+/**
+ * The queue on which `decodeOpusData:` calls the delegate;
+ * Default value is dispatch_get_main_queue()
+ */
+@property (nonatomic, strong) dispatch_queue_t delegateQueue;
 @property (nonatomic) int sampleRate;
 @property (nonatomic) int numberOfChannels;
 @property (nonatomic) float packetDuration;
 
+/**
+ * Whether the PCM data are float samples;
+ */
+@property (nonatomic, readonly) BOOL decodesFloat;
+
+/**
+ * Decode length-framed packets as written by `DHOpusAudioConverter`; Data can be split anywhere, a partial packet waits for the next call;
+ * Packets of up to 120 ms, e.g. merged by the converter's `framesPerPacket`, are decoded whole;
+ */
 - (void) decodeOpusData:(NSData *)data;
 
+/**
+ * Decode synchronously on the calling queue, for streaming; Takes the same framed data as `decodeOpusData:`, but returns only the PCM of the packets completed by `data` and does not call the delegate;
+ * Do not mix it with `decodeOpusData:` on one decoder;
+ * @return the decoded PCM, empty if no packet was complete yet, nil on a decode error
+ */
+- (NSData *) pcmDataWithOpusData:(NSData *)data;
+
+/**
+ * Decode a single packet, without its length header, synchronously; An empty packet is concealed as a lost one;
+ * @return the decoded PCM, nil on a decode error
+ */
+- (NSData *) pcmDataWithPacket:(const uint8_t *)packet length:(size_t)length;
+
+/**
+ * Forget the decoder history and any partial packet, before decoding from another position of the stream;
+ * The first ~80 ms decoded after a reset are not exact yet, decode them as pre-roll and drop them;
+ */
+- (void) resetState;
+
 @end
@@ -7,18 +7,39 @@
 //
 
 #import "DHOpusDecoder.h"
-#import "opus.h"
+#import "DHOpusUtilities.h"
+#import "opus_multistream.h"
+
+#define OPUS_MAXIMUM_FRAME_DURATION 0.12
 
 @interface DHOpusDecoder ()
 @property (nonatomic, strong) dispatch_queue_t decodeQ;
 @property (nonatomic, strong) NSMutableData *buffer;
 @property (nonatomic, strong) NSMutableData *decodedData;
-@property (nonatomic) OpusDecoder *decoder;
+@property (nonatomic) OpusMSDecoder *decoder;
 @property (nonatomic) int status;
+@property (nonatomic, readwrite) BOOL decodesFloat;
+@property (nonatomic, strong) NSMutableData *pcmBuffer;      //one packet of decoded samples
 @end
 
 @implementation DHOpusDecoder
 
+- (instancetype) initWithAudioFormat:(AudioStreamBasicDescription)format
+                      packetDuration:(float)packetDuration
+                            delegate:(id<DHOpusDecoderDelegate>)delegate
+{
+    self = [self initWithSampleRate:format.mSampleRate
+                   numberOfChannels:format.mChannelsPerFrame
+                     packetDuration:packetDuration
+                           delegate:delegate];
+    if (self) {
+        _decodesFloat = format.mFormatID == kAudioFormatLinearPCM &&
+                        (format.mFormatFlags & kAudioFormatFlagIsFloat) &&
+                        format.mBitsPerChannel == 32;
+    }
+    return self;
+}
+
 - (instancetype) initWithSampleRate:(int)sampleRate
                    numberOfChannels:(int)numberOfChannels
                      packetDuration:(float)packetDuration
@@ -39,14 +60,41 @@
     return self;
 }
 
+- (void) dealloc
+{
+    if (_decoder) {
+        opus_multistream_decoder_destroy(_decoder);
+    }
+}
+
 - (void) setupDecoder
 {
+    if (_decoder) {
+        opus_multistream_decoder_destroy(_decoder);
+        _decoder = NULL;
+    }
+    DHOpusChannelMapping channelMapping;
+    if (!DHOpusChannelMappingForNumberOfChannels(self.numberOfChannels, &channelMapping)) {
+        NSLog(@"Opus supports 1 to 8 channels");
+        self.status = OPUS_BAD_ARG;
+        return;
+    }
     int error;
-    _decoder = opus_decoder_create(self.sampleRate, self.numberOfChannels, &error);
+    _decoder = opus_multistream_decoder_create(self.sampleRate, self.numberOfChannels,
+                                               channelMapping.numberOfStreams, channelMapping.numberOfCoupledStreams, channelMapping.mapping,
+                                               &error);
     if (error != OPUS_OK) {
         NSLog(@"Error while creating opus decoder");
-        self.status = error;
     }
+    self.status = error;
+}
+
+- (dispatch_queue_t) delegateQueue
+{
+    if (_delegateQueue == nil) {
+        _delegateQueue = dispatch_get_main_queue();
+    }
+    return _delegateQueue;
 }
 
 - (void) setSampleRate:(int)sampleRate
@@ -71,39 +119,96 @@
         return;
     }
     dispatch_async(self.decodeQ, ^{
-        [self.buffer appendData:data];
-        uint8_t *bytes = (uint8_t *)[self.buffer bytes];
-        int offset = 0;
-        while (true) {
-            int length = bytes[offset];
-            offset++;
-            if (offset + length > [self.buffer length]) {
-                offset--;
-                break;
-            }
-            uint8_t *opusData = bytes + offset;
-            opus_int16 *pcmBuffer = malloc(640);
-            int decodedSamples = opus_decode(self.decoder, opusData, length, pcmBuffer, 320, 0);
-            if (decodedSamples < 0) {
-                self.status = -1;
-                if ([self.delegate respondsToSelector:@selector(opusDecoder:failToDecodeDataWithError:)]) {
-                    NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"Error while decoding data"}];
-                    dispatch_async(dispatch_get_main_queue(), ^{
-                        [self.delegate opusDecoder:self failToDecodeDataWithError:error];
-                    });
-                }
-                return;
+        NSData *pcmData = [self pcmDataWithOpusData:data];
+        if (pcmData == nil) {
+            if ([self.delegate respondsToSelector:@selector(opusDecoder:failToDecodeDataWithError:)]) {
+                NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"Error while decoding data"}];
+                dispatch_async(self.delegateQueue, ^{
+                    [self.delegate opusDecoder:self failToDecodeDataWithError:error];
+                });
             }
-            NSData *pcmData = [NSData dataWithBytes:pcmBuffer length:decodedSamples * sizeof(opus_int16)];
-            [self.decodedData appendData:pcmData];
-            offset += length;
+            return;
         }
-        self.buffer = [NSMutableData dataWithBytes:bytes + offset length:[self.buffer length] - offset];
-        dispatch_async(dispatch_get_main_queue(), ^{
+        [self.decodedData appendData:pcmData];
+        dispatch_async(self.delegateQueue, ^{
             [self.delegate opusDecoder:self didFinishDecodingWithResultPCMData:self.decodedData];
         });
     });
 }
 
+- (NSData *) pcmDataWithOpusData:(NSData *)data
+{
+    if (self.status != OPUS_OK) {
+        return nil;
+    }
+    //Packets are parsed in place, only a partial packet at the end is copied to wait for the next data
+    const uint8_t *bytes = [data bytes];
+    size_t dataLength = [data length];
+    if ([self.buffer length] > 0) {
+        [self.buffer appendData:data];
+        bytes = [self.buffer bytes];
+        dataLength = [self.buffer length];
+    }
+    NSMutableData *pcmData = [NSMutableData data];
+    size_t offset = 0;
+    while (true) {
+        size_t length = 0;
+        size_t headerLength = DHOpusReadPacketLength(bytes + offset, dataLength - offset, &length);
+        if (headerLength == 0 || offset + headerLength + length > dataLength) {
+            break;
+        }
+        offset += headerLength;
+        int decodedSamples = [self decodePacket:bytes + offset length:(int)length];
+        if (decodedSamples < 0) {
+            self.status = -1;
+            return nil;
+        }
+        size_t sampleSize = self.decodesFloat ? sizeof(float) : sizeof(opus_int16);
+        [pcmData appendBytes:[self.pcmBuffer bytes] length:decodedSamples * self.numberOfChannels * sampleSize];
+        offset += length;
+    }
+    self.buffer = [NSMutableData dataWithBytes:bytes + offset length:dataLength - offset];
+    return pcmData;
+}
+
+- (NSData *) pcmDataWithPacket:(const uint8_t *)packet length:(size_t)length
+{
+    if (self.status != OPUS_OK) {
+        return nil;
+    }
+    int decodedSamples = [self decodePacket:packet length:(int)length];
+    if (decodedSamples < 0) {
+        return nil;
+    }
+    size_t sampleSize = self.decodesFloat ? sizeof(float) : sizeof(opus_int16);
+    return [NSData dataWithBytes:[self.pcmBuffer bytes] length:decodedSamples * self.numberOfChannels * sampleSize];
+}
+
+- (void) resetState
+{
+    if (self.decoder) {
+        opus_multistream_decoder_ctl(self.decoder, OPUS_RESET_STATE);
+    }
+    [self.buffer setLength:0];
+}
+
+/**
+ * Decode one packet into `pcmBuffer`, which holds the longest packet Opus allows;
+ * @return number of samples per channel, or a negative Opus error
+ */
+- (int) decodePacket:(const uint8_t *)packet length:(int)length
+{
+    int maximumFrameSize = self.sampleRate * OPUS_MAXIMUM_FRAME_DURATION;
+    size_t sampleSize = self.decodesFloat ? sizeof(float) : sizeof(opus_int16);
+    size_t pcmBufferSize = maximumFrameSize * self.numberOfChannels * sampleSize;
+    if ([self.pcmBuffer length] != pcmBufferSize) {
+        self.pcmBuffer = [NSMutableData dataWithLength:pcmBufferSize];
+    }
+    if (self.decodesFloat) {
+        return opus_multistream_decode_float(self.decoder, packet, length, [self.pcmBuffer mutableBytes], maximumFrameSize, 0);
+    }
+    return opus_multistream_decode(self.decoder, packet, length, [self.pcmBuffer mutableBytes], maximumFrameSize, 0);
+}
+
 @end
 
@@ -8,6 +8,10 @@
 
 #import "DHAudioFilePlayer.h"
 
+/**
+ * Player for raw Linear PCM in `audioFormat`;
+ * Interleaved frames are played straight from the data (mapped for a file) through the playback engine, so it can be queued in a `DHQueueAudioFilePlayer`, seeks to the frame and starts without parsing anything; Non-interleaved PCM is played by AVAudioPlayer from a WAV;
+ */
 @interface DHPCMAudioFilePlayer : DHAudioFilePlayer
 
 @end
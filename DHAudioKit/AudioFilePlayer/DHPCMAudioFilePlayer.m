@@ -9,29 +9,94 @@
 #import "DHPCMAudioFilePlayer.h"
 #import <AudioToolbox/AudioToolbox.h>
 
+static const NSUInteger kFramesPerRead = 4096;
+
+@interface DHPCMAudioFilePlayer ()
+@property (nonatomic, strong) NSData *pcmData;
+@property (nonatomic) NSUInteger pcmOffset;
+@end
+
 @implementation DHPCMAudioFilePlayer
 
-- (NSData *) playableDataWithData:(NSData *)data
+- (void) setupPlayerWithFile:(NSString *)filePath
 {
-    char path[256];
-    NSString *filePath = [[NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) firstObject]
-                          stringByAppendingString:@"/temp_pcm_intermidate.wav"];
-    [filePath getCString:path maxLength:256 encoding:NSUTF8StringEncoding];
-    
-    if ([[NSFileManager defaultManager] fileExistsAtPath:filePath]) {
-        [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    [self setupPlayerWithPCMData:[[self class] mappedDataWithContentsOfFile:filePath]];
+}
+
+- (void) setupPlayerWithData:(NSData *)data
+{
+    [self setupPlayerWithPCMData:data];
+}
+
+/**
+ * The frames are already what the output plays, so they are pulled straight into the playback engine, without a WAV for AVAudioPlayer to parse again;
+ * Only non-interleaved PCM, which the engine does not take, still goes through AVAudioPlayer;
+ */
+- (void) setupPlayerWithPCMData:(NSData *)data
+{
+    AudioStreamBasicDescription format = self.audioFormat;
+    if (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) {
+        [self updateWithPlayableData:[self playableDataWithData:data]];
+        return;
+    }
+    if (data == nil || format.mBytesPerFrame == 0) {
+        [self failPreparingWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"Error while reading PCM data"}]];
+        return;
     }
+    self.pcmData = data;
+    [self setupPlaybackEngineWithFormat:format numberOfFrames:[data length] / format.mBytesPerFrame];
+}
+
+#pragma mark - Decoding While Playing
+- (NSData *) nextPCMData
+{
+    UInt32 bytesPerFrame = self.audioFormat.mBytesPerFrame;
+    NSUInteger length = MIN([self.pcmData length] / bytesPerFrame * bytesPerFrame - self.pcmOffset, kFramesPerRead * bytesPerFrame);
+    //Not copied, the engine copies the frames before the next read
+    NSData *pcmData = [NSData dataWithBytesNoCopy:(void *)((const uint8_t *)[self.pcmData bytes] + self.pcmOffset) length:length freeWhenDone:NO];
+    self.pcmOffset += length;
+    return pcmData;
+}
+
+- (void) seekToFrame:(UInt64)frame
+{
+    UInt32 bytesPerFrame = self.audioFormat.mBytesPerFrame;
+    self.pcmOffset = (NSUInteger)MIN(frame * bytesPerFrame, [self.pcmData length] / bytesPerFrame * bytesPerFrame);
+}
+
+#pragma mark - Non-interleaved PCM
+- (NSData *) playableDataWithData:(NSData *)data
+{
+    //A file of its own for every preparation, as they may run at the same time on a concurrent `preparationQueue`
+    NSString *fileName = [NSString stringWithFormat:@"pcm_intermediate_%@.wav", [[NSUUID UUID] UUIDString]];
+    NSString *filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:fileName];
     
     AudioFileID audioFile;
     AudioStreamBasicDescription mDataFormat = self.audioFormat;
     
-    CFURLRef audioFileURL = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *)path, strlen(path), false);
-    AudioFileCreateWithURL(audioFileURL, kAudioFileWAVEType, &mDataFormat, kAudioFileFlags_EraseFile, &audioFile);
+    NSURL *audioFileURL = [NSURL fileURLWithPath:filePath];
+    if (AudioFileCreateWithURL((__bridge CFURLRef)audioFileURL, kAudioFileWAVEType, &mDataFormat, kAudioFileFlags_EraseFile, &audioFile) != noErr) {
+        return nil;
+    }
     UInt32 fileLength = (UInt32)[data length];
     AudioFileWriteBytes(audioFile, false, 0, &fileLength, [data bytes]);
     AudioFileClose(audioFile);
     
-    return [NSData dataWithContentsOfFile:filePath];
+    //The mapping outlives the file's name, so the file is removed right away and its space freed with the data
+    NSData *playableData = [[self class] mappedDataWithContentsOfFile:filePath];
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    return playableData;
+}
+
+#pragma mark - Streaming
+- (NSData *) pcmDataWithAppendedData:(NSData *)data
+{
+    return data;
+}
+
+- (AudioStreamBasicDescription) streamingPCMFormat
+{
+    return self.audioFormat;
 }
 
 @end
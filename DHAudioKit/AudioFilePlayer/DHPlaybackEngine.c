@@ -0,0 +1,332 @@
+//
+//  DHPlaybackEngine.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "DHPlaybackEngine.h"
+
+// Set up
+
+int DHPlaybackEngineInit(DHPlaybackEngine *engine, size_t bytesPerFrame, size_t capacity, size_t preBufferFrames)
+{
+    memset(engine, 0, sizeof(DHPlaybackEngine));
+    if (bytesPerFrame == 0 || capacity == 0) {
+        return 0;
+    }
+    engine->bytes = malloc(bytesPerFrame * capacity);
+    if (engine->bytes == NULL) {
+        return 0;
+    }
+    engine->bytesPerFrame = bytesPerFrame;
+    engine->capacity = capacity;
+    engine->preBufferFrames = preBufferFrames < capacity ? preBufferFrames : capacity;
+    atomic_store(&engine->rate, 1.0f);
+    DHPlaybackEngineReset(engine, 0);
+    return 1;
+}
+
+void DHPlaybackEngineDestroy(DHPlaybackEngine *engine)
+{
+    free(engine->bytes);
+    DHTimeStretchDestroy(&engine->stretch);
+    memset(engine, 0, sizeof(DHPlaybackEngine));
+}
+
+int DHPlaybackEngineSetupTimeStretch(DHPlaybackEngine *engine, int numberOfChannels, int isFloat, double sampleRate)
+{
+    DHTimeStretchDestroy(&engine->stretch);
+    if (numberOfChannels <= 0 || engine->bytesPerFrame != (size_t)numberOfChannels * (isFloat ? sizeof(float) : sizeof(int16_t))) {
+        return 0;
+    }
+    return DHTimeStretchInit(&engine->stretch, numberOfChannels, isFloat, sampleRate);
+}
+
+void DHPlaybackEngineReset(DHPlaybackEngine *engine, uint64_t startFrame)
+{
+    engine->startFrame = startFrame;
+    atomic_store(&engine->numberOfFramesWritten, 0);
+    atomic_store(&engine->numberOfFramesRead, 0);
+    atomic_store(&engine->endOfStream, 0);
+    atomic_store(&engine->state, DHPlaybackEngineStateBuffering);
+    atomic_store(&engine->numberOfFramesRendered, 0);
+    atomic_store(&engine->numberOfUnderruns, 0);
+    engine->isStretching = 0;
+    engine->stretchStartFrame = 0;
+}
+
+// Producer
+
+size_t DHPlaybackEngineAvailableFrames(const DHPlaybackEngine *engine)
+{
+    return engine->capacity - DHPlaybackEngineBufferedFrames(engine);
+}
+
+size_t DHPlaybackEngineWrite(DHPlaybackEngine *engine, const void *bytes, size_t numberOfFrames)
+{
+    size_t available = DHPlaybackEngineAvailableFrames(engine);
+    if (numberOfFrames > available) {
+        numberOfFrames = available;
+    }
+    if (numberOfFrames == 0) {
+        return 0;
+    }
+    size_t written = atomic_load_explicit(&engine->numberOfFramesWritten, memory_order_relaxed);
+    size_t writeIndex = written % engine->capacity;
+    size_t firstPart = engine->capacity - writeIndex;
+    if (firstPart > numberOfFrames) {
+        firstPart = numberOfFrames;
+    }
+    memcpy(engine->bytes + writeIndex * engine->bytesPerFrame, bytes, firstPart * engine->bytesPerFrame);
+    memcpy(engine->bytes, (const uint8_t *)bytes + firstPart * engine->bytesPerFrame, (numberOfFrames - firstPart) * engine->bytesPerFrame);
+    //Publish the frames only after they are copied
+    atomic_store_explicit(&engine->numberOfFramesWritten, written + numberOfFrames, memory_order_release);
+    return numberOfFrames;
+}
+
+void DHPlaybackEngineFinish(DHPlaybackEngine *engine)
+{
+    atomic_store_explicit(&engine->endOfStream, 1, memory_order_release);
+}
+
+// Consumer
+
+size_t DHPlaybackEngineBufferedFrames(const DHPlaybackEngine *engine)
+{
+    size_t written = atomic_load_explicit(&engine->numberOfFramesWritten, memory_order_acquire);
+    size_t read = atomic_load_explicit(&engine->numberOfFramesRead, memory_order_acquire);
+    return written - read;
+}
+
+DHPlaybackEngineState DHPlaybackEngineGetState(const DHPlaybackEngine *engine)
+{
+    return (DHPlaybackEngineState)atomic_load_explicit(&engine->state, memory_order_acquire);
+}
+
+static size_t DHPlaybackEngineReadFrames(DHPlaybackEngine *engine, uint8_t *output, size_t numberOfFrames)
+{
+    size_t read = atomic_load_explicit(&engine->numberOfFramesRead, memory_order_relaxed);
+    size_t readIndex = read % engine->capacity;
+    size_t firstPart = engine->capacity - readIndex;
+    if (firstPart > numberOfFrames) {
+        firstPart = numberOfFrames;
+    }
+    memcpy(output, engine->bytes + readIndex * engine->bytesPerFrame, firstPart * engine->bytesPerFrame);
+    memcpy(output + firstPart * engine->bytesPerFrame, engine->bytes, (numberOfFrames - firstPart) * engine->bytesPerFrame);
+    //Hand the space back to the producer only after the frames are copied out
+    atomic_store_explicit(&engine->numberOfFramesRead, read + numberOfFrames, memory_order_release);
+    return numberOfFrames;
+}
+
+static void DHPlaybackEngineReadIntoTimeStretch(DHPlaybackEngine *engine, size_t numberOfFrames)
+{
+    size_t read = atomic_load_explicit(&engine->numberOfFramesRead, memory_order_relaxed);
+    size_t readIndex = read % engine->capacity;
+    size_t firstPart = engine->capacity - readIndex;
+    if (firstPart > numberOfFrames) {
+        firstPart = numberOfFrames;
+    }
+    DHTimeStretchWrite(&engine->stretch, engine->bytes + readIndex * engine->bytesPerFrame, firstPart);
+    DHTimeStretchWrite(&engine->stretch, engine->bytes, numberOfFrames - firstPart);
+    atomic_store_explicit(&engine->numberOfFramesRead, read + numberOfFrames, memory_order_release);
+}
+
+//Render through the time stretch, until it hands back to plain rendering once the rate is 1 again; Moves `numberOfFramesRendered` itself
+static size_t DHPlaybackEngineRenderStretched(DHPlaybackEngine *engine, uint8_t *output, size_t numberOfFrames, int endOfStream, float rate)
+{
+    DHTimeStretch *stretch = &engine->stretch;
+    if (!engine->isStretching) {
+        DHTimeStretchReset(stretch);
+        engine->stretchStartFrame = atomic_load_explicit(&engine->numberOfFramesRendered, memory_order_relaxed);
+        engine->isStretching = 1;
+    }
+    size_t rendered = 0;
+    while (rendered < numberOfFrames) {
+        rendered += DHTimeStretchRead(stretch, output + rendered * engine->bytesPerFrame, numberOfFrames - rendered);
+        if (rendered == numberOfFrames) {
+            break;
+        }
+        if (rate == 1.0f) {
+            //Play out the input the time stretch took from the ring, then go on from the ring
+            if (DHTimeStretchDrain(stretch) > 0) {
+                continue;
+            }
+            engine->isStretching = 0;
+            break;
+        }
+        size_t needed = DHTimeStretchNumberOfFramesNeeded(stretch);
+        size_t buffered = DHPlaybackEngineBufferedFrames(engine);
+        DHPlaybackEngineReadIntoTimeStretch(engine, buffered < needed ? buffered : needed);
+        if (buffered < needed) {
+            if (endOfStream && DHTimeStretchDrain(stretch) > 0) {
+                continue;
+            }
+            break;
+        }
+        DHTimeStretchProcess(stretch, rate);
+    }
+    atomic_store_explicit(&engine->numberOfFramesRendered, engine->stretchStartFrame + (uint64_t)DHTimeStretchPosition(stretch), memory_order_relaxed);
+    return rendered;
+}
+
+size_t DHPlaybackEngineRender(DHPlaybackEngine *engine, void *output, size_t numberOfFrames)
+{
+    //Read the end of stream first, so every frame written before `DHPlaybackEngineFinish` is counted below
+    int endOfStream = atomic_load_explicit(&engine->endOfStream, memory_order_acquire);
+    size_t buffered = DHPlaybackEngineBufferedFrames(engine);
+    int state = atomic_load_explicit(&engine->state, memory_order_relaxed);
+
+    if (state == DHPlaybackEngineStateBuffering && (buffered >= engine->preBufferFrames || endOfStream)) {
+        state = DHPlaybackEngineStateRendering;
+    }
+    size_t rendered = 0;
+    if (state == DHPlaybackEngineStateRendering) {
+        float rate = atomic_load_explicit(&engine->rate, memory_order_relaxed);
+        if (engine->isStretching || rate != 1.0f) {
+            rendered = DHPlaybackEngineRenderStretched(engine, output, numberOfFrames, endOfStream, rate);
+        }
+        if (!engine->isStretching && rendered < numberOfFrames) {
+            buffered = DHPlaybackEngineBufferedFrames(engine);
+            size_t read = DHPlaybackEngineReadFrames(engine, (uint8_t *)output + rendered * engine->bytesPerFrame, buffered < numberOfFrames - rendered ? buffered : numberOfFrames - rendered);
+            atomic_fetch_add_explicit(&engine->numberOfFramesRendered, read, memory_order_relaxed);
+            rendered += read;
+        }
+        if (rendered < numberOfFrames) {
+            if (endOfStream) {
+                state = DHPlaybackEngineStateFinished;
+            } else {
+                state = DHPlaybackEngineStateBuffering;
+                atomic_fetch_add_explicit(&engine->numberOfUnderruns, 1, memory_order_relaxed);
+            }
+        }
+    }
+    memset((uint8_t *)output + rendered * engine->bytesPerFrame, 0, (numberOfFrames - rendered) * engine->bytesPerFrame);
+    atomic_store_explicit(&engine->state, state, memory_order_release);
+    return rendered;
+}
+
+uint64_t DHPlaybackEngineRenderPosition(const DHPlaybackEngine *engine)
+{
+    return engine->startFrame + atomic_load_explicit(&engine->numberOfFramesRendered, memory_order_relaxed);
+}
+
+// Rate
+
+void DHPlaybackEngineSetRate(DHPlaybackEngine *engine, float rate)
+{
+    if (engine->stretch.window == NULL) {
+        rate = 1;
+    }
+    if (rate < DHTIMESTRETCH_MINIMUM_RATE) {
+        rate = DHTIMESTRETCH_MINIMUM_RATE;
+    }
+    if (rate > DHTIMESTRETCH_MAXIMUM_RATE) {
+        rate = DHTIMESTRETCH_MAXIMUM_RATE;
+    }
+    atomic_store_explicit(&engine->rate, rate, memory_order_relaxed);
+}
+
+float DHPlaybackEngineGetRate(const DHPlaybackEngine *engine)
+{
+    return atomic_load_explicit(&engine->rate, memory_order_relaxed);
+}
+
+// Clock
+
+void DHPlaybackClockReset(DHPlaybackClock *clock)
+{
+    memset(clock->entries, 0, sizeof(clock->entries));
+    atomic_store(&clock->sequence, 0);
+    atomic_store(&clock->numberOfEntries, 0);
+    clock->nextStartTime = 0;
+}
+
+void DHPlaybackClockScheduleBuffer(DHPlaybackClock *clock, uint64_t firstFrame, uint32_t numberOfStreamFrames, uint32_t numberOfFrames, uint32_t length)
+{
+    uint32_t sequence = atomic_load_explicit(&clock->sequence, memory_order_relaxed);
+    uint32_t numberOfEntries = atomic_load_explicit(&clock->numberOfEntries, memory_order_relaxed);
+    //A seqlock: readers retry while the sequence is odd or changed under them
+    atomic_store_explicit(&clock->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    DHPlaybackClockEntry *entry = &clock->entries[numberOfEntries % DHPLAYBACK_CLOCK_CAPACITY];
+    entry->startTime = clock->nextStartTime;
+    entry->firstFrame = firstFrame;
+    entry->numberOfFrames = numberOfFrames;
+    entry->numberOfStreamFrames = numberOfStreamFrames;
+    atomic_store_explicit(&clock->numberOfEntries, numberOfEntries + 1, memory_order_relaxed);
+    atomic_store_explicit(&clock->sequence, sequence + 2, memory_order_release);
+    clock->nextStartTime += length;
+}
+
+int DHPlaybackClockFrameAtTime(DHPlaybackClock *clock, double time, uint64_t *frame)
+{
+    DHPlaybackClockEntry entries[DHPLAYBACK_CLOCK_CAPACITY];
+    uint32_t numberOfEntries;
+    uint32_t sequence;
+    while (1) {
+        sequence = atomic_load_explicit(&clock->sequence, memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        numberOfEntries = atomic_load_explicit(&clock->numberOfEntries, memory_order_relaxed);
+        memcpy(entries, clock->entries, sizeof(entries));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&clock->sequence, memory_order_relaxed) == sequence) {
+            break;
+        }
+    }
+    if (numberOfEntries == 0) {
+        return 0;
+    }
+    uint32_t numberOfKeptEntries = numberOfEntries < DHPLAYBACK_CLOCK_CAPACITY ? numberOfEntries : DHPLAYBACK_CLOCK_CAPACITY;
+    //The newest buffer that started by `time`, or the oldest one kept when `time` is before all of them
+    const DHPlaybackClockEntry *entry = &entries[(numberOfEntries - numberOfKeptEntries) % DHPLAYBACK_CLOCK_CAPACITY];
+    for (uint32_t i = numberOfEntries; i > numberOfEntries - numberOfKeptEntries; i--) {
+        const DHPlaybackClockEntry *candidate = &entries[(i - 1) % DHPLAYBACK_CLOCK_CAPACITY];
+        if (candidate->startTime <= time) {
+            entry = candidate;
+            break;
+        }
+    }
+    double elapsed = time - entry->startTime;
+    if (elapsed < 0) {
+        elapsed = 0;
+    }
+    if (elapsed > entry->numberOfFrames) {
+        elapsed = entry->numberOfFrames;
+    }
+    //Frames of the stream go by at the rate they were rendered at
+    if (entry->numberOfFrames > 0) {
+        elapsed *= (double)entry->numberOfStreamFrames / entry->numberOfFrames;
+    }
+    *frame = entry->firstFrame + (uint64_t)elapsed;
+    return 1;
+}
+
+// Scrubbing
+
+void DHPlaybackGrainApplyEnvelope(void *bytes, size_t numberOfFrames, int numberOfChannels, int isFloat, size_t fadeFrames)
+{
+    if (fadeFrames > numberOfFrames / 2) {
+        fadeFrames = numberOfFrames / 2;
+    }
+    for (size_t i = 0; i < fadeFrames; i++) {
+        float gain = (float)i / (float)fadeFrames;
+        size_t head = i * numberOfChannels;
+        size_t tail = (numberOfFrames - 1 - i) * numberOfChannels;
+        for (int channel = 0; channel < numberOfChannels; channel++) {
+            if (isFloat) {
+                ((float *)bytes)[head + channel] *= gain;
+                ((float *)bytes)[tail + channel] *= gain;
+            } else {
+                ((int16_t *)bytes)[head + channel] = (int16_t)(((int16_t *)bytes)[head + channel] * gain);
+                ((int16_t *)bytes)[tail + channel] = (int16_t)(((int16_t *)bytes)[tail + channel] * gain);
+            }
+        }
+    }
+}
@@ -0,0 +1,165 @@
+//
+//  DHPlaybackEngine.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHPlaybackEngine_h
+#define DHPlaybackEngine_h
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DHTimeStretch.h"
+
+/**
+ * The portable core of streaming playback: a fixed size ring of decoded PCM frames between one producer (the decoder) and one consumer (the output callback);
+ * The producer writes whatever it decodes, the output pulls frames with `DHPlaybackEngineRender`; Neither side locks, so the render call is safe on a real-time audio thread;
+ * Rendering holds silence until `preBufferFrames` are buffered, and goes back to buffering after an underrun, so a slow download is heard as a pause rather than as crackles;
+ * With a time stretch set up, frames are rendered at `rate` through a `DHTimeStretch` on the render side, so a new rate is heard from the next buffer on;
+ */
+typedef enum {
+    DHPlaybackEngineStateBuffering,
+    DHPlaybackEngineStateRendering,
+    DHPlaybackEngineStateFinished,
+} DHPlaybackEngineState;
+
+typedef struct {
+    uint8_t *bytes;
+    size_t capacity;                        //in frames
+    size_t bytesPerFrame;
+    size_t preBufferFrames;
+    uint64_t startFrame;                    //position in the stream of the first frame written after a reset
+    _Atomic size_t numberOfFramesWritten;
+    _Atomic size_t numberOfFramesRead;
+    _Atomic int endOfStream;
+    _Atomic int state;
+    _Atomic uint64_t numberOfFramesRendered;        //frames of the stream, the time stretch may render more or less
+    _Atomic uint64_t numberOfUnderruns;
+    _Atomic float rate;
+    DHTimeStretch stretch;
+    int isStretching;                               //only touched by the consumer, and by a reset
+    uint64_t stretchStartFrame;                     //`numberOfFramesRendered` when the time stretch took over
+} DHPlaybackEngine;
+
+// Set up
+
+/**
+ * @param capacity number of frames the ring holds
+ * @param preBufferFrames frames needed before rendering starts, clamped to `capacity`
+ * @return 0 if the allocation fails
+ */
+int DHPlaybackEngineInit(DHPlaybackEngine *engine, size_t bytesPerFrame, size_t capacity, size_t preBufferFrames);
+
+void DHPlaybackEngineDestroy(DHPlaybackEngine *engine);
+
+/**
+ * Allow rendering at another rate than 1 (see `DHPlaybackEngineSetRate`), for frames of interleaved 16-bit or 32-bit float samples; Call it before rendering starts;
+ * @return 0 if the format does not match `bytesPerFrame` or the allocation fails, the engine then renders at rate 1
+ */
+int DHPlaybackEngineSetupTimeStretch(DHPlaybackEngine *engine, int numberOfChannels, int isFloat, double sampleRate);
+
+/**
+ * Drop the buffered frames and start buffering again, the next frame written being frame `startFrame` of the stream; Only call it while neither side is running;
+ */
+void DHPlaybackEngineReset(DHPlaybackEngine *engine, uint64_t startFrame);
+
+// Producer
+
+/**
+ * Copy whole frames from `bytes` into the ring;
+ * @return number of frames written, less than `numberOfFrames` when the ring is full
+ */
+size_t DHPlaybackEngineWrite(DHPlaybackEngine *engine, const void *bytes, size_t numberOfFrames);
+
+/**
+ * Number of frames that can be written without overwriting unrendered frames;
+ */
+size_t DHPlaybackEngineAvailableFrames(const DHPlaybackEngine *engine);
+
+/**
+ * No more frames will be written; Whatever is buffered is rendered even below the pre-buffer, then the engine finishes;
+ */
+void DHPlaybackEngineFinish(DHPlaybackEngine *engine);
+
+// Consumer
+
+/**
+ * Fill `output` with `numberOfFrames` frames, padding with silence while buffering or after the stream finished;
+ * @return number of frames of audio, the rest of `output` is silence
+ */
+size_t DHPlaybackEngineRender(DHPlaybackEngine *engine, void *output, size_t numberOfFrames);
+
+/**
+ * Number of frames written but not rendered yet;
+ */
+size_t DHPlaybackEngineBufferedFrames(const DHPlaybackEngine *engine);
+
+DHPlaybackEngineState DHPlaybackEngineGetState(const DHPlaybackEngine *engine);
+
+/**
+ * Position in the stream of the next frame `DHPlaybackEngineRender` returns: `startFrame` plus the frames of audio rendered since the reset;
+ */
+uint64_t DHPlaybackEngineRenderPosition(const DHPlaybackEngine *engine);
+
+// Rate
+
+/**
+ * Speed to render at, pitch kept, clamped between `DHTIMESTRETCH_MINIMUM_RATE` and `DHTIMESTRETCH_MAXIMUM_RATE`; Any thread may set it;
+ * Rendering goes back to 1 without a jump, by playing out what the time stretch holds;
+ */
+void DHPlaybackEngineSetRate(DHPlaybackEngine *engine, float rate);
+
+float DHPlaybackEngineGetRate(const DHPlaybackEngine *engine);
+
+// Clock
+
+#define DHPLAYBACK_CLOCK_CAPACITY 8
+
+typedef struct {
+    double startTime;               //on the output's timeline, in frames
+    uint64_t firstFrame;            //position in the stream of its first frame
+    uint32_t numberOfFrames;        //frames of audio, the rest of the buffer was silence
+    uint32_t numberOfStreamFrames;  //frames of the stream they were rendered from, more or less than `numberOfFrames` at another rate
+} DHPlaybackClockEntry;
+
+/**
+ * The position that is heard, rather than the one that is rendered: the output schedules every buffer it renders, and its own timeline (e.g. the sample time of an AudioQueue) then tells which frame is playing;
+ * Rendering runs a few buffers ahead of the speaker, silence padded in while buffering does not move the position, and a paused output stops its timeline, so pauses and seeks need no bookkeeping;
+ * Buffers are assumed to play back to back from time 0, which holds for an output that always enqueues whole buffers; The last `DHPLAYBACK_CLOCK_CAPACITY` buffers are kept;
+ * One thread schedules, any thread reads; Neither side locks;
+ */
+typedef struct {
+    DHPlaybackClockEntry entries[DHPLAYBACK_CLOCK_CAPACITY];
+    _Atomic uint32_t sequence;              //odd while an entry is written
+    _Atomic uint32_t numberOfEntries;       //entries ever scheduled
+    double nextStartTime;
+} DHPlaybackClock;
+
+/**
+ * Forget the scheduled buffers, for an output whose timeline starts again at 0;
+ */
+void DHPlaybackClockReset(DHPlaybackClock *clock);
+
+/**
+ * Schedule the next buffer of `length` frames, whose first `numberOfFrames` are audio rendered from `numberOfStreamFrames` frames at position `firstFrame`, e.g. from `DHPlaybackEngineRenderPosition` before and after `DHPlaybackEngineRender`;
+ */
+void DHPlaybackClockScheduleBuffer(DHPlaybackClock *clock, uint64_t firstFrame, uint32_t numberOfStreamFrames, uint32_t numberOfFrames, uint32_t length);
+
+/**
+ * The position playing at `time` on the output's timeline;
+ * @return 0 if no buffer was scheduled
+ */
+int DHPlaybackClockFrameAtTime(DHPlaybackClock *clock, double time, uint64_t *frame);
+
+// Scrubbing
+
+/**
+ * Fade `fadeFrames` in and out of a grain of interleaved 16-bit or 32-bit float samples, so grains played one after another do not click;
+ */
+void DHPlaybackGrainApplyEnvelope(void *bytes, size_t numberOfFrames, int numberOfChannels, int isFloat, size_t fadeFrames);
+
+#endif /* DHPlaybackEngine_h */
@@ -0,0 +1,195 @@
+//
+//  DHPlaybackSink.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DHPlaybackSink.h"
+
+#define DHPLAYBACK_SINK_WAV_HEADER_LENGTH 44
+
+// WAV File
+
+static void DHPlaybackSinkWriteUInt32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+    bytes[2] = (value >> 16) & 0xff;
+    bytes[3] = (value >> 24) & 0xff;
+}
+
+static void DHPlaybackSinkWriteUInt16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+}
+
+//A canonical 44-byte header: RIFF, a 16-byte fmt chunk and the data chunk; See: http://soundfile.sapp.org/doc/WaveFormat/
+static int DHPlaybackSinkWriteWAVHeader(DHPlaybackSink *sink, uint64_t numberOfFrames)
+{
+    uint64_t dataLength = numberOfFrames * sink->bytesPerFrame;
+    if (dataLength > UINT32_MAX - DHPLAYBACK_SINK_WAV_HEADER_LENGTH) {
+        dataLength = UINT32_MAX - DHPLAYBACK_SINK_WAV_HEADER_LENGTH;
+    }
+    uint8_t header[DHPLAYBACK_SINK_WAV_HEADER_LENGTH];
+    memcpy(header, "RIFF", 4);
+    DHPlaybackSinkWriteUInt32(header + 4, (uint32_t)(DHPLAYBACK_SINK_WAV_HEADER_LENGTH - 8 + dataLength));
+    memcpy(header + 8, "WAVEfmt ", 8);
+    DHPlaybackSinkWriteUInt32(header + 16, 16);
+    DHPlaybackSinkWriteUInt16(header + 20, sink->format.isFloat ? 3 : 1);
+    DHPlaybackSinkWriteUInt16(header + 22, (uint16_t)sink->format.numberOfChannels);
+    DHPlaybackSinkWriteUInt32(header + 24, (uint32_t)sink->format.sampleRate);
+    DHPlaybackSinkWriteUInt32(header + 28, (uint32_t)(sink->format.sampleRate * sink->bytesPerFrame));
+    DHPlaybackSinkWriteUInt16(header + 32, (uint16_t)sink->bytesPerFrame);
+    DHPlaybackSinkWriteUInt16(header + 34, (uint16_t)sink->format.bitsPerChannel);
+    memcpy(header + 36, "data", 4);
+    DHPlaybackSinkWriteUInt32(header + 40, (uint32_t)dataLength);
+    return fseek(sink->file, 0, SEEK_SET) == 0 && fwrite(header, sizeof(header), 1, sink->file) == 1;
+}
+
+// Set up
+
+int DHPlaybackSinkOpen(DHPlaybackSink *sink, DHPlaybackEngine *engine, DHPlaybackSinkFormat format, size_t framesPerBuffer, const char *path)
+{
+    memset(sink, 0, sizeof(DHPlaybackSink));
+    size_t bytesPerFrame = (size_t)format.numberOfChannels * format.bitsPerChannel / 8;
+    if (bytesPerFrame == 0 || bytesPerFrame != engine->bytesPerFrame || framesPerBuffer == 0 || format.sampleRate <= 0) {
+        return 0;
+    }
+    sink->engine = engine;
+    sink->format = format;
+    sink->bytesPerFrame = bytesPerFrame;
+    sink->framesPerBuffer = framesPerBuffer;
+    sink->buffer = malloc(framesPerBuffer * bytesPerFrame);
+    if (sink->buffer == NULL) {
+        return 0;
+    }
+    if (path) {
+        sink->file = fopen(path, "wb");
+        //The sizes are filled in when the sink is closed
+        if (sink->file == NULL || !DHPlaybackSinkWriteWAVHeader(sink, 0)) {
+            DHPlaybackSinkClose(sink);
+            return 0;
+        }
+    }
+    DHPlaybackClockReset(&sink->clock);
+    return 1;
+}
+
+void DHPlaybackSinkClose(DHPlaybackSink *sink)
+{
+    DHPlaybackSinkStop(sink);
+    if (sink->file) {
+        DHPlaybackSinkWriteWAVHeader(sink, atomic_load(&sink->numberOfFramesWritten));
+        fclose(sink->file);
+    }
+    free(sink->buffer);
+    memset(sink, 0, sizeof(DHPlaybackSink));
+}
+
+void DHPlaybackSinkSetRenderCallback(DHPlaybackSink *sink, DHPlaybackSinkRenderCallback renderCallback, void *context)
+{
+    sink->renderCallback = renderCallback;
+    sink->context = context;
+}
+
+// Rendering
+
+size_t DHPlaybackSinkRenderBuffer(DHPlaybackSink *sink)
+{
+    if (atomic_load_explicit(&sink->isFinished, memory_order_acquire)) {
+        return 0;
+    }
+    size_t numberOfFrames = sink->framesPerBuffer;
+    uint64_t firstFrame = DHPlaybackEngineRenderPosition(sink->engine);
+    size_t rendered = DHPlaybackEngineRender(sink->engine, sink->buffer, numberOfFrames);
+    if (DHPlaybackEngineGetState(sink->engine) == DHPlaybackEngineStateFinished) {
+        //Do not pad the last buffer with silence
+        numberOfFrames = rendered;
+        if (rendered == 0) {
+            atomic_store_explicit(&sink->isFinished, 1, memory_order_release);
+            return 0;
+        }
+    }
+    uint32_t numberOfStreamFrames = (uint32_t)(DHPlaybackEngineRenderPosition(sink->engine) - firstFrame);
+    DHPlaybackClockScheduleBuffer(&sink->clock, firstFrame, numberOfStreamFrames, (uint32_t)rendered, (uint32_t)numberOfFrames);
+    if (sink->file) {
+        fwrite(sink->buffer, sink->bytesPerFrame, numberOfFrames, sink->file);
+    }
+    atomic_fetch_add_explicit(&sink->numberOfFramesWritten, numberOfFrames, memory_order_release);
+    if (sink->renderCallback) {
+        sink->renderCallback(sink->context);
+    }
+    return numberOfFrames;
+}
+
+static void *DHPlaybackSinkRun(void *argument)
+{
+    DHPlaybackSink *sink = argument;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long bufferDuration = (long)(sink->framesPerBuffer * 1e9 / sink->format.sampleRate);
+    while (atomic_load_explicit(&sink->isRunning, memory_order_acquire)) {
+        if (DHPlaybackSinkRenderBuffer(sink) == 0) {
+            break;
+        }
+        if (sink->isRealTime) {
+            //Against a deadline rather than for a duration, so the time spent rendering does not add up
+            deadline.tv_nsec += bufferDuration;
+            while (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_nsec -= 1000000000L;
+                deadline.tv_sec++;
+            }
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long remaining = (long long)(deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+            if (remaining > 0) {
+                //nanosleep rather than clock_nanosleep, which Darwin does not have
+                struct timespec duration = {(time_t)(remaining / 1000000000LL), (long)(remaining % 1000000000LL)};
+                nanosleep(&duration, NULL);
+            }
+        }
+    }
+    return NULL;
+}
+
+int DHPlaybackSinkStart(DHPlaybackSink *sink, int isRealTime)
+{
+    if (sink->hasThread) {
+        return 1;
+    }
+    sink->isRealTime = isRealTime;
+    atomic_store(&sink->isRunning, 1);
+    if (pthread_create(&sink->thread, NULL, DHPlaybackSinkRun, sink) != 0) {
+        atomic_store(&sink->isRunning, 0);
+        return 0;
+    }
+    sink->hasThread = 1;
+    return 1;
+}
+
+void DHPlaybackSinkStop(DHPlaybackSink *sink)
+{
+    if (!sink->hasThread) {
+        return;
+    }
+    atomic_store(&sink->isRunning, 0);
+    pthread_join(sink->thread, NULL);
+    sink->hasThread = 0;
+}
+
+int DHPlaybackSinkIsFinished(const DHPlaybackSink *sink)
+{
+    return atomic_load_explicit(&sink->isFinished, memory_order_acquire);
+}
+
+int DHPlaybackSinkGetCurrentFrame(DHPlaybackSink *sink, uint64_t *frame)
+{
+    return DHPlaybackClockFrameAtTime(&sink->clock, (double)atomic_load_explicit(&sink->numberOfFramesWritten, memory_order_acquire), frame);
+}
@@ -0,0 +1,94 @@
+//
+//  DHPlaybackSink.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHPlaybackSink_h
+#define DHPlaybackSink_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "DHPlaybackEngine.h"
+
+/**
+ * An output for a `DHPlaybackEngine` without an audio device, the portable counterpart of `DHAudioQueueOutput`: it pulls buffers the way an output callback does and writes them to a WAV file, or drops them (the null sink);
+ * It runs the engine's render side exactly as a device would, clock included, so playback can be rendered, checked and timed anywhere, e.g. on a Linux build machine;
+ * The timeline of the sink is the frames it has written: a written frame counts as heard;
+ */
+typedef struct {
+    double sampleRate;
+    int numberOfChannels;
+    int bitsPerChannel;
+    int isFloat;
+} DHPlaybackSinkFormat;
+
+/**
+ * Called on the rendering thread after every buffer, so the producer can refill the engine;
+ */
+typedef void (*DHPlaybackSinkRenderCallback)(void *context);
+
+typedef struct {
+    DHPlaybackEngine *engine;
+    DHPlaybackSinkFormat format;
+    size_t bytesPerFrame;
+    size_t framesPerBuffer;
+    uint8_t *buffer;
+    FILE *file;                             //NULL for the null sink
+    DHPlaybackClock clock;
+    _Atomic uint64_t numberOfFramesWritten;
+    DHPlaybackSinkRenderCallback renderCallback;
+    void *context;
+    pthread_t thread;
+    int hasThread;
+    int isRealTime;
+    _Atomic int isRunning;
+    _Atomic int isFinished;
+} DHPlaybackSink;
+
+/**
+ * @param engine not owned, it has to outlive the sink; Its frames have to be in `format`
+ * @param framesPerBuffer frames pulled per buffer, as an output callback would
+ * @param path the WAV file to write, NULL for the null sink
+ * @return 0 if the format does not match the engine, the file can not be created or the allocation fails
+ */
+int DHPlaybackSinkOpen(DHPlaybackSink *sink, DHPlaybackEngine *engine, DHPlaybackSinkFormat format, size_t framesPerBuffer, const char *path);
+
+/**
+ * Stop, and finish the WAV file;
+ */
+void DHPlaybackSinkClose(DHPlaybackSink *sink);
+
+void DHPlaybackSinkSetRenderCallback(DHPlaybackSink *sink, DHPlaybackSinkRenderCallback renderCallback, void *context);
+
+/**
+ * Pull and write one buffer on the calling thread; Silence is written while the engine buffers, the last buffer is not padded;
+ * @return number of frames written, 0 once the engine finished
+ */
+size_t DHPlaybackSinkRenderBuffer(DHPlaybackSink *sink);
+
+/**
+ * Render on a thread of its own until the engine finishes or `DHPlaybackSinkStop`;
+ * @param isRealTime wait a buffer's duration between buffers as a device would, else render as fast as possible
+ * @return 0 if the thread can not be created
+ */
+int DHPlaybackSinkStart(DHPlaybackSink *sink, int isRealTime);
+
+/**
+ * Stop the thread and wait for it; The engine can be reset after this;
+ */
+void DHPlaybackSinkStop(DHPlaybackSink *sink);
+
+int DHPlaybackSinkIsFinished(const DHPlaybackSink *sink);
+
+/**
+ * The position of the engine's stream written last, see `DHPlaybackClock`;
+ * @return 0 if nothing was rendered yet
+ */
+int DHPlaybackSinkGetCurrentFrame(DHPlaybackSink *sink, uint64_t *frame);
+
+#endif /* DHPlaybackSink_h */
@@ -0,0 +1,46 @@
+//
+//  DHQueueAudioFilePlayer.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioFilePlayer.h"
+
+/**
+ * Plays a list of players back to back through one playback engine, without a gap or a decode stall between them, e.g. the voice messages of a thread;
+ * Items are players that decode while playing (see `decodesWhilePlaying`), all decoding to the same `pcmFormat`; Their PCM is spliced frame by frame, and every item drops its own encoder delay, so the last frame of one item is followed by the first frame of the next;
+ * While an item plays, the start of the next one is decoded in the background, so crossing into it does not decode on the playback path;
+ * The queue decodes through the items and releases their own playback engines, do not play them on their own once they are queued;
+ * `duration`, `setCurrentTime:` and finishing cover the whole queue;
+ */
+@interface DHQueueAudioFilePlayer : DHAudioFilePlayer
+
+/**
+ * Initializer
+ * @param items the players to play, in order
+ * @param delegate the delegate
+ * @return nil if there is no item, or an item is still preparing, does not decode while playing or decodes to another format than the first one
+ */
+- (instancetype) initWithItems:(NSArray<DHAudioFilePlayer *> *)items
+                      delegate:(id<DHAudioFilePlayerDelegate>)delegate;
+
+@property (nonatomic, readonly) NSArray<DHAudioFilePlayer *> *items;
+
+/**
+ * Time in the queue at which the item at `index` starts;
+ */
+- (NSTimeInterval) startTimeOfItemAtIndex:(NSUInteger)index;
+
+/**
+ * The item that is playing at `time` in the queue, `NSNotFound` past the end;
+ */
+- (NSUInteger) indexOfItemAtTime:(NSTimeInterval)time;
+
+/**
+ * Jump to the start of the item at `index` and play from there;
+ */
+- (void) playItemAtIndex:(NSUInteger)index;
+
+@end
@@ -0,0 +1,195 @@
+//
+//  DHQueueAudioFilePlayer.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHQueueAudioFilePlayer.h"
+
+static const NSTimeInterval kItemPreRollDuration = 0.5;
+
+@interface DHQueueAudioFilePlayer ()
+@property (nonatomic, strong, readwrite) NSArray<DHAudioFilePlayer *> *items;
+@property (nonatomic, strong) NSArray<NSNumber *> *startFrames;     //one more than items, the last one is the end of the queue
+@property (nonatomic) NSUInteger currentIndex;
+@property (nonatomic, strong) NSData *pendingPCMData;               //pre-rolled PCM of the current item, played before pulling from it
+
+//Pre-roll of the next item, only touched on preRollQ or after waiting for it
+@property (nonatomic, strong) dispatch_queue_t preRollQ;
+@property (nonatomic) NSUInteger preRolledIndex;
+@property (nonatomic, strong) NSData *preRolledPCMData;
+@end
+
+@implementation DHQueueAudioFilePlayer
+
+- (instancetype) initWithItems:(NSArray<DHAudioFilePlayer *> *)items
+                      delegate:(id<DHAudioFilePlayerDelegate>)delegate
+{
+    AudioStreamBasicDescription format = [[items firstObject] pcmFormat];
+    self = [super initWithData:nil packetDuration:0 audioFormat:format delegate:delegate];
+    if (self) {
+        if (![self canQueueItems:items]) {
+            if ([self.delegate respondsToSelector:@selector(audioPlayerDecodeErrorDidOccur:error:)]) {
+                NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain code:-1 userInfo:@{@"info" : @"Items have to decode while playing, to the same format"}];
+                [self.delegate audioPlayerDecodeErrorDidOccur:self error:error];
+            }
+            return nil;
+        }
+        _items = [items copy];
+        _preRollQ = dispatch_queue_create("Audio Queue Pre-roll Queue", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _preRolledIndex = NSNotFound;
+        NSMutableArray *startFrames = [NSMutableArray arrayWithCapacity:[items count] + 1];
+        UInt64 frame = 0;
+        for (DHAudioFilePlayer *item in items) {
+            [startFrames addObject:@(frame)];
+            frame += item.numberOfPlayableFrames;
+            //Only the item's decoding is used, its own ring is not needed
+            [item resetPlaybackEngine];
+        }
+        [startFrames addObject:@(frame)];
+        _startFrames = startFrames;
+        [self setupPlaybackEngineWithFormat:format numberOfFrames:frame];
+    }
+    return self;
+}
+
+- (BOOL) canQueueItems:(NSArray<DHAudioFilePlayer *> *)items
+{
+    if ([items count] == 0) {
+        return NO;
+    }
+    AudioStreamBasicDescription format = [[items firstObject] pcmFormat];
+    for (DHAudioFilePlayer *item in items) {
+        AudioStreamBasicDescription itemFormat = item.pcmFormat;
+        if (!item.decodesWhilePlaying ||
+            itemFormat.mSampleRate != format.mSampleRate ||
+            itemFormat.mChannelsPerFrame != format.mChannelsPerFrame ||
+            itemFormat.mBytesPerFrame != format.mBytesPerFrame ||
+            itemFormat.mFormatFlags != format.mFormatFlags) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (void) setupPlayerWithFile:(NSString *)filePath
+{
+    //The items are set up already, see `initWithItems:delegate:`
+}
+
+- (void) setupPlayerWithData:(NSData *)data
+{
+    //The items are set up already, see `initWithItems:delegate:`
+}
+
+#pragma mark - Items
+- (NSTimeInterval) startTimeOfItemAtIndex:(NSUInteger)index
+{
+    index = MIN(index, [self.items count]);
+    return [self.startFrames[index] unsignedLongLongValue] / self.pcmFormat.mSampleRate;
+}
+
+- (NSUInteger) indexOfItemAtTime:(NSTimeInterval)time
+{
+    return [self indexOfItemAtFrame:(UInt64)(MAX(time, 0) * self.pcmFormat.mSampleRate)];
+}
+
+- (NSUInteger) indexOfItemAtFrame:(UInt64)frame
+{
+    for (NSUInteger index = 0; index < [self.items count]; index++) {
+        if (frame < [self.startFrames[index + 1] unsignedLongLongValue]) {
+            return index;
+        }
+    }
+    return NSNotFound;
+}
+
+- (void) playItemAtIndex:(NSUInteger)index
+{
+    [self setCurrentTime:[self startTimeOfItemAtIndex:index]];
+    if (self.status != DHAudioPlayerStatusPlaying) {
+        [self play];
+    }
+}
+
+#pragma mark - Decoding While Playing
+- (NSData *) nextPCMData
+{
+    while (self.currentIndex < [self.items count]) {
+        if (self.pendingPCMData) {
+            NSData *pcmData = self.pendingPCMData;
+            self.pendingPCMData = nil;
+            return pcmData;
+        }
+        NSData *pcmData = [self.items[self.currentIndex] nextPCMData];
+        if (pcmData == nil || [pcmData length] > 0) {
+            return pcmData;
+        }
+        //The item ended, the next one continues on the very next frame
+        [self startItemAtIndex:self.currentIndex + 1 frame:0];
+    }
+    return [NSData data];
+}
+
+- (void) seekToFrame:(UInt64)frame
+{
+    NSUInteger index = [self indexOfItemAtFrame:frame];
+    if (index == NSNotFound) {
+        [self startItemAtIndex:[self.items count] frame:0];
+        return;
+    }
+    [self startItemAtIndex:index frame:frame - [self.startFrames[index] unsignedLongLongValue]];
+}
+
+//Called on the stream queue
+- (void) startItemAtIndex:(NSUInteger)index frame:(UInt64)frame
+{
+    //The pre-roll may still be decoding an item, wait for it before touching any
+    dispatch_sync(self.preRollQ, ^{});
+    self.currentIndex = index;
+    self.pendingPCMData = nil;
+    if (index < [self.items count]) {
+        if (index == self.preRolledIndex && frame == 0) {
+            //The item is positioned right after its pre-rolled PCM
+            self.pendingPCMData = [self.preRolledPCMData length] > 0 ? self.preRolledPCMData : nil;
+        } else {
+            [self.items[index] seekToFrame:frame];
+        }
+    }
+    self.preRolledIndex = NSNotFound;
+    self.preRolledPCMData = nil;
+    [self preRollItemAtIndex:index + 1];
+}
+
+/**
+ * Decode the first `kItemPreRollDuration` of the item at `index` in the background, so the playback path only has to hand it over;
+ * A decode error is left for the playback path, which decodes the item again and reports it;
+ */
+- (void) preRollItemAtIndex:(NSUInteger)index
+{
+    if (index >= [self.items count]) {
+        return;
+    }
+    DHAudioFilePlayer *item = self.items[index];
+    NSUInteger length = (NSUInteger)(self.pcmFormat.mSampleRate * kItemPreRollDuration) * self.pcmFormat.mBytesPerFrame;
+    dispatch_async(self.preRollQ, ^{
+        [item seekToFrame:0];
+        NSMutableData *preRolledPCMData = [NSMutableData dataWithCapacity:length];
+        while ([preRolledPCMData length] < length) {
+            NSData *pcmData = [item nextPCMData];
+            if (pcmData == nil) {
+                return;
+            }
+            if ([pcmData length] == 0) {
+                break;
+            }
+            [preRolledPCMData appendData:pcmData];
+        }
+        self.preRolledPCMData = preRolledPCMData;
+        self.preRolledIndex = index;
+    });
+}
+
+@end
@@ -0,0 +1,282 @@
+//
+//  DHTimeStretch.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DHTimeStretch.h"
+
+// Set up
+
+int DHTimeStretchInit(DHTimeStretch *stretch, int numberOfChannels, int isFloat, double sampleRate)
+{
+    memset(stretch, 0, sizeof(DHTimeStretch));
+    if (numberOfChannels <= 0 || sampleRate <= 0) {
+        return 0;
+    }
+    stretch->numberOfChannels = numberOfChannels;
+    stretch->isFloat = isFloat;
+    stretch->hopFrames = (size_t)(sampleRate * DHTIMESTRETCH_WINDOW_DURATION / 2);
+    if (stretch->hopFrames == 0) {
+        return 0;
+    }
+    stretch->windowFrames = stretch->hopFrames * 2;
+    stretch->searchFrames = (size_t)(sampleRate * DHTIMESTRETCH_SEARCH_DURATION);
+    //Enough for the widest search one maximum hop past the last segment, see `DHTimeStretchWrite`
+    stretch->inputCapacity = stretch->windowFrames + stretch->searchFrames * 2 + (size_t)ceil(stretch->hopFrames * DHTIMESTRETCH_MAXIMUM_RATE) + stretch->hopFrames;
+    stretch->window = malloc(stretch->windowFrames * sizeof(float));
+    stretch->input = malloc(stretch->inputCapacity * numberOfChannels * sizeof(float));
+    stretch->mix = malloc(stretch->inputCapacity * sizeof(float));
+    stretch->overlap = malloc(stretch->hopFrames * numberOfChannels * sizeof(float));
+    //A drain hands out all of the input at once
+    stretch->output = malloc(stretch->inputCapacity * numberOfChannels * sizeof(float));
+    if (!stretch->window || !stretch->input || !stretch->mix || !stretch->overlap || !stretch->output) {
+        DHTimeStretchDestroy(stretch);
+        return 0;
+    }
+    //A periodic Hann window: the halves of two segments half a window apart add up to exactly 1
+    for (size_t i = 0; i < stretch->windowFrames; i++) {
+        stretch->window[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * i / stretch->windowFrames));
+    }
+    DHTimeStretchReset(stretch);
+    return 1;
+}
+
+void DHTimeStretchDestroy(DHTimeStretch *stretch)
+{
+    free(stretch->window);
+    free(stretch->input);
+    free(stretch->mix);
+    free(stretch->overlap);
+    free(stretch->output);
+    memset(stretch, 0, sizeof(DHTimeStretch));
+}
+
+void DHTimeStretchReset(DHTimeStretch *stretch)
+{
+    stretch->numberOfInputFrames = 0;
+    stretch->numberOfDroppedFrames = 0;
+    stretch->hasOverlap = 0;
+    stretch->continuationPosition = 0;
+    stretch->analysisPosition = 0;
+    stretch->numberOfOutputFrames = 0;
+    stretch->outputOffset = 0;
+    stretch->outputPosition = 0;
+    stretch->outputRate = 1;
+}
+
+// Input
+
+static size_t DHTimeStretchSearchStart(const DHTimeStretch *stretch)
+{
+    size_t nominalPosition = (size_t)stretch->analysisPosition;
+    return nominalPosition > stretch->searchFrames ? nominalPosition - stretch->searchFrames : 0;
+}
+
+size_t DHTimeStretchNumberOfFramesNeeded(const DHTimeStretch *stretch)
+{
+    //Every candidate of the search needs a whole window after it
+    size_t end = (size_t)stretch->analysisPosition + stretch->searchFrames + stretch->windowFrames;
+    return end > stretch->numberOfInputFrames ? end - stretch->numberOfInputFrames : 0;
+}
+
+//Drop the input before the next search and before the continuation, the only parts that are read again
+static void DHTimeStretchCompact(DHTimeStretch *stretch)
+{
+    size_t start = DHTimeStretchSearchStart(stretch);
+    if (stretch->continuationPosition < start) {
+        start = stretch->continuationPosition;
+    }
+    if (start > stretch->numberOfInputFrames) {
+        start = stretch->numberOfInputFrames;
+    }
+    if (start == 0) {
+        return;
+    }
+    size_t numberOfChannels = stretch->numberOfChannels;
+    memmove(stretch->input, stretch->input + start * numberOfChannels, (stretch->numberOfInputFrames - start) * numberOfChannels * sizeof(float));
+    memmove(stretch->mix, stretch->mix + start, (stretch->numberOfInputFrames - start) * sizeof(float));
+    stretch->numberOfInputFrames -= start;
+    stretch->numberOfDroppedFrames += start;
+    stretch->continuationPosition -= start;
+    stretch->analysisPosition -= start;
+}
+
+size_t DHTimeStretchWrite(DHTimeStretch *stretch, const void *bytes, size_t numberOfFrames)
+{
+    if (stretch->numberOfInputFrames + numberOfFrames > stretch->inputCapacity) {
+        DHTimeStretchCompact(stretch);
+    }
+    if (numberOfFrames > stretch->inputCapacity - stretch->numberOfInputFrames) {
+        numberOfFrames = stretch->inputCapacity - stretch->numberOfInputFrames;
+    }
+    int numberOfChannels = stretch->numberOfChannels;
+    float *input = stretch->input + stretch->numberOfInputFrames * numberOfChannels;
+    float *mix = stretch->mix + stretch->numberOfInputFrames;
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        float sum = 0;
+        for (int channel = 0; channel < numberOfChannels; channel++) {
+            size_t index = i * numberOfChannels + channel;
+            float sample = stretch->isFloat ? ((const float *)bytes)[index] : ((const int16_t *)bytes)[index] / 32768.0f;
+            input[index] = sample;
+            sum += sample;
+        }
+        mix[i] = sum / numberOfChannels;
+    }
+    stretch->numberOfInputFrames += numberOfFrames;
+    return numberOfFrames;
+}
+
+// Search
+
+typedef float DHTimeStretchVector __attribute__((vector_size(16)));
+
+static inline DHTimeStretchVector DHTimeStretchLoadVector(const float *samples)
+{
+    //Unaligned, compiles to a single load on SSE and NEON
+    DHTimeStretchVector vector;
+    memcpy(&vector, samples, sizeof(vector));
+    return vector;
+}
+
+static float DHTimeStretchDotProduct(const float *a, const float *b, size_t length)
+{
+    //Two accumulators of four lanes hide the latency of the additions
+    DHTimeStretchVector sum0 = {0, 0, 0, 0};
+    DHTimeStretchVector sum1 = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        sum0 += DHTimeStretchLoadVector(a + i) * DHTimeStretchLoadVector(b + i);
+        sum1 += DHTimeStretchLoadVector(a + i + 4) * DHTimeStretchLoadVector(b + i + 4);
+    }
+    sum0 += sum1;
+    float sum = sum0[0] + sum0[1] + sum0[2] + sum0[3];
+    for (; i < length; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+//The start between `start` and `end` whose first half window is the most similar to the continuation of the last segment
+static size_t DHTimeStretchBestPosition(const DHTimeStretch *stretch, size_t start, size_t end)
+{
+    const float *target = stretch->mix + stretch->continuationPosition;
+    size_t length = stretch->hopFrames;
+    //The energy of the candidate is updated as it slides, the target's is the same for all of them
+    float energy = DHTimeStretchDotProduct(stretch->mix + start, stretch->mix + start, length);
+    size_t bestPosition = start;
+    float bestScore = -INFINITY;
+    for (size_t position = start; position <= end; position++) {
+        const float *candidate = stretch->mix + position;
+        float correlation = DHTimeStretchDotProduct(target, candidate, length);
+        //correlation / sqrt(energy), compared squared with its sign kept
+        float score = correlation * fabsf(correlation) / (energy > 1e-9f ? energy : 1e-9f);
+        if (score > bestScore) {
+            bestScore = score;
+            bestPosition = position;
+        }
+        energy += candidate[length] * candidate[length] - candidate[0] * candidate[0];
+    }
+    return bestPosition;
+}
+
+// Processing
+
+size_t DHTimeStretchProcess(DHTimeStretch *stretch, float rate)
+{
+    if (stretch->outputOffset < stretch->numberOfOutputFrames || DHTimeStretchNumberOfFramesNeeded(stretch) > 0) {
+        return 0;
+    }
+    if (rate < DHTIMESTRETCH_MINIMUM_RATE) {
+        rate = DHTIMESTRETCH_MINIMUM_RATE;
+    }
+    if (rate > DHTIMESTRETCH_MAXIMUM_RATE) {
+        rate = DHTIMESTRETCH_MAXIMUM_RATE;
+    }
+    size_t hopFrames = stretch->hopFrames;
+    size_t numberOfChannels = stretch->numberOfChannels;
+    const float *window = stretch->window;
+    if (!stretch->hasOverlap) {
+        //Start as if a segment ended here, so the first output is the input as it is
+        const float *tail = stretch->input + stretch->continuationPosition * numberOfChannels;
+        for (size_t i = 0; i < hopFrames; i++) {
+            for (size_t channel = 0; channel < numberOfChannels; channel++) {
+                stretch->overlap[i * numberOfChannels + channel] = tail[i * numberOfChannels + channel] * window[hopFrames + i];
+            }
+        }
+        stretch->hasOverlap = 1;
+    }
+    size_t position = DHTimeStretchBestPosition(stretch, DHTimeStretchSearchStart(stretch), (size_t)stretch->analysisPosition + stretch->searchFrames);
+    const float *segment = stretch->input + position * numberOfChannels;
+    for (size_t i = 0; i < hopFrames; i++) {
+        for (size_t channel = 0; channel < numberOfChannels; channel++) {
+            size_t index = i * numberOfChannels + channel;
+            stretch->output[index] = stretch->overlap[index] + segment[index] * window[i];
+            stretch->overlap[index] = segment[hopFrames * numberOfChannels + index] * window[hopFrames + i];
+        }
+    }
+    stretch->numberOfOutputFrames = hopFrames;
+    stretch->outputOffset = 0;
+    stretch->outputPosition = stretch->numberOfDroppedFrames + stretch->analysisPosition;
+    stretch->outputRate = rate;
+    stretch->continuationPosition = position + hopFrames;
+    stretch->analysisPosition += hopFrames * rate;
+    return hopFrames;
+}
+
+size_t DHTimeStretchDrain(DHTimeStretch *stretch)
+{
+    if (stretch->outputOffset < stretch->numberOfOutputFrames) {
+        return 0;
+    }
+    //The overlap is the continuation faded out, adding it back faded in gives the input as it is
+    size_t start = stretch->continuationPosition < stretch->numberOfInputFrames ? stretch->continuationPosition : stretch->numberOfInputFrames;
+    size_t numberOfFrames = stretch->numberOfInputFrames - start;
+    size_t numberOfChannels = stretch->numberOfChannels;
+    memcpy(stretch->output, stretch->input + start * numberOfChannels, numberOfFrames * numberOfChannels * sizeof(float));
+    stretch->numberOfOutputFrames = numberOfFrames;
+    stretch->outputOffset = 0;
+    stretch->outputPosition = stretch->numberOfDroppedFrames + start;
+    stretch->outputRate = 1;
+    //Go on from the end of the input, as after a reset
+    stretch->numberOfDroppedFrames += stretch->numberOfInputFrames;
+    stretch->numberOfInputFrames = 0;
+    stretch->hasOverlap = 0;
+    stretch->continuationPosition = 0;
+    stretch->analysisPosition = 0;
+    return numberOfFrames;
+}
+
+// Output
+
+size_t DHTimeStretchRead(DHTimeStretch *stretch, void *bytes, size_t numberOfFrames)
+{
+    size_t available = stretch->numberOfOutputFrames - stretch->outputOffset;
+    if (numberOfFrames > available) {
+        numberOfFrames = available;
+    }
+    size_t numberOfSamples = numberOfFrames * stretch->numberOfChannels;
+    const float *output = stretch->output + stretch->outputOffset * stretch->numberOfChannels;
+    if (stretch->isFloat) {
+        memcpy(bytes, output, numberOfSamples * sizeof(float));
+    } else {
+        for (size_t i = 0; i < numberOfSamples; i++) {
+            float sample = output[i] * 32768.0f;
+            sample = sample > 32767.0f ? 32767.0f : (sample < -32768.0f ? -32768.0f : sample);
+            ((int16_t *)bytes)[i] = (int16_t)lrintf(sample);
+        }
+    }
+    stretch->outputOffset += numberOfFrames;
+    return numberOfFrames;
+}
+
+double DHTimeStretchPosition(const DHTimeStretch *stretch)
+{
+    return stretch->outputPosition + stretch->outputOffset * stretch->outputRate;
+}
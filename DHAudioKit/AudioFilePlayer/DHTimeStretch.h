@@ -0,0 +1,96 @@
+//
+//  DHTimeStretch.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHTimeStretch_h
+#define DHTimeStretch_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHTIMESTRETCH_MINIMUM_RATE 0.5f
+#define DHTIMESTRETCH_MAXIMUM_RATE 3.0f
+#define DHTIMESTRETCH_WINDOW_DURATION 0.02          //segments overlap by half of it
+#define DHTIMESTRETCH_SEARCH_DURATION 0.005         //how far a segment may move from its nominal position
+
+/**
+ * Changes the speed of interleaved 16-bit or 32-bit float PCM without changing its pitch, with WSOLA (waveform similarity overlap-add);
+ * The output is built from Hann windowed segments of the input overlapping by half; Each segment is taken around its nominal position, `rate` times further into the input than into the output, where its start is most similar to how the previous segment goes on, so the waveforms line up and no pitch period is cut in half;
+ * The similarity is the normalized cross-correlation of a mono mix, computed with SIMD vectors; At most `DHTIMESTRETCH_SEARCH_DURATION` on either side is searched, a few multiplications per sample and position, so it runs on a real-time audio thread;
+ * Nothing is allocated after `DHTimeStretchInit`; The producer writes exactly the frames `DHTimeStretchNumberOfFramesNeeded` asks for, then processes a segment and reads it out;
+ * See: W. Verhelst, M. Roelands, "An overlap-add technique based on waveform similarity (WSOLA) for high quality time-scale modification of speech", ICASSP 1993
+ */
+typedef struct {
+    int numberOfChannels;
+    int isFloat;
+    size_t windowFrames;
+    size_t hopFrames;                       //half a window, the output of one segment
+    size_t searchFrames;
+    float *window;
+    float *input;                           //interleaved
+    float *mix;                             //mono mix of `input`, for the search
+    size_t inputCapacity;
+    size_t numberOfInputFrames;
+    uint64_t numberOfDroppedFrames;         //input frames dropped from the front since the reset
+    float *overlap;                         //windowed second half of the last segment
+    int hasOverlap;
+    size_t continuationPosition;            //where the last segment goes on, in `input`
+    double analysisPosition;                //nominal start of the next segment, in `input`
+    float *output;                          //interleaved
+    size_t numberOfOutputFrames;
+    size_t outputOffset;
+    double outputPosition;                  //input frame the first output frame stands for, counted since the reset
+    double outputRate;                      //input frames per output frame
+} DHTimeStretch;
+
+/**
+ * @return 0 if the format is not supported or the allocation fails
+ */
+int DHTimeStretchInit(DHTimeStretch *stretch, int numberOfChannels, int isFloat, double sampleRate);
+
+void DHTimeStretchDestroy(DHTimeStretch *stretch);
+
+/**
+ * Drop all input and output, the next frame written is input frame 0;
+ */
+void DHTimeStretchReset(DHTimeStretch *stretch);
+
+/**
+ * Number of input frames to write before `DHTimeStretchProcess` can build the next segment;
+ */
+size_t DHTimeStretchNumberOfFramesNeeded(const DHTimeStretch *stretch);
+
+/**
+ * Copy up to `DHTimeStretchNumberOfFramesNeeded` frames of input;
+ * @return number of frames written
+ */
+size_t DHTimeStretchWrite(DHTimeStretch *stretch, const void *bytes, size_t numberOfFrames);
+
+/**
+ * Build the next segment at `rate`, clamped between `DHTIMESTRETCH_MINIMUM_RATE` and `DHTIMESTRETCH_MAXIMUM_RATE`, once the output was read out and the needed input written;
+ * @return number of frames of output, 0 if there is output left or input missing
+ */
+size_t DHTimeStretchProcess(DHTimeStretch *stretch, float rate);
+
+/**
+ * Turn the input that is left into output at the normal speed, to finish a stream or to go back to it without a jump; The output has to be read out first;
+ * @return number of frames of output
+ */
+size_t DHTimeStretchDrain(DHTimeStretch *stretch);
+
+/**
+ * Copy up to `numberOfFrames` frames of output, in the format of the input;
+ * @return number of frames read
+ */
+size_t DHTimeStretchRead(DHTimeStretch *stretch, void *bytes, size_t numberOfFrames);
+
+/**
+ * The input frame, counted since the reset, that the next frame read stands for;
+ */
+double DHTimeStretchPosition(const DHTimeStretch *stretch);
+
+#endif /* DHTimeStretch_h */
@@ -7,7 +7,51 @@
 //
 
 #import "DHAudioConverter.h"
+#import "DHAACEncoderBackend.h"
 
 @interface DHAACAudioConverter : DHAudioConverter
 
+/**
+ * The codec that encodes the PCM into raw AAC packets; The converter does the buffering and the ADTS framing for every backend, so the output framing does not depend on the backend;
+ * Default value is a `DHAudioToolboxAACEncoderBackend`;
+ */
+@property (nonatomic, strong, readonly) id<DHAACEncoderBackend> backend;
+
+/**
+ * Path of an .m4a file the AAC packets are also written to, as fragmented MP4; Default value is nil;
+ * Players get the duration and seek from the container instead of scanning ADTS, and a file that was cut off by a crash still plays up to its last fragment;
+ * Set the path before the conversion starts;
+ */
+@property (nonatomic, copy) NSString *outputFilePath;
+
+/**
+ * Duration of each fragment of `outputFilePath` in seconds; Default value is 1;
+ * Shorter fragments lose less audio in a crash, longer ones add less container overhead;
+ */
+@property (nonatomic) NSTimeInterval fragmentDuration;
+
+/**
+ * Initializer
+ * @param inFormat Source audio format
+ * @param outFormat Target audio format
+ * @param backend the encoder, e.g. `DHFDKAACEncoderBackend`; nil uses `DHAudioToolboxAACEncoderBackend`
+ * @param delegate the delegate
+ * @param delegateQueue the queue on which the delegate is running;
+ */
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                  backend:(id<DHAACEncoderBackend>)backend
+                                 delegate:(id<DHAudioConverterDelegate>)delegate
+                            delegateQueue:(dispatch_queue_t)delegateQueue;
+
+/**
+ * Number of times the output buffers have been (re)allocated; The buffers are sized from the encoder's maximum packet size and reused, so this only grows when a call carries more audio than any call before it;
+ */
+@property (nonatomic, readonly) NSUInteger numberOfBufferAllocations;
+
+/**
+ * Bytes currently held by the output and packet description buffers; 0 after the conversion has stopped;
+ */
+@property (nonatomic, readonly) NSUInteger allocatedBufferSize;
+
 @end
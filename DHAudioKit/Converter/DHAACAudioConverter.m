@@ -7,16 +7,32 @@
 //
 
 #import "DHAACAudioConverter.h"
+#import "DHAudioToolboxAACEncoderBackend.h"
+#import "DHADTSUtilities.h"
+#import "DHAudioRingBuffer.h"
+#import "DHFragmentedMP4Writer.h"
+
+static const UInt32 kDHAACPendingInputPackets = 4;
+static const NSTimeInterval kDHAACDefaultFragmentDuration = 1;
 
-#import "DHAACAudioConverter.h"
 @interface DHAACAudioConverter() {
-    AudioConverterRef mConverter;
+    uint8_t adtsHeaderTemplate[DHADTS_HEADER_LENGTH];
+    AudioStreamPacketDescription *packetDescriptions;
+    UInt32 packetCapacity;
+    UInt32 numberOfEncodedPackets;
+    UInt32 numberOfEncodedBytes;
+    DHAudioRingBuffer pendingInput;
+    uint8_t *inputPacketBuffer;
+    UInt32 framesToEncode;
+    UInt32 numberOfDelayPackets;        //packets the backend holds back for its priming, at least 1
 }
-@property (nonatomic, strong) NSData *data;
+@property (nonatomic, strong, readwrite) id<DHAACEncoderBackend> backend;
+@property (nonatomic, strong) DHFragmentedMP4Writer *fileWriter;
 
 @property (nonatomic) UInt32 srcBufferSize;
 @property (nonatomic) UInt32 srcSizePerPacket;
-@property (nonatomic) UInt32 dataOffset;
+
+@property (nonatomic, readwrite) NSUInteger numberOfBufferAllocations;
 
 @end
 
@@ -26,6 +42,19 @@
                         outputAudioFormat:(AudioStreamBasicDescription)outFormat
                                  delegate:(id<DHAudioConverterDelegate>)delegate
                             delegateQueue:(dispatch_queue_t)delegateQueue
+{
+    return [self initWithInputAudioFormat:inFormat
+                        outputAudioFormat:outFormat
+                                  backend:nil
+                                 delegate:delegate
+                            delegateQueue:delegateQueue];
+}
+
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                  backend:(id<DHAACEncoderBackend>)backend
+                                 delegate:(id<DHAudioConverterDelegate>)delegate
+                            delegateQueue:(dispatch_queue_t)delegateQueue
 {
     self = [super initWithInputAudioFormat:inFormat
                          outputAudioFormat:outFormat
@@ -33,14 +62,39 @@
                              delegateQueue:delegateQueue];
     if (self) {
         encodeQ = dispatch_queue_create("Encode AAC Queue", NULL);
+        _fragmentDuration = kDHAACDefaultFragmentDuration;
         
-        if (![self setupConverterWithInFormat:self.inFormat outFormat:self.outFormat]) {
+        if (![self setupADTSHeaderTemplate]) {
+            return nil;
+        }
+        if (backend == nil) {
+            OSStatus status = noErr;
+            backend = [[DHAudioToolboxAACEncoderBackend alloc] initWithInputAudioFormat:self.inFormat
+                                                                       outputAudioFormat:self.outFormat
+                                                                                  status:&status];
+            if (backend == nil) {
+                [self reportErrorWithErrorCode:status message:@"Fail to create converter"];
+                return nil;
+            }
+        }
+        _backend = backend;
+        if (![self setupInputBuffers]) {
             return nil;
         }
+        UInt32 framesPerPacket = self.srcBufferSize / self.srcSizePerPacket;
+        numberOfDelayPackets = MAX((backend.encoderDelay + framesPerPacket - 1) / framesPerPacket, 1);
     }
     return self;
 }
 
+- (void) setBitRate:(UInt32)bitRate
+{
+    [super setBitRate:bitRate];
+    dispatch_async(encodeQ, ^{
+        self.backend.bitRate = bitRate;
+    });
+}
+
 - (void) convertData:(NSData *)data numberOfPackets:(int)numberOfPackets
 {
     if ([data length] == 0) {
@@ -48,76 +102,247 @@
     }
     self.numberOfPacketsReceived++;
     dispatch_async(encodeQ, ^{
-        self.data = data;
-        self.dataOffset = 0;
-        outBufferSize = numberOfPackets * self.outFormat.mChannelsPerFrame;
-        outBuffer = malloc(outBufferSize * sizeof(u_int8_t));
-        self.srcBufferSize = self.outFormat.mFramesPerPacket * self.inFormat.mBytesPerPacket;
-        self.srcSizePerPacket = self.inFormat.mBytesPerPacket;
-        
-        AudioBufferList outBufferList = [self setupOutBufferList];
-        
-        UInt32 ioOutputDataPacketSize = outBufferList.mBuffers[0].mDataByteSize / self.outFormat.mFramesPerPacket / self.outFormat.mChannelsPerFrame;
-        AudioStreamPacketDescription *packetDescription = malloc(ioOutputDataPacketSize  * sizeof(AudioStreamBasicDescription));
-        OSStatus status = AudioConverterFillComplexBuffer(mConverter, AACInputDataProc, (__bridge void *)self, &ioOutputDataPacketSize, &outBufferList, packetDescription);
-        if (status != noErr) {
-            [self reportErrorWithErrorCode:status message:@"Fail to convert data"];
+        if (DHAudioRingBufferWrite(&pendingInput, [data bytes], [data length]) != [data length]) {
+            [self reportErrorWithErrorCode:kAudio_MemFullError message:@"Fail to buffer data"];
         } else {
-            NSMutableData *fullData = [NSMutableData data];
-            NSData *rawData = [NSData dataWithBytes:outBufferList.mBuffers[0].mData length:outBufferList.mBuffers[0].mDataByteSize];
-            [fullData appendData:[self postProcessRawData:rawData packetDescriptions:packetDescription packetCount:ioOutputDataPacketSize]];
-            dispatch_async(self.delegateQueue, ^{
-                [self.delegate audioConverter:self didFinishConversionWithData:fullData];
-            });
-            self.numberOfPacketsConverted++;
-            
-            [self finishConversionIfAllPacketsAreConverted];
+            //Only whole AAC packets are encoded, the remainder waits in the ring buffer for the next call
+            framesToEncode = (UInt32)(pendingInput.length / self.srcBufferSize) * self.outFormat.mFramesPerPacket;
+            [self encodePendingInput];
         }
+        self.numberOfPacketsConverted++;
+        
+        [self finishConversionIfAllPacketsAreConverted];
     });
 }
 
-- (NSData *) postProcessRawData:(NSData *)rawData
-             packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
-                    packetCount:(UInt32)packetCount
+- (void) stopConversion
 {
-    NSMutableData *fullData = [NSMutableData data];
-    char *bytes = (char *)[rawData bytes];
-    for (int i = 0; i < packetCount; i++) {
-        AudioStreamPacketDescription packetDescription = packetDescriptions[i];
-        
-        NSData *data = [NSData dataWithBytes:bytes + packetDescription.mStartOffset
-                                      length:packetDescription.mDataByteSize];
-        
-        NSData *adstHeader = [self adtsDataForPacketLength:data.length];
-        [fullData appendData:adstHeader];
-        [fullData appendData:data];
+    dispatch_async(encodeQ, ^{
+        [self flushEncoder];
+        [super stopConversion];
+    });
+}
+
+/**
+ * Encode the remainder that does not fill a whole packet, and drain the frames the encoder holds back;
+ */
+- (void) flushEncoder
+{
+    framesToEncode = (UInt32)(pendingInput.length / self.srcSizePerPacket);
+    [self encodePendingInput];
+    if ([self reserveBuffersForPacketCount:numberOfDelayPackets + 1]) {
+        UInt32 numberOfPackets = 0;
+        do {
+            if (![self encodeFrames:NULL numberOfFrames:0 numberOfPackets:&numberOfPackets]) {
+                break;
+            }
+        } while (numberOfPackets > 0);
+        [self deliverEncodedPackets];
     }
-    return [fullData copy];
+    [self.backend reset];
+    DHAudioRingBufferReset(&pendingInput);
+    [self.fileWriter finish];
+    self.fileWriter = nil;
 }
 
-#pragma mark - Set up
-- (BOOL) setupConverterWithInFormat:(AudioStreamBasicDescription)inFormat
-                          outFormat:(AudioStreamBasicDescription)outFormat
+- (void) encodePendingInput
 {
-    OSStatus status = AudioConverterNew(&inFormat, &outFormat, &mConverter);
+    UInt32 framesPerPacket = self.srcBufferSize / self.srcSizePerPacket;
+    if (inputPacketBuffer == NULL || ![self reserveBuffersForPacketCount:framesToEncode / framesPerPacket + numberOfDelayPackets]) {
+        return;
+    }
+    while (framesToEncode > 0) {
+        UInt32 frames = MIN(framesToEncode, framesPerPacket);
+        DHAudioRingBufferRead(&pendingInput, inputPacketBuffer, frames * self.srcSizePerPacket);
+        framesToEncode -= frames;
+        UInt32 numberOfPackets = 0;
+        if (![self encodeFrames:inputPacketBuffer numberOfFrames:frames numberOfPackets:&numberOfPackets]) {
+            framesToEncode = 0;
+            break;
+        }
+    }
+    [self deliverEncodedPackets];
+}
+
+/**
+ * Append the packets the backend produces to the output buffer; 0 frames drains the backend;
+ */
+- (BOOL) encodeFrames:(const void *)frames numberOfFrames:(UInt32)numberOfFrames numberOfPackets:(UInt32 *)numberOfPackets
+{
+    if (packetCapacity - numberOfEncodedPackets < numberOfDelayPackets) {
+        [self deliverEncodedPackets];
+    }
+    AudioStreamPacketDescription *descriptions = packetDescriptions + numberOfEncodedPackets;
+    uint8_t *output = outBuffer + numberOfEncodedBytes;
+    UInt32 outputSize = outBufferSize - numberOfEncodedBytes;
+    *numberOfPackets = packetCapacity - numberOfEncodedPackets;
+    OSStatus status;
+    if (numberOfFrames > 0) {
+        status = [self.backend encodeFrames:frames
+                             numberOfFrames:numberOfFrames
+                               outputBuffer:output
+                           outputBufferSize:outputSize
+                         packetDescriptions:descriptions
+                            numberOfPackets:numberOfPackets];
+    } else {
+        status = [self.backend drainToOutputBuffer:output
+                                  outputBufferSize:outputSize
+                                packetDescriptions:descriptions
+                                   numberOfPackets:numberOfPackets];
+    }
     if (status != noErr) {
-        [self reportErrorWithErrorCode:status message:@"Fail to create converter"];
+        *numberOfPackets = 0;
+        [self reportErrorWithErrorCode:status message:@"Fail to convert data"];
+        return NO;
+    }
+    UInt32 encodedBytes = 0;
+    for (UInt32 i = 0; i < *numberOfPackets; i++) {
+        encodedBytes = MAX(encodedBytes, (UInt32)descriptions[i].mStartOffset + descriptions[i].mDataByteSize);
+        descriptions[i].mStartOffset += numberOfEncodedBytes;
+    }
+    numberOfEncodedBytes += encodedBytes;
+    numberOfEncodedPackets += *numberOfPackets;
+    return YES;
+}
+
+- (void) deliverEncodedPackets
+{
+    if (numberOfEncodedPackets == 0) {
+        return;
+    }
+    [self writePacketsToFile];
+    NSData *fullData = [self adtsDataWithRawBytes:outBuffer
+                               packetDescriptions:packetDescriptions
+                                      packetCount:numberOfEncodedPackets];
+    numberOfEncodedPackets = 0;
+    numberOfEncodedBytes = 0;
+    dispatch_async(self.delegateQueue, ^{
+        [self.delegate audioConverter:self didFinishConversionWithData:fullData];
+    });
+}
+
+#pragma mark - Output File
+- (void) writePacketsToFile
+{
+    if (self.outputFilePath == nil) {
+        return;
+    }
+    if (self.fileWriter == nil) {
+        //The priming the edit list cuts off depends on the backend
+        self.fileWriter = [[DHFragmentedMP4Writer alloc] initWithFilePath:self.outputFilePath
+                                                              audioFormat:self.outFormat
+                                                    numberOfPrimingFrames:self.backend.encoderDelay];
+        if (self.fileWriter == nil) {
+            [self reportErrorWithErrorCode:kAudioFileUnspecifiedError message:@"Fail to create output file"];
+            self.outputFilePath = nil;
+            return;
+        }
+        self.fileWriter.fragmentDuration = self.fragmentDuration;
+    }
+    [self.fileWriter appendPackets:outBuffer packetDescriptions:packetDescriptions numberOfPackets:numberOfEncodedPackets];
+}
+
+/**
+ * Frame the raw AAC packets with ADTS headers in a single pass;
+ * The output size is known from the packet descriptions, so headers and payloads are written straight into one buffer;
+ */
+- (NSData *) adtsDataWithRawBytes:(const uint8_t *)rawBytes
+               packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                      packetCount:(UInt32)packetCount
+{
+    NSUInteger totalLength = 0;
+    for (UInt32 i = 0; i < packetCount; i++) {
+        totalLength += DHADTS_HEADER_LENGTH + packetDescriptions[i].mDataByteSize;
+    }
+    if (totalLength == 0) {
+        return [NSData data];
+    }
+    uint8_t *bytes = malloc(totalLength);
+    uint8_t *output = bytes;
+    for (UInt32 i = 0; i < packetCount; i++) {
+        UInt32 packetLength = packetDescriptions[i].mDataByteSize;
+        DHADTSWriteHeader(output, adtsHeaderTemplate, packetLength);
+        memcpy(output + DHADTS_HEADER_LENGTH, rawBytes + packetDescriptions[i].mStartOffset, packetLength);
+        output += DHADTS_HEADER_LENGTH + packetLength;
+    }
+    return [NSData dataWithBytesNoCopy:bytes length:totalLength freeWhenDone:YES];
+}
+
+#pragma mark - Set up
+/**
+ * The PCM that does not fill a whole AAC packet is kept in a ring buffer across calls; It is copied one packet at a time into a staging buffer for the backend;
+ */
+- (BOOL) setupInputBuffers
+{
+    self.srcSizePerPacket = MAX(self.inFormat.mBytesPerPacket, 1);
+    self.srcBufferSize = MAX(self.outFormat.mFramesPerPacket, 1) * self.srcSizePerPacket;
+    inputPacketBuffer = malloc(self.srcBufferSize);
+    if (inputPacketBuffer == NULL || !DHAudioRingBufferInit(&pendingInput, kDHAACPendingInputPackets * self.srcBufferSize)) {
+        [self reportErrorWithErrorCode:kAudio_MemFullError message:@"Fail to allocate input buffers"];
         return NO;
     }
     return YES;
 }
 
-- (AudioBufferList) setupOutBufferList
+#pragma mark - Buffers
+
+/**
+ * The output buffer and the packet descriptions are kept for the lifetime of the converter and only grow when a call needs more packets than any call before it;
+ */
+- (BOOL) reserveBuffersForPacketCount:(UInt32)packetCount
 {
-    memset(outBuffer, 0, outBufferSize);
-    
-    AudioBufferList outAudioBufferList = {0};
-    outAudioBufferList.mNumberBuffers = 1;
-    outAudioBufferList.mBuffers[0].mNumberChannels = self.outFormat.mChannelsPerFrame;
-    outAudioBufferList.mBuffers[0].mDataByteSize = (int)outBufferSize;
-    outAudioBufferList.mBuffers[0].mData = outBuffer;
-    
-    return outAudioBufferList;
+    if (packetCount <= packetCapacity) {
+        return YES;
+    }
+    UInt32 maximumOutputPacketSize = self.backend.maximumOutputPacketSize;
+    u_int8_t *buffer = realloc(outBuffer, (size_t)packetCount * maximumOutputPacketSize);
+    AudioStreamPacketDescription *descriptions = realloc(packetDescriptions, packetCount * sizeof(AudioStreamPacketDescription));
+    if (buffer) {
+        outBuffer = buffer;
+    }
+    if (descriptions) {
+        packetDescriptions = descriptions;
+    }
+    if (buffer == NULL || descriptions == NULL) {
+        [self reportErrorWithErrorCode:kAudio_MemFullError message:@"Fail to allocate conversion buffers"];
+        return NO;
+    }
+    outBufferSize = packetCount * maximumOutputPacketSize;
+    packetCapacity = packetCount;
+    self.numberOfBufferAllocations++;
+    return YES;
+}
+
+- (NSUInteger) allocatedBufferSize
+{
+    return outBufferSize + packetCapacity * sizeof(AudioStreamPacketDescription);
+}
+
+- (void) cleanUpResource
+{
+    dispatch_async(encodeQ, ^{
+        [self releaseBuffers];
+    });
+}
+
+- (void) releaseBuffers
+{
+    free(outBuffer);
+    outBuffer = NULL;
+    outBufferSize = 0;
+    free(packetDescriptions);
+    packetDescriptions = NULL;
+    packetCapacity = 0;
+    numberOfEncodedPackets = 0;
+    numberOfEncodedBytes = 0;
+    free(inputPacketBuffer);
+    inputPacketBuffer = NULL;
+    DHAudioRingBufferDestroy(&pendingInput);
+}
+
+- (void) dealloc
+{
+    [self releaseBuffers];
 }
 
 #pragma mark - AAC ADTS header
@@ -132,97 +357,31 @@
  *  Also: http://wiki.multimedia.cx/index.php?title=MPEG-4_Audio#Channel_Configurations
  **/
 - (NSData*) adtsDataForPacketLength:(NSUInteger)packetLength {
-    int adtsLength = 7;
-    char *packet = malloc(sizeof(char) * adtsLength);
-    // Variables Recycled by addADTStoPacket
-    int profile = 2;  //AAC LC
-    //39=MediaCodecInfo.CodecProfile7Level.AACObjectELD;
-    int freqIdx = [self frequencyIndex];
-    int chanCfg = [self channelConfiguration];  //MPEG-4 Audio Channel Configuration. 1 Channel front-center
-    NSUInteger fullLength = adtsLength + packetLength;
-    // fill in ADTS data
-    packet[0] = (char)0xFF; // 11111111     = syncword
-    packet[1] = (char)0xF9; // 1111 1 00 1  = syncword MPEG-2 Layer CRC
-    packet[2] = (char)(((profile-1)<<6) + (freqIdx<<2) +(chanCfg>>2));
-    packet[3] = (char)(((chanCfg&3)<<6) + (fullLength>>11));
-    packet[4] = (char)((fullLength&0x7FF) >> 3);
-    packet[5] = (char)(((fullLength&7)<<5) + 0x1F);
-    packet[6] = (char)0xFC;
-    NSData *data = [NSData dataWithBytesNoCopy:packet length:adtsLength freeWhenDone:YES];
+    uint8_t *packet = malloc(sizeof(uint8_t) * DHADTS_HEADER_LENGTH);
+    DHADTSWriteHeader(packet, adtsHeaderTemplate, packetLength);
+    NSData *data = [NSData dataWithBytesNoCopy:packet length:DHADTS_HEADER_LENGTH freeWhenDone:YES];
     return data;
 }
 
-- (int) frequencyIndex
-{
-    if (self.outFormat.mSampleRate == 96000) {
-        return 0;
-    } else if (self.outFormat.mSampleRate == 88200) {
-        return 1;
-    } else if (self.outFormat.mSampleRate == 64000) {
-        return 2;
-    }  else if (self.outFormat.mSampleRate == 48000) {
-        return 3;
-    } else if (self.outFormat.mSampleRate == 44100) {
-        return 4;
-    } else if (self.outFormat.mSampleRate == 32000) {
-        return 5;
-    } else if (self.outFormat.mSampleRate == 24000) {
-        return 6;
-    } else if (self.outFormat.mSampleRate == 22050) {
-        return 7;
-    } else if (self.outFormat.mSampleRate == 16000) {
-        return 8;
-    } else if (self.outFormat.mSampleRate == 12000) {
-        return 9;
-    } else if (self.outFormat.mSampleRate == 11025) {
-        return 10;
-    } else if (self.outFormat.mSampleRate == 8000) {
-        return 11;
-    } else if (self.outFormat.mSampleRate == 7350) {
-        return 12;
-    }
-    return -1;
-}
-
-- (int) channelConfiguration
-{
-    if (self.outFormat.mChannelsPerFrame > 0 && self.outFormat.mChannelsPerFrame < 7) {
-        return self.outFormat.mChannelsPerFrame;
-    } else if (self.outFormat.mChannelsPerFrame == 7) {
-        return 8;
-    } else {
-        return 0;
-    }
-}
-
-
-
-#pragma mark - Converter Call Back
-OSStatus AACInputDataProc(AudioConverterRef inAudioConverter,
-                          UInt32 *ioNumberDataPackets,
-                          AudioBufferList *ioData,
-                          AudioStreamPacketDescription **outDataPacketDescription,
-                          void *inUserData)
-{
-    DHAACAudioConverter *converter = (__bridge DHAACAudioConverter *)inUserData;
-    
-    UInt32 maxPackets = converter.srcBufferSize / converter.srcSizePerPacket;
-    if (*ioNumberDataPackets > maxPackets) {
-        *ioNumberDataPackets = maxPackets;
-    }
-    
-    char *bytes = (char *)[[converter data] bytes];
-    bytes += converter.dataOffset;
-    
-    UInt32 readBytes = (*ioNumberDataPackets * converter.srcSizePerPacket);
-    
-    ioData->mBuffers[0].mData = bytes;
-    ioData->mBuffers[0].mDataByteSize = readBytes;
-    ioData->mBuffers[0].mNumberChannels = converter.outFormat.mChannelsPerFrame;
-    
-    converter.dataOffset += readBytes;
-    
-    return noErr;
+/**
+ * Profile, sampling frequency and channel configuration are the same for every packet, so only the frame length has to be filled in per packet;
+ * Rates and channel counts ADTS cannot describe are rejected here instead of producing broken headers;
+ */
+- (BOOL) setupADTSHeaderTemplate
+{
+    //39=MediaCodecInfo.CodecProfile7Level.AACObjectELD;
+    int freqIdx = DHADTSFrequencyIndexForSampleRate(self.outFormat.mSampleRate);
+    int chanCfg = DHADTSChannelConfigurationForNumberOfChannels(self.outFormat.mChannelsPerFrame);  //MPEG-4 Audio Channel Configuration. 1 Channel front-center
+    if (freqIdx < 0) {
+        [self reportErrorWithErrorCode:kAudioConverterErr_OutputSampleRateOutOfRange message:[NSString stringWithFormat:@"Sample rate %.0f is not supported by AAC", self.outFormat.mSampleRate]];
+        return NO;
+    }
+    if (chanCfg == 0) {
+        [self reportErrorWithErrorCode:kAudioConverterErr_FormatNotSupported message:[NSString stringWithFormat:@"%u channels are not supported by ADTS", (unsigned int)self.outFormat.mChannelsPerFrame]];
+        return NO;
+    }
+    DHADTSMakeHeaderTemplate(adtsHeaderTemplate, DHADTS_PROFILE_AAC_LC, freqIdx, chanCfg);
+    return YES;
 }
 
 @end
@@ -0,0 +1,64 @@
+//
+//  DHAACEncoderBackend.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+
+/**
+ * The codec behind `DHAACAudioConverter`; The converter buffers the PCM, hands it over one AAC packet (`mFramesPerPacket` frames) at a time and frames the raw packets with ADTS headers, so a backend only encodes;
+ * Calls are made from the converter's encode queue only;
+ */
+@protocol DHAACEncoderBackend <NSObject>
+
+/**
+ * The largest raw packet the backend produces; Used to size the output buffers;
+ */
+@property (nonatomic, readonly) UInt32 maximumOutputPacketSize;
+
+/**
+ * Frames of priming the encoder puts before the audio, per channel; They are held back at the start and cut off by the edit list of an .m4a;
+ */
+@property (nonatomic, readonly) UInt32 encoderDelay;
+
+/**
+ * Target bitrate in bits per second; 0 keeps the backend's default;
+ */
+@property (nonatomic) UInt32 bitRate;
+
+/**
+ * Encode PCM frames in the converter's input format;
+ * @param frames interleaved PCM, at most one AAC packet of frames; Fewer frames are only passed at the end of the stream, right before draining
+ * @param numberOfFrames number of frames in `frames`
+ * @param outputBuffer the raw packets are written here
+ * @param outputBufferSize size of `outputBuffer` in bytes
+ * @param packetDescriptions one description per packet, offsets relative to `outputBuffer`
+ * @param ioNumberOfPackets on input the capacity of `packetDescriptions`, on output the number of packets written, which can be 0 as encoders delay their output;
+ * @return noErr or an error code of the backend
+ */
+- (OSStatus) encodeFrames:(const void *)frames
+           numberOfFrames:(UInt32)numberOfFrames
+             outputBuffer:(uint8_t *)outputBuffer
+         outputBufferSize:(UInt32)outputBufferSize
+       packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+          numberOfPackets:(UInt32 *)ioNumberOfPackets;
+
+/**
+ * Output the packets the encoder holds back at the end of the stream; Called until no packet is returned, then `reset` is called;
+ * Parameters are the same as `encodeFrames:numberOfFrames:outputBuffer:outputBufferSize:packetDescriptions:numberOfPackets:`;
+ */
+- (OSStatus) drainToOutputBuffer:(uint8_t *)outputBuffer
+                outputBufferSize:(UInt32)outputBufferSize
+              packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                 numberOfPackets:(UInt32 *)ioNumberOfPackets;
+
+/**
+ * Get ready for a new stream after draining;
+ */
+- (void) reset;
+
+@end
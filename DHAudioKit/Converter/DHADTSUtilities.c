@@ -0,0 +1,280 @@
+//
+//  DHADTSUtilities.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+
+#include "DHADTSUtilities.h"
+#include "DHAudioSampleRates.h"
+
+#define ADTS_FRAMES_PER_RAW_DATA_BLOCK 1024
+
+//The same list as `DHAudioSampleRate`, so the frequency indexes can not drift apart from it
+#define ADTS_SAMPLE_RATE(rate) rate,
+static const int kADTSSampleRates[] = {
+    DHAUDIO_SAMPLE_RATES(ADTS_SAMPLE_RATE)
+};
+#undef ADTS_SAMPLE_RATE
+_Static_assert(sizeof(kADTSSampleRates) / sizeof(kADTSSampleRates[0]) == DHADTS_NUMBER_OF_FREQUENCY_INDEXES, "one sample rate per MPEG-4 frequency index");
+
+//Channel configuration by number of channels; Configuration 7 is 7.1, so 7 channels have none
+static const int kADTSChannelConfigurations[9] = {0, 1, 2, 3, 4, 5, 6, 0, 7};
+
+int DHADTSFrequencyIndexForSampleRate(double sampleRate)
+{
+    for (int i = 0; i < DHADTS_NUMBER_OF_FREQUENCY_INDEXES; i++) {
+        if (kADTSSampleRates[i] == sampleRate) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int DHADTSChannelConfigurationForNumberOfChannels(unsigned int numberOfChannels)
+{
+    if (numberOfChannels >= sizeof(kADTSChannelConfigurations) / sizeof(kADTSChannelConfigurations[0])) {
+        return 0;
+    }
+    return kADTSChannelConfigurations[numberOfChannels];
+}
+
+void DHADTSMakeHeaderTemplate(uint8_t *headerTemplate, int profile, int frequencyIndex, int channelConfiguration)
+{
+    headerTemplate[0] = 0xFF; // 11111111     = syncword
+    headerTemplate[1] = 0xF9; // 1111 1 00 1  = syncword MPEG-2 Layer CRC
+    headerTemplate[2] = (uint8_t)(((profile-1)<<6) + (frequencyIndex<<2) +(channelConfiguration>>2));
+    headerTemplate[3] = (uint8_t)((channelConfiguration&3)<<6);
+    headerTemplate[4] = 0;
+    headerTemplate[5] = 0x1F;
+    headerTemplate[6] = 0xFC;
+}
+
+// Parsing
+
+static inline int isSyncWord(const uint8_t *bytes)
+{
+    //12 bits of sync word, then layer 00
+    return bytes[0] == 0xFF && (bytes[1] & 0xF6) == 0xF0;
+}
+
+int DHADTSParseFrameHeader(const uint8_t *bytes, size_t length, DHADTSFrameHeader *header)
+{
+    if (length < DHADTS_HEADER_LENGTH || !isSyncWord(bytes)) {
+        return 0;
+    }
+    int frequencyIndex = (bytes[2] >> 2) & 0x0F;
+    if (frequencyIndex >= DHADTS_NUMBER_OF_FREQUENCY_INDEXES) {
+        return 0;
+    }
+    int hasCRC = !(bytes[1] & 0x01);
+    int headerLength = hasCRC ? DHADTS_HEADER_LENGTH + 2 : DHADTS_HEADER_LENGTH;
+    int frameLength = ((bytes[3] & 0x03) << 11) | (bytes[4] << 3) | (bytes[5] >> 5);
+    if (frameLength < headerLength) {
+        return 0;
+    }
+    header->profile = (bytes[2] >> 6) + 1;
+    header->frequencyIndex = frequencyIndex;
+    header->sampleRate = kADTSSampleRates[frequencyIndex];
+    header->channelConfiguration = ((bytes[2] & 0x01) << 2) | (bytes[3] >> 6);
+    header->hasCRC = hasCRC;
+    header->headerLength = headerLength;
+    header->frameLength = frameLength;
+    header->numberOfRawDataBlocks = (bytes[6] & 0x03) + 1;
+    return 1;
+}
+
+size_t DHADTSFindSyncWord(const uint8_t *bytes, size_t length, size_t offset)
+{
+    while (offset + 1 < length) {
+        const uint8_t *candidate = memchr(bytes + offset, 0xFF, length - offset - 1);
+        if (candidate == NULL) {
+            return length;
+        }
+        offset = (size_t)(candidate - bytes);
+        if (isSyncWord(candidate)) {
+            return offset;
+        }
+        offset++;
+    }
+    return length;
+}
+
+// Packet Index
+
+static int matchesStream(const DHADTSFrameHeader *header, const DHADTSFrameHeader *reference)
+{
+    return header->frequencyIndex == reference->frequencyIndex &&
+           header->channelConfiguration == reference->channelConfiguration &&
+           header->numberOfRawDataBlocks == reference->numberOfRawDataBlocks;
+}
+
+/**
+ * A frame right after the previous one is trusted when it matches the stream; After a resync, a header is only trusted when the frame ends at the end of the data or right before another matching header, which a sync word inside the payload rarely passes;
+ */
+static int parseFrameAtOffset(const uint8_t *bytes, size_t length, size_t offset, const DHADTSFrameHeader *reference, int isContiguous, DHADTSFrameHeader *header)
+{
+    if (!DHADTSParseFrameHeader(bytes + offset, length - offset, header)) {
+        return 0;
+    }
+    if (reference && !matchesStream(header, reference)) {
+        return 0;
+    }
+    size_t next = offset + (size_t)header->frameLength;
+    if (next > length) {
+        return 0;
+    }
+    DHADTSFrameHeader nextHeader;
+    if (isContiguous || next == length || length - next < DHADTS_HEADER_LENGTH) {
+        return 1;
+    }
+    return DHADTSParseFrameHeader(bytes + next, length - next, &nextHeader) && matchesStream(&nextHeader, header);
+}
+
+static int appendLongSpan(DHADTSPacketIndex *index, size_t packet, uint64_t span)
+{
+    DHADTSLongSpan *longSpans = realloc(index->longSpans, (index->numberOfLongSpans + 1) * sizeof(DHADTSLongSpan));
+    if (longSpans == NULL) {
+        return 0;
+    }
+    longSpans[index->numberOfLongSpans].packet = packet;
+    longSpans[index->numberOfLongSpans].span = span;
+    index->longSpans = longSpans;
+    index->numberOfLongSpans++;
+    return 1;
+}
+
+static uint64_t spanOfPacket(const DHADTSPacketIndex *index, size_t packet)
+{
+    if (index->spans[packet] > 0) {
+        return index->spans[packet];
+    }
+    size_t low = 0;
+    size_t high = index->numberOfLongSpans;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (index->longSpans[middle].packet < packet) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < index->numberOfLongSpans && index->longSpans[low].packet == packet ? index->longSpans[low].span : 0;
+}
+
+static int appendPacket(DHADTSPacketIndex *index, uint64_t offset)
+{
+    if (index->numberOfPackets == index->capacity) {
+        size_t capacity = index->capacity > 0 ? index->capacity * 2 : 1024;
+        uint16_t *spans = realloc(index->spans, capacity * sizeof(uint16_t));
+        if (spans == NULL) {
+            return 0;
+        }
+        index->spans = spans;
+        uint64_t *checkpoints = realloc(index->checkpoints, (capacity / DHADTS_INDEX_CHECKPOINT_INTERVAL + 1) * sizeof(uint64_t));
+        if (checkpoints == NULL) {
+            return 0;
+        }
+        index->checkpoints = checkpoints;
+        index->capacity = capacity;
+    }
+    if (index->numberOfPackets % DHADTS_INDEX_CHECKPOINT_INTERVAL == 0) {
+        index->checkpoints[index->numberOfPackets / DHADTS_INDEX_CHECKPOINT_INTERVAL] = offset;
+    }
+    index->spans[index->numberOfPackets] = 0;
+    index->numberOfPackets++;
+    return 1;
+}
+
+int DHADTSPacketIndexBuild(DHADTSPacketIndex *index, const uint8_t *bytes, size_t length)
+{
+    memset(index, 0, sizeof(DHADTSPacketIndex));
+    DHADTSFrameHeader reference;
+    DHADTSFrameHeader header;
+    int hasReference = 0;
+    uint64_t previousOffset = 0;
+    int isContiguous = 0;
+    size_t offset = DHADTSFindSyncWord(bytes, length, 0);
+    while (offset < length) {
+        if (!parseFrameAtOffset(bytes, length, offset, hasReference ? &reference : NULL, isContiguous, &header)) {
+            offset = DHADTSFindSyncWord(bytes, length, offset + 1);
+            isContiguous = 0;
+            continue;
+        }
+        if (!hasReference) {
+            reference = header;
+            hasReference = 1;
+            index->sampleRate = header.sampleRate;
+            index->channelConfiguration = header.channelConfiguration;
+            index->framesPerPacket = header.numberOfRawDataBlocks * ADTS_FRAMES_PER_RAW_DATA_BLOCK;
+            index->firstPacketOffset = offset;
+        } else {
+            //The span of the previous packet covers any bytes skipped after it
+            uint64_t span = offset - previousOffset;
+            if (span <= UINT16_MAX) {
+                index->spans[index->numberOfPackets - 1] = (uint16_t)span;
+            } else if (appendLongSpan(index, index->numberOfPackets - 1, span)) {
+                index->spans[index->numberOfPackets - 1] = 0;
+            } else {
+                DHADTSPacketIndexDestroy(index);
+                return 0;
+            }
+        }
+        if (!appendPacket(index, offset)) {
+            DHADTSPacketIndexDestroy(index);
+            return 0;
+        }
+        previousOffset = offset;
+        offset += (size_t)header.frameLength;
+        isContiguous = 1;
+        index->spans[index->numberOfPackets - 1] = (uint16_t)header.frameLength;
+    }
+    return index->numberOfPackets > 0;
+}
+
+void DHADTSPacketIndexDestroy(DHADTSPacketIndex *index)
+{
+    free(index->spans);
+    free(index->checkpoints);
+    free(index->longSpans);
+    memset(index, 0, sizeof(DHADTSPacketIndex));
+}
+
+uint64_t DHADTSPacketIndexOffsetOfPacket(const DHADTSPacketIndex *index, size_t packet)
+{
+    if (index->numberOfPackets == 0) {
+        return 0;
+    }
+    if (packet > index->numberOfPackets) {
+        packet = index->numberOfPackets;
+    }
+    size_t checkpoint = packet / DHADTS_INDEX_CHECKPOINT_INTERVAL;
+    size_t first = checkpoint * DHADTS_INDEX_CHECKPOINT_INTERVAL;
+    if (first == index->numberOfPackets) {
+        //The end of the stream right on a checkpoint boundary, step back one block
+        checkpoint--;
+        first -= DHADTS_INDEX_CHECKPOINT_INTERVAL;
+    }
+    uint64_t offset = index->checkpoints[checkpoint];
+    for (size_t i = first; i < packet; i++) {
+        offset += spanOfPacket(index, i);
+    }
+    return offset;
+}
+
+size_t DHADTSPacketIndexPacketForFrame(const DHADTSPacketIndex *index, uint64_t frame)
+{
+    if (index->numberOfPackets == 0) {
+        return 0;
+    }
+    uint64_t packet = frame / (uint64_t)index->framesPerPacket;
+    return packet < index->numberOfPackets ? (size_t)packet : index->numberOfPackets - 1;
+}
+
+uint64_t DHADTSPacketIndexNumberOfFrames(const DHADTSPacketIndex *index)
+{
+    return (uint64_t)index->numberOfPackets * (uint64_t)index->framesPerPacket;
+}
@@ -0,0 +1,132 @@
+//
+//  DHADTSUtilities.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHADTSUtilities_h
+#define DHADTSUtilities_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DHADTS_HEADER_LENGTH 7
+#define DHADTS_PROFILE_AAC_LC 2
+#define DHADTS_NUMBER_OF_FREQUENCY_INDEXES 13
+
+/**
+ * MPEG-4 sampling frequency index of `sampleRate`, -1 if AAC does not support the rate;
+ * The table is in index order, the same order as `DHAudioSampleRate`;
+ */
+int DHADTSFrequencyIndexForSampleRate(double sampleRate);
+
+/**
+ * MPEG-4 channel configuration for `numberOfChannels`, 0 if it has no configuration (it would need a program config element, which ADTS output does not write);
+ */
+int DHADTSChannelConfigurationForNumberOfChannels(unsigned int numberOfChannels);
+
+/**
+ * Fill the 7 bytes that are the same for every ADTS header of a stream; Only the frame length differs per packet, see `DHADTSWriteHeader`;
+ * See: http://wiki.multimedia.cx/index.php?title=ADTS
+ * Also: http://wiki.multimedia.cx/index.php?title=MPEG-4_Audio#Channel_Configurations
+ *
+ * @param headerTemplate 7 bytes
+ * @param profile MPEG-4 Audio Object Type, e.g. `DHADTS_PROFILE_AAC_LC`
+ * @param frequencyIndex MPEG-4 sampling frequency index
+ * @param channelConfiguration MPEG-4 channel configuration
+ */
+void DHADTSMakeHeaderTemplate(uint8_t *headerTemplate, int profile, int frequencyIndex, int channelConfiguration);
+
+/**
+ * Write the ADTS header of a raw AAC packet of `packetLength` bytes; The frame length in the header counts in the header itself;
+ */
+static inline void DHADTSWriteHeader(uint8_t *header, const uint8_t *headerTemplate, size_t packetLength)
+{
+    size_t fullLength = DHADTS_HEADER_LENGTH + packetLength;
+    memcpy(header, headerTemplate, DHADTS_HEADER_LENGTH);
+    header[3] |= (uint8_t)(fullLength>>11);
+    header[4] = (uint8_t)((fullLength&0x7FF) >> 3);
+    header[5] = (uint8_t)(((fullLength&7)<<5) + 0x1F);
+}
+
+// Parsing
+
+/**
+ * The fields of an ADTS frame header;
+ */
+typedef struct {
+    int profile;                //MPEG-4 Audio Object Type, 2 for AAC LC
+    int frequencyIndex;
+    int sampleRate;
+    int channelConfiguration;
+    int hasCRC;
+    int headerLength;           //7, or 9 with CRC
+    int frameLength;            //in bytes, including the header itself
+    int numberOfRawDataBlocks;  //1024 frames each
+} DHADTSFrameHeader;
+
+/**
+ * Parse and validate the ADTS header at `bytes`; Returns 0 if there is no valid header;
+ */
+int DHADTSParseFrameHeader(const uint8_t *bytes, size_t length, DHADTSFrameHeader *header);
+
+/**
+ * Offset of the first ADTS sync word at or after `offset`, or `length` if there is none;
+ * The scan for the 0xFF byte runs through `memchr`, which the C libraries vectorize, and only the candidates are checked bit by bit;
+ */
+size_t DHADTSFindSyncWord(const uint8_t *bytes, size_t length, size_t offset);
+
+// Packet Index
+
+#define DHADTS_INDEX_CHECKPOINT_INTERVAL 64
+
+/**
+ * Offsets of the frames of an ADTS stream, for seeking and duration without scanning;
+ * Each frame costs 2 bytes: the distance to the next frame; The absolute offset of every 64th frame is kept as a checkpoint, so any offset is a checkpoint plus at most 63 additions;
+ * The stream is expected to have the sample rate, channels and raw data blocks per frame of its first frame; Bytes that do not belong to such frames are skipped;
+ * A distance that does not fit 2 bytes, after a gap of more than 64 KB of skipped bytes, is stored as 0 and kept in `longSpans`, so the frames after the gap are indexed too;
+ */
+typedef struct {
+    size_t packet;
+    uint64_t span;
+} DHADTSLongSpan;
+
+typedef struct {
+    uint16_t *spans;
+    uint64_t *checkpoints;
+    DHADTSLongSpan *longSpans;      //ordered by packet
+    size_t numberOfLongSpans;
+    size_t numberOfPackets;
+    size_t capacity;
+    int sampleRate;
+    int channelConfiguration;
+    int framesPerPacket;
+    uint64_t firstPacketOffset;
+} DHADTSPacketIndex;
+
+/**
+ * Index an ADTS stream; Returns 0 if no frame is found or the allocation fails;
+ */
+int DHADTSPacketIndexBuild(DHADTSPacketIndex *index, const uint8_t *bytes, size_t length);
+
+void DHADTSPacketIndexDestroy(DHADTSPacketIndex *index);
+
+/**
+ * Byte offset of packet `packet`; `numberOfPackets` gives the end of the last packet;
+ */
+uint64_t DHADTSPacketIndexOffsetOfPacket(const DHADTSPacketIndex *index, size_t packet);
+
+/**
+ * The packet that contains PCM frame `frame`, clamped to the last packet;
+ */
+size_t DHADTSPacketIndexPacketForFrame(const DHADTSPacketIndex *index, uint64_t frame);
+
+/**
+ * Total number of PCM frames of the stream;
+ */
+uint64_t DHADTSPacketIndexNumberOfFrames(const DHADTSPacketIndex *index);
+
+#endif /* DHADTSUtilities_h */
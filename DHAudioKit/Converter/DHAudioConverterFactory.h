@@ -9,6 +9,7 @@
 #import <Foundation/Foundation.h>
 #import "DHAudioConverter.h"
 #import "DHAudioAttributes.h"
+#import "DHMP3EncoderProfile.h"
 @interface DHAudioConverterFactory : NSObject
 /**
  * Create converter，currently we only support conversion from PCM to other compressed formats；
@@ -62,4 +63,30 @@
  */
 + (AudioStreamBasicDescription) defaultDestinationFormatForAudioType:(DHAudioType)audioType
                                                         sourceFormat:(AudioStreamBasicDescription)sourceFormat;
+
+/**
+ * The most channels a converter to `audioType` encodes, 0 if there is no limit;
+ * Opus takes up to 8 channels: mono and stereo are one Opus stream, 3 - 8 channels are encoded as a multistream in Vorbis channel order (mapping family 1, e.g. L, C, R, Ls, Rs, LFE for 5.1), which `DHOpusAudioFilePlayer` decodes;
+ */
++ (UInt32) maximumNumberOfChannelsForAudioType:(DHAudioType)audioType;
+
+/**
+ * Create MP3 converter with the given LAME encoder settings;
+ * @param profile the LAME encoder settings, e.g. `[DHMP3EncoderProfile voiceProfile]`
+ * @param sourceFormat Source Linear PCM data format
+ * @param delegate Converter delegate
+ * @param delegateQueue the queue on which the delegate is running
+ * @return instance of AudioConverter
+ */
++ (DHAudioConverter *) mp3AudioConverterWithProfile:(DHMP3EncoderProfile *)profile
+                                       sourceFormat:(AudioStreamBasicDescription)sourceFormat
+                                           delegate:(id<DHAudioConverterDelegate>)delegate
+                                      delegateQueue:(dispatch_queue_t)delegateQueue;
+
+/**
+ * MP3 target format for the profile;
+ * Sample rate and channel count come from the profile, or from the source format when the profile keeps them;
+ */
++ (AudioStreamBasicDescription) destinationFormatForMP3EncoderProfile:(DHMP3EncoderProfile *)profile
+                                                         sourceFormat:(AudioStreamBasicDescription)sourceFormat;
 @end
@@ -10,6 +10,7 @@
 #import "DHAACAudioConverter.h"
 #import "DHMP3AudioConverter.h"
 #import "DHOpusAudioConverter.h"
+#import "DHOpusUtilities.h"
 
 @implementation DHAudioConverterFactory
 
@@ -85,9 +86,71 @@
         destinationFormat.mBytesPerFrame = 0;
         destinationFormat.mBitsPerChannel = 0;
         destinationFormat.mReserved = 0;
+    } else if (audioType == DHAudioTypeMP3) {
+        destinationFormat = [DHAudioConverterFactory destinationFormatForMP3EncoderProfile:[DHMP3EncoderProfile defaultProfile]
+                                                                              sourceFormat:sourceFormat];
+    } else if (audioType == DHAudioTypeOpus) {
+        destinationFormat.mSampleRate = [DHAudioConverterFactory opusSampleRateForSampleRate:sourceFormat.mSampleRate];
     }
     return destinationFormat;
 }
 
++ (UInt32) maximumNumberOfChannelsForAudioType:(DHAudioType)audioType
+{
+    switch (audioType) {
+        case DHAudioTypeAAC:
+            return 8;       //7.1 is the largest MPEG-4 channel configuration
+        case DHAudioTypeMP3:
+            return 2;
+        case DHAudioTypeOpus:
+            return DHOPUS_MAXIMUM_NUMBER_OF_CHANNELS;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * The lowest rate Opus encodes that keeps the whole band of `sampleRate`; The Opus converter resamples to it;
+ */
++ (Float64) opusSampleRateForSampleRate:(Float64)sampleRate
+{
+    static const Float64 opusSampleRates[] = {DHAudioSampleRate8000, DHAudioSampleRate12000, DHAudioSampleRate16000, DHAudioSampleRate24000, DHAudioSampleRate48000};
+    for (int i = 0; i < sizeof(opusSampleRates) / sizeof(opusSampleRates[0]); i++) {
+        if (opusSampleRates[i] >= sampleRate) {
+            return opusSampleRates[i];
+        }
+    }
+    return DHAudioSampleRate48000;
+}
+
++ (DHAudioConverter *) mp3AudioConverterWithProfile:(DHMP3EncoderProfile *)profile
+                                       sourceFormat:(AudioStreamBasicDescription)sourceFormat
+                                           delegate:(id<DHAudioConverterDelegate>)delegate
+                                      delegateQueue:(dispatch_queue_t)delegateQueue
+{
+    AudioStreamBasicDescription destinationFormat = [DHAudioConverterFactory destinationFormatForMP3EncoderProfile:profile
+                                                                                                      sourceFormat:sourceFormat];
+    return [[DHMP3AudioConverter alloc] initWithInputAudioFormat:sourceFormat
+                                               outputAudioFormat:destinationFormat
+                                                         profile:profile
+                                                        delegate:delegate
+                                                   delegateQueue:delegateQueue];
+}
+
++ (AudioStreamBasicDescription) destinationFormatForMP3EncoderProfile:(DHMP3EncoderProfile *)profile
+                                                         sourceFormat:(AudioStreamBasicDescription)sourceFormat
+{
+    AudioStreamBasicDescription destinationFormat = {0};
+    destinationFormat.mFormatID = kAudioFormatMPEGLayer3;
+    destinationFormat.mSampleRate = profile.sampleRate > 0 ? profile.sampleRate : sourceFormat.mSampleRate;
+    destinationFormat.mChannelsPerFrame = profile.numberOfChannels > 0 ? profile.numberOfChannels : sourceFormat.mChannelsPerFrame;
+    destinationFormat.mFramesPerPacket = destinationFormat.mSampleRate >= DHAudioSampleRate32000 ? 1152 : 576;     //MPEG-1 Layer III frames have 1152 samples, MPEG-2/2.5 have 576
+    destinationFormat.mBytesPerPacket = 0;
+    destinationFormat.mBytesPerFrame = 0;
+    destinationFormat.mBitsPerChannel = 0;
+    destinationFormat.mReserved = 0;
+    return destinationFormat;
+}
+
 @end
 
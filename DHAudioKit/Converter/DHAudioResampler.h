@@ -0,0 +1,45 @@
+//
+//  DHAudioResampler.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "DHResampler.h"
+
+/**
+ * Sample rate conversion stage for 16-bit or float interleaved PCM, to put in front of a `DHAudioConverter` whose codec can not resample itself, e.g. to record at the device's native 48 kHz and encode Opus at 16 kHz;
+ * See `DHResampler.h` for the filter; Not thread safe, call it from one queue;
+ */
+@interface DHAudioResampler : NSObject
+
+/**
+ * The input format with the output sample rate;
+ */
+@property (nonatomic, readonly) AudioStreamBasicDescription outputFormat;
+
+/**
+ * Initializer
+ * @param inFormat Source format, 16-bit signed integer or 32-bit float interleaved PCM
+ * @param sampleRate Target sample rate
+ * @param quality Filter length, see `DHResamplerQuality`
+ * @return nil if the format is not supported
+ */
+- (instancetype) initWithInputFormat:(AudioStreamBasicDescription)inFormat
+                    outputSampleRate:(Float64)sampleRate
+                             quality:(DHResamplerQuality)quality;
+
+/**
+ * Resample a chunk of PCM; Chunks can be of any size, the filter state is kept between calls;
+ */
+- (NSData *) resampleData:(NSData *)data;
+
+/**
+ * The frames still held back by the filter at the end of a stream; The resampler is ready for a new stream afterwards;
+ */
+- (NSData *) flush;
+
+@end
@@ -0,0 +1,78 @@
+//
+//  DHAudioResampler.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioResampler.h"
+
+@interface DHAudioResampler () {
+    DHResampler *resampler;
+}
+@property (nonatomic, readwrite) AudioStreamBasicDescription outputFormat;
+@property (nonatomic) BOOL isFloat;
+@end
+
+@implementation DHAudioResampler
+
+- (instancetype) initWithInputFormat:(AudioStreamBasicDescription)inFormat
+                    outputSampleRate:(Float64)sampleRate
+                             quality:(DHResamplerQuality)quality
+{
+    self = [super init];
+    if (self) {
+        BOOL isInterleaved = inFormat.mFormatID == kAudioFormatLinearPCM && !(inFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved);
+        BOOL isSigned16Bit = (inFormat.mFormatFlags & kAudioFormatFlagIsSignedInteger) && inFormat.mBitsPerChannel == 16;
+        _isFloat = (inFormat.mFormatFlags & kAudioFormatFlagIsFloat) && inFormat.mBitsPerChannel == 32;
+        if (!isInterleaved || !(isSigned16Bit || _isFloat)) {
+            return nil;
+        }
+        resampler = DHResamplerCreate((int)inFormat.mSampleRate, (int)sampleRate, (int)inFormat.mChannelsPerFrame, quality);
+        if (resampler == NULL) {
+            return nil;
+        }
+        _outputFormat = inFormat;
+        _outputFormat.mSampleRate = sampleRate;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    DHResamplerDestroy(resampler);
+}
+
+- (NSData *) resampleData:(NSData *)data
+{
+    size_t numberOfFrames = [data length] / self.outputFormat.mBytesPerFrame;
+    size_t capacity = DHResamplerMaximumOutputFrames(resampler, numberOfFrames) * self.outputFormat.mBytesPerFrame;
+    void *output = malloc(capacity);
+    size_t numberOfOutputFrames = 0;
+    if (self.isFloat) {
+        numberOfOutputFrames = DHResamplerProcessFloat32(resampler, [data bytes], numberOfFrames, output);
+    } else {
+        numberOfOutputFrames = DHResamplerProcess(resampler, [data bytes], numberOfFrames, output);
+    }
+    return [self dataWithBytes:output numberOfFrames:numberOfOutputFrames];
+}
+
+- (NSData *) flush
+{
+    size_t capacity = DHResamplerMaximumOutputFrames(resampler, 0) * self.outputFormat.mBytesPerFrame;
+    void *output = malloc(capacity);
+    size_t numberOfOutputFrames = self.isFloat ? DHResamplerFlushFloat32(resampler, output) : DHResamplerFlush(resampler, output);
+    return [self dataWithBytes:output numberOfFrames:numberOfOutputFrames];
+}
+
+- (NSData *) dataWithBytes:(void *)bytes numberOfFrames:(size_t)numberOfFrames
+{
+    if (bytes == NULL || numberOfFrames == 0) {
+        free(bytes);
+        return [NSData data];
+    }
+    return [NSData dataWithBytesNoCopy:bytes length:numberOfFrames * self.outputFormat.mBytesPerFrame freeWhenDone:YES];
+}
+
+@end
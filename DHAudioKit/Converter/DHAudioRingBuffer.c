@@ -0,0 +1,105 @@
+//
+//  DHAudioRingBuffer.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "DHAudioRingBuffer.h"
+
+int DHAudioRingBufferInit(DHAudioRingBuffer *buffer, size_t capacity)
+{
+    memset(buffer, 0, sizeof(DHAudioRingBuffer));
+    if (capacity == 0) {
+        return 1;
+    }
+    buffer->bytes = malloc(capacity);
+    if (buffer->bytes == NULL) {
+        return 0;
+    }
+    buffer->capacity = capacity;
+    return 1;
+}
+
+void DHAudioRingBufferDestroy(DHAudioRingBuffer *buffer)
+{
+    free(buffer->bytes);
+    memset(buffer, 0, sizeof(DHAudioRingBuffer));
+}
+
+int DHAudioRingBufferReserve(DHAudioRingBuffer *buffer, size_t capacity)
+{
+    if (capacity <= buffer->capacity) {
+        return 1;
+    }
+    uint8_t *bytes = malloc(capacity);
+    if (bytes == NULL) {
+        return 0;
+    }
+    //Unwrap the buffered bytes to the start of the new storage
+    size_t length = buffer->length;
+    DHAudioRingBufferRead(buffer, bytes, length);
+    free(buffer->bytes);
+    buffer->bytes = bytes;
+    buffer->capacity = capacity;
+    buffer->readIndex = 0;
+    buffer->length = length;
+    return 1;
+}
+
+size_t DHAudioRingBufferWrite(DHAudioRingBuffer *buffer, const void *bytes, size_t length)
+{
+    if (length == 0) {
+        return 0;
+    }
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : length;
+        while (capacity < buffer->length + length) {
+            capacity *= 2;
+        }
+        if (!DHAudioRingBufferReserve(buffer, capacity)) {
+            return 0;
+        }
+    }
+    size_t writeIndex = (buffer->readIndex + buffer->length) % buffer->capacity;
+    size_t firstPart = buffer->capacity - writeIndex;
+    if (firstPart > length) {
+        firstPart = length;
+    }
+    memcpy(buffer->bytes + writeIndex, bytes, firstPart);
+    memcpy(buffer->bytes, (const uint8_t *)bytes + firstPart, length - firstPart);
+    buffer->length += length;
+    return length;
+}
+
+size_t DHAudioRingBufferRead(DHAudioRingBuffer *buffer, void *destination, size_t length)
+{
+    if (length > buffer->length) {
+        length = buffer->length;
+    }
+    if (length == 0) {
+        return 0;
+    }
+    size_t firstPart = buffer->capacity - buffer->readIndex;
+    if (firstPart > length) {
+        firstPart = length;
+    }
+    memcpy(destination, buffer->bytes + buffer->readIndex, firstPart);
+    memcpy((uint8_t *)destination + firstPart, buffer->bytes, length - firstPart);
+    buffer->readIndex = (buffer->readIndex + length) % buffer->capacity;
+    buffer->length -= length;
+    if (buffer->length == 0) {
+        buffer->readIndex = 0;
+    }
+    return length;
+}
+
+void DHAudioRingBufferReset(DHAudioRingBuffer *buffer)
+{
+    buffer->readIndex = 0;
+    buffer->length = 0;
+}
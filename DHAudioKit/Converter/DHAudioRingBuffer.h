@@ -0,0 +1,55 @@
+//
+//  DHAudioRingBuffer.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHAudioRingBuffer_h
+#define DHAudioRingBuffer_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A byte FIFO for carrying audio across calls; It is not thread safe, use it from a single queue;
+ */
+typedef struct {
+    uint8_t *bytes;
+    size_t capacity;
+    size_t readIndex;
+    size_t length;
+} DHAudioRingBuffer;
+
+/**
+ * Allocate the storage; Returns 0 if the allocation fails;
+ */
+int DHAudioRingBufferInit(DHAudioRingBuffer *buffer, size_t capacity);
+
+/**
+ * Release the storage; The buffer can be initialized again afterwards;
+ */
+void DHAudioRingBufferDestroy(DHAudioRingBuffer *buffer);
+
+/**
+ * Grow the storage to at least `capacity` bytes, keeping the buffered bytes; Returns 0 if the allocation fails;
+ */
+int DHAudioRingBufferReserve(DHAudioRingBuffer *buffer, size_t capacity);
+
+/**
+ * Append `length` bytes, growing the storage when needed; Returns the number of bytes written, which is 0 if the storage could not grow;
+ */
+size_t DHAudioRingBufferWrite(DHAudioRingBuffer *buffer, const void *bytes, size_t length);
+
+/**
+ * Move up to `length` bytes into `destination`; Returns the number of bytes read;
+ */
+size_t DHAudioRingBufferRead(DHAudioRingBuffer *buffer, void *destination, size_t length);
+
+/**
+ * Drop all the buffered bytes;
+ */
+void DHAudioRingBufferReset(DHAudioRingBuffer *buffer);
+
+#endif /* DHAudioRingBuffer_h */
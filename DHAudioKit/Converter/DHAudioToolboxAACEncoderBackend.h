@@ -0,0 +1,25 @@
+//
+//  DHAudioToolboxAACEncoderBackend.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAACEncoderBackend.h"
+
+/**
+ * AAC-LC through AudioToolbox's `AudioConverterRef`; The default backend of `DHAACAudioConverter`;
+ */
+@interface DHAudioToolboxAACEncoderBackend : NSObject <DHAACEncoderBackend>
+
+/**
+ * @param inFormat Source Linear PCM format
+ * @param outFormat Target AAC format
+ * @param status set to the AudioToolbox error code when nil is returned
+ */
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                   status:(OSStatus *)status;
+
+@end
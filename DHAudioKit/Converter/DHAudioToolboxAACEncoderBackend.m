@@ -0,0 +1,154 @@
+//
+//  DHAudioToolboxAACEncoderBackend.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAudioToolboxAACEncoderBackend.h"
+
+#define AAC_MAX_PACKET_SIZE_PER_CHANNEL 768    //6144 bits per channel per raw data block
+#define AAC_ENCODER_DELAY 2112                 //Priming of Apple's AAC-LC encoder, see Technical Note TN2258
+
+//Returned from the input proc once the frames of the current call are handed over; It is not an error
+static const OSStatus kDHAACNoMoreInputDataForNow = 'nmid';
+
+@interface DHAudioToolboxAACEncoderBackend () {
+    AudioConverterRef mConverter;
+    const void *pendingFrames;
+    UInt32 numberOfPendingFrames;
+    BOOL isDraining;
+}
+@property (nonatomic) AudioStreamBasicDescription inFormat;
+@property (nonatomic) AudioStreamBasicDescription outFormat;
+@property (nonatomic, readwrite) UInt32 maximumOutputPacketSize;
+@end
+
+@implementation DHAudioToolboxAACEncoderBackend
+
+@synthesize bitRate = _bitRate;
+
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                   status:(OSStatus *)status
+{
+    self = [super init];
+    if (self) {
+        _inFormat = inFormat;
+        _outFormat = outFormat;
+        OSStatus result = AudioConverterNew(&inFormat, &outFormat, &mConverter);
+        if (result != noErr) {
+            if (status) {
+                *status = result;
+            }
+            return nil;
+        }
+        UInt32 maximumOutputPacketSize = 0;
+        UInt32 size = sizeof(maximumOutputPacketSize);
+        result = AudioConverterGetProperty(mConverter, kAudioConverterPropertyMaximumOutputPacketSize, &size, &maximumOutputPacketSize);
+        if (result != noErr || maximumOutputPacketSize == 0) {
+            maximumOutputPacketSize = AAC_MAX_PACKET_SIZE_PER_CHANNEL * MAX(outFormat.mChannelsPerFrame, 1);
+        }
+        _maximumOutputPacketSize = maximumOutputPacketSize;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    if (mConverter) {
+        AudioConverterDispose(mConverter);
+    }
+}
+
+- (UInt32) encoderDelay
+{
+    return AAC_ENCODER_DELAY;
+}
+
+- (void) setBitRate:(UInt32)bitRate
+{
+    _bitRate = bitRate;
+    if (bitRate > 0) {
+        AudioConverterSetProperty(mConverter, kAudioConverterEncodeBitRate, sizeof(bitRate), &bitRate);
+    }
+}
+
+#pragma mark - DHAACEncoderBackend
+- (OSStatus) encodeFrames:(const void *)frames
+           numberOfFrames:(UInt32)numberOfFrames
+             outputBuffer:(uint8_t *)outputBuffer
+         outputBufferSize:(UInt32)outputBufferSize
+       packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+          numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    pendingFrames = frames;
+    numberOfPendingFrames = numberOfFrames;
+    return [self fillOutputBuffer:outputBuffer outputBufferSize:outputBufferSize packetDescriptions:packetDescriptions numberOfPackets:ioNumberOfPackets];
+}
+
+- (OSStatus) drainToOutputBuffer:(uint8_t *)outputBuffer
+                outputBufferSize:(UInt32)outputBufferSize
+              packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                 numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    isDraining = YES;
+    return [self fillOutputBuffer:outputBuffer outputBufferSize:outputBufferSize packetDescriptions:packetDescriptions numberOfPackets:ioNumberOfPackets];
+}
+
+- (void) reset
+{
+    isDraining = NO;
+    pendingFrames = NULL;
+    numberOfPendingFrames = 0;
+    AudioConverterReset(mConverter);
+}
+
+- (OSStatus) fillOutputBuffer:(uint8_t *)outputBuffer
+             outputBufferSize:(UInt32)outputBufferSize
+           packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+              numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    AudioBufferList outBufferList = {0};
+    outBufferList.mNumberBuffers = 1;
+    outBufferList.mBuffers[0].mNumberChannels = self.outFormat.mChannelsPerFrame;
+    outBufferList.mBuffers[0].mDataByteSize = outputBufferSize;
+    outBufferList.mBuffers[0].mData = outputBuffer;
+    
+    OSStatus status = AudioConverterFillComplexBuffer(mConverter, AACInputDataProc, (__bridge void *)self, ioNumberOfPackets, &outBufferList, packetDescriptions);
+    return status == kDHAACNoMoreInputDataForNow ? noErr : status;
+}
+
+#pragma mark - Converter Call Back
+- (OSStatus) fillInputBufferList:(AudioBufferList *)ioData numberOfPackets:(UInt32 *)ioNumberDataPackets
+{
+    if (numberOfPendingFrames == 0) {
+        *ioNumberDataPackets = 0;
+        ioData->mBuffers[0].mData = NULL;
+        ioData->mBuffers[0].mDataByteSize = 0;
+        //noErr with no packets marks the end of the stream, so the encoder drains what it holds back
+        return isDraining ? noErr : kDHAACNoMoreInputDataForNow;
+    }
+    UInt32 frames = MIN(*ioNumberDataPackets, numberOfPendingFrames);
+    *ioNumberDataPackets = frames;
+    ioData->mBuffers[0].mData = (void *)pendingFrames;
+    ioData->mBuffers[0].mDataByteSize = frames * self.inFormat.mBytesPerPacket;
+    ioData->mBuffers[0].mNumberChannels = self.inFormat.mChannelsPerFrame;
+    
+    pendingFrames = (const uint8_t *)pendingFrames + ioData->mBuffers[0].mDataByteSize;
+    numberOfPendingFrames -= frames;
+    return noErr;
+}
+
+OSStatus AACInputDataProc(AudioConverterRef inAudioConverter,
+                          UInt32 *ioNumberDataPackets,
+                          AudioBufferList *ioData,
+                          AudioStreamPacketDescription **outDataPacketDescription,
+                          void *inUserData)
+{
+    DHAudioToolboxAACEncoderBackend *backend = (__bridge DHAudioToolboxAACEncoderBackend *)inUserData;
+    return [backend fillInputBufferList:ioData numberOfPackets:ioNumberDataPackets];
+}
+
+@end
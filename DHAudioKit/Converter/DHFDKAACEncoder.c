@@ -0,0 +1,177 @@
+//
+//  DHFDKAACEncoder.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+
+#include "DHFDKAACEncoder.h"
+
+#if DH_ENABLE_FDK_AAC
+
+#include <fdk-aac/aacenc_lib.h>
+
+#define DEFAULT_BIT_RATE_PER_CHANNEL 64000
+
+struct DHFDKAACEncoder {
+    HANDLE_AACENCODER handle;
+    int numberOfChannels;
+    size_t maximumPacketSize;
+    int delay;
+};
+
+DHFDKAACEncoder *DHFDKAACEncoderCreate(int sampleRate, int numberOfChannels, int bitRate, int *error)
+{
+    if (numberOfChannels < 1 || numberOfChannels > 2 || sampleRate <= 0) {
+        *error = DHFDKAACEncoderErrorInvalidParameter;
+        return NULL;
+    }
+    DHFDKAACEncoder *encoder = calloc(1, sizeof(DHFDKAACEncoder));
+    if (encoder == NULL) {
+        *error = DHFDKAACEncoderErrorOutOfMemory;
+        return NULL;
+    }
+    encoder->numberOfChannels = numberOfChannels;
+    if (aacEncOpen(&encoder->handle, 0, numberOfChannels) != AACENC_OK) {
+        free(encoder);
+        *error = DHFDKAACEncoderErrorOutOfMemory;
+        return NULL;
+    }
+    if (bitRate <= 0) {
+        bitRate = DEFAULT_BIT_RATE_PER_CHANNEL * numberOfChannels;
+    }
+    AACENC_InfoStruct info = {0};
+    if (aacEncoder_SetParam(encoder->handle, AACENC_AOT, AOT_AAC_LC) != AACENC_OK ||
+        aacEncoder_SetParam(encoder->handle, AACENC_SAMPLERATE, sampleRate) != AACENC_OK ||
+        aacEncoder_SetParam(encoder->handle, AACENC_CHANNELMODE, numberOfChannels == 1 ? MODE_1 : MODE_2) != AACENC_OK ||
+        aacEncoder_SetParam(encoder->handle, AACENC_CHANNELORDER, 1) != AACENC_OK ||
+        aacEncoder_SetParam(encoder->handle, AACENC_BITRATE, bitRate) != AACENC_OK ||
+        aacEncoder_SetParam(encoder->handle, AACENC_TRANSMUX, TT_MP4_RAW) != AACENC_OK ||
+        aacEncEncode(encoder->handle, NULL, NULL, NULL, NULL) != AACENC_OK ||
+        aacEncInfo(encoder->handle, &info) != AACENC_OK) {
+        DHFDKAACEncoderDestroy(encoder);
+        *error = DHFDKAACEncoderErrorInvalidParameter;
+        return NULL;
+    }
+    encoder->maximumPacketSize = info.maxOutBufBytes;
+    encoder->delay = (int)info.nDelay;
+    *error = DHFDKAACEncoderErrorNone;
+    return encoder;
+}
+
+void DHFDKAACEncoderDestroy(DHFDKAACEncoder *encoder)
+{
+    if (encoder == NULL) {
+        return;
+    }
+    if (encoder->handle) {
+        aacEncClose(&encoder->handle);
+    }
+    free(encoder);
+}
+
+size_t DHFDKAACEncoderMaximumPacketSize(const DHFDKAACEncoder *encoder)
+{
+    return encoder->maximumPacketSize;
+}
+
+int DHFDKAACEncoderDelay(const DHFDKAACEncoder *encoder)
+{
+    return encoder->delay;
+}
+
+int DHFDKAACEncoderEncode(DHFDKAACEncoder *encoder,
+                          const int16_t *frames,
+                          int numberOfFrames,
+                          uint8_t *packet,
+                          size_t capacity,
+                          size_t *packetLength)
+{
+    *packetLength = 0;
+
+    void *inputBuffer = (void *)frames;
+    int inputIdentifier = IN_AUDIO_DATA;
+    int inputSize = numberOfFrames * encoder->numberOfChannels * (int)sizeof(int16_t);
+    int inputElementSize = sizeof(int16_t);
+    AACENC_BufDesc input = {0};
+    input.numBufs = 1;
+    input.bufs = &inputBuffer;
+    input.bufferIdentifiers = &inputIdentifier;
+    input.bufSizes = &inputSize;
+    input.bufElSizes = &inputElementSize;
+
+    void *outputBuffer = packet;
+    int outputIdentifier = OUT_BITSTREAM_DATA;
+    int outputSize = (int)capacity;
+    int outputElementSize = 1;
+    AACENC_BufDesc output = {0};
+    output.numBufs = 1;
+    output.bufs = &outputBuffer;
+    output.bufferIdentifiers = &outputIdentifier;
+    output.bufSizes = &outputSize;
+    output.bufElSizes = &outputElementSize;
+
+    AACENC_InArgs inArgs = {0};
+    AACENC_OutArgs outArgs = {0};
+    //-1 input samples asks the encoder to drain
+    inArgs.numInSamples = numberOfFrames > 0 ? numberOfFrames * encoder->numberOfChannels : -1;
+
+    AACENC_ERROR status = aacEncEncode(encoder->handle, &input, &output, &inArgs, &outArgs);
+    if (status == AACENC_ENCODE_EOF) {
+        return DHFDKAACEncoderErrorNone;
+    }
+    if (status != AACENC_OK) {
+        return DHFDKAACEncoderErrorEncoding;
+    }
+    *packetLength = (size_t)outArgs.numOutBytes;
+    return DHFDKAACEncoderErrorNone;
+}
+
+#else
+
+DHFDKAACEncoder *DHFDKAACEncoderCreate(int sampleRate, int numberOfChannels, int bitRate, int *error)
+{
+    (void)sampleRate;
+    (void)numberOfChannels;
+    (void)bitRate;
+    *error = DHFDKAACEncoderErrorUnavailable;
+    return NULL;
+}
+
+void DHFDKAACEncoderDestroy(DHFDKAACEncoder *encoder)
+{
+    (void)encoder;
+}
+
+size_t DHFDKAACEncoderMaximumPacketSize(const DHFDKAACEncoder *encoder)
+{
+    (void)encoder;
+    return 0;
+}
+
+int DHFDKAACEncoderDelay(const DHFDKAACEncoder *encoder)
+{
+    (void)encoder;
+    return 0;
+}
+
+int DHFDKAACEncoderEncode(DHFDKAACEncoder *encoder,
+                          const int16_t *frames,
+                          int numberOfFrames,
+                          uint8_t *packet,
+                          size_t capacity,
+                          size_t *packetLength)
+{
+    (void)encoder;
+    (void)frames;
+    (void)numberOfFrames;
+    (void)packet;
+    (void)capacity;
+    *packetLength = 0;
+    return DHFDKAACEncoderErrorUnavailable;
+}
+
+#endif
@@ -0,0 +1,65 @@
+//
+//  DHFDKAACEncoder.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHFDKAACEncoder_h
+#define DHFDKAACEncoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A portable AAC-LC encoder on top of the Fraunhofer FDK AAC library; It has no Apple dependency, so the same encoder and `DHADTSUtilities` framing build on Linux servers;
+ * Compiled only when `DH_ENABLE_FDK_AAC` is defined to 1 and `<fdk-aac/aacenc_lib.h>` and libfdk-aac are available; Otherwise `DHFDKAACEncoderCreate` fails with `DHFDKAACEncoderErrorUnavailable`;
+ *
+ * The encoder outputs raw AAC packets (no transport), one packet per 1024 frames of 16-bit interleaved PCM;
+ */
+typedef struct DHFDKAACEncoder DHFDKAACEncoder;
+
+typedef enum {
+    DHFDKAACEncoderErrorNone = 0,
+    DHFDKAACEncoderErrorUnavailable = -1,
+    DHFDKAACEncoderErrorInvalidParameter = -2,
+    DHFDKAACEncoderErrorOutOfMemory = -3,
+    DHFDKAACEncoderErrorEncoding = -4,
+} DHFDKAACEncoderError;
+
+/**
+ * @param sampleRate any AAC sampling frequency
+ * @param numberOfChannels 1 or 2
+ * @param bitRate bits per second; 0 uses 64 kbps per channel
+ * @param error set when NULL is returned
+ */
+DHFDKAACEncoder *DHFDKAACEncoderCreate(int sampleRate, int numberOfChannels, int bitRate, int *error);
+
+void DHFDKAACEncoderDestroy(DHFDKAACEncoder *encoder);
+
+/**
+ * The largest packet the encoder produces, use it to size output buffers;
+ */
+size_t DHFDKAACEncoderMaximumPacketSize(const DHFDKAACEncoder *encoder);
+
+/**
+ * Frames of priming per channel the encoder puts before the audio, `nDelay` of the encoder info;
+ */
+int DHFDKAACEncoderDelay(const DHFDKAACEncoder *encoder);
+
+/**
+ * Encode up to 1024 frames; The encoder delays its output, so a call can produce no packet;
+ * Pass NULL and 0 frames to drain the delayed packets at the end of the stream, until no packet is returned;
+ *
+ * @param packetLength set to the length of the packet written to `packet`, 0 if there is none
+ * @return `DHFDKAACEncoderErrorNone` or an error code
+ */
+int DHFDKAACEncoderEncode(DHFDKAACEncoder *encoder,
+                          const int16_t *frames,
+                          int numberOfFrames,
+                          uint8_t *packet,
+                          size_t capacity,
+                          size_t *packetLength);
+
+#endif /* DHFDKAACEncoder_h */
@@ -0,0 +1,26 @@
+//
+//  DHFDKAACEncoderBackend.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHAACEncoderBackend.h"
+
+/**
+ * AAC-LC through the Fraunhofer FDK AAC library, see `DHFDKAACEncoder.h`; Requires `DH_ENABLE_FDK_AAC` and libfdk-aac, otherwise the initializer returns nil;
+ * FDK AAC takes 16-bit interleaved PCM, other sample formats and mono/stereo input are converted with `DHPCMFormatConverter`; The input has to be at the output sample rate, as FDK AAC does not resample;
+ */
+@interface DHFDKAACEncoderBackend : NSObject <DHAACEncoderBackend>
+
+/**
+ * @param inFormat Source Linear PCM format
+ * @param outFormat Target AAC format
+ * @param status set to a `DHFDKAACEncoderError` when nil is returned
+ */
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                   status:(OSStatus *)status;
+
+@end
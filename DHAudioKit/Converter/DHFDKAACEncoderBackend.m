@@ -0,0 +1,153 @@
+//
+//  DHFDKAACEncoderBackend.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHFDKAACEncoderBackend.h"
+#import "DHFDKAACEncoder.h"
+#import "DHPCMFormatConverter.h"
+
+@interface DHFDKAACEncoderBackend () {
+    DHFDKAACEncoder *encoder;
+}
+@property (nonatomic) AudioStreamBasicDescription inFormat;
+@property (nonatomic) AudioStreamBasicDescription outFormat;
+@property (nonatomic, strong) DHPCMFormatConverter *formatConverter;
+@property (nonatomic, strong) NSMutableData *convertedFrames;
+@end
+
+@implementation DHFDKAACEncoderBackend
+
+@synthesize bitRate = _bitRate;
+
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                   status:(OSStatus *)status
+{
+    self = [super init];
+    if (self) {
+        _inFormat = inFormat;
+        _outFormat = outFormat;
+        AudioStreamBasicDescription encoderInputFormat = [DHPCMFormatConverter signed16BitFormatWithSampleRate:outFormat.mSampleRate
+                                                                                            numberOfChannels:outFormat.mChannelsPerFrame];
+        BOOL needsConversion = [DHPCMFormatConverter needsConversionFromFormat:inFormat toFormat:encoderInputFormat];
+        if (needsConversion) {
+            _formatConverter = [[DHPCMFormatConverter alloc] initWithInputFormat:inFormat outputFormat:encoderInputFormat];
+            _convertedFrames = [NSMutableData data];
+        }
+        if (inFormat.mSampleRate != outFormat.mSampleRate || (needsConversion && _formatConverter == nil)) {
+            if (status) {
+                *status = DHFDKAACEncoderErrorInvalidParameter;
+            }
+            return nil;
+        }
+        if (![self createEncoderWithStatus:status]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    DHFDKAACEncoderDestroy(encoder);
+}
+
+- (BOOL) createEncoderWithStatus:(OSStatus *)status
+{
+    int error = DHFDKAACEncoderErrorNone;
+    DHFDKAACEncoder *newEncoder = DHFDKAACEncoderCreate((int)self.outFormat.mSampleRate, (int)self.outFormat.mChannelsPerFrame, (int)self.bitRate, &error);
+    if (newEncoder == NULL) {
+        if (status) {
+            *status = error;
+        }
+        return NO;
+    }
+    DHFDKAACEncoderDestroy(encoder);
+    encoder = newEncoder;
+    return YES;
+}
+
+- (UInt32) maximumOutputPacketSize
+{
+    return (UInt32)DHFDKAACEncoderMaximumPacketSize(encoder);
+}
+
+- (UInt32) encoderDelay
+{
+    return (UInt32)DHFDKAACEncoderDelay(encoder);
+}
+
+- (void) setBitRate:(UInt32)bitRate
+{
+    _bitRate = bitRate;
+    [self createEncoderWithStatus:NULL];
+}
+
+#pragma mark - DHAACEncoderBackend
+- (OSStatus) encodeFrames:(const void *)frames
+           numberOfFrames:(UInt32)numberOfFrames
+             outputBuffer:(uint8_t *)outputBuffer
+         outputBufferSize:(UInt32)outputBufferSize
+       packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+          numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    if (numberOfFrames == 0) {
+        *ioNumberOfPackets = 0;
+        return noErr;
+    }
+    if (self.formatConverter) {
+        [self.convertedFrames setLength:numberOfFrames * self.formatConverter.outputFormat.mBytesPerFrame];
+        if (![self.formatConverter convertFrames:frames numberOfFrames:numberOfFrames toBuffer:[self.convertedFrames mutableBytes]]) {
+            return DHFDKAACEncoderErrorOutOfMemory;
+        }
+        frames = [self.convertedFrames bytes];
+    }
+    return [self encodeOnePacketFromFrames:frames numberOfFrames:numberOfFrames outputBuffer:outputBuffer outputBufferSize:outputBufferSize packetDescriptions:packetDescriptions numberOfPackets:ioNumberOfPackets];
+}
+
+- (OSStatus) drainToOutputBuffer:(uint8_t *)outputBuffer
+                outputBufferSize:(UInt32)outputBufferSize
+              packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                 numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    return [self encodeOnePacketFromFrames:NULL numberOfFrames:0 outputBuffer:outputBuffer outputBufferSize:outputBufferSize packetDescriptions:packetDescriptions numberOfPackets:ioNumberOfPackets];
+}
+
+- (void) reset
+{
+    [self createEncoderWithStatus:NULL];
+}
+
+/**
+ * FDK AAC outputs at most one packet per call; 0 frames drains;
+ */
+- (OSStatus) encodeOnePacketFromFrames:(const void *)frames
+                        numberOfFrames:(UInt32)numberOfFrames
+                          outputBuffer:(uint8_t *)outputBuffer
+                      outputBufferSize:(UInt32)outputBufferSize
+                    packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                       numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    if (*ioNumberOfPackets == 0) {
+        return noErr;
+    }
+    *ioNumberOfPackets = 0;
+    size_t packetLength = 0;
+    int error = DHFDKAACEncoderEncode(encoder, frames, (int)numberOfFrames, outputBuffer, outputBufferSize, &packetLength);
+    if (error != DHFDKAACEncoderErrorNone) {
+        return error;
+    }
+    if (packetLength > 0) {
+        packetDescriptions[0].mStartOffset = 0;
+        packetDescriptions[0].mVariableFramesInPacket = 0;
+        packetDescriptions[0].mDataByteSize = (UInt32)packetLength;
+        *ioNumberOfPackets = 1;
+    }
+    return noErr;
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+//  DHFragmentedMP4Writer.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+
+/**
+ * Writes raw AAC packets into a fragmented MP4 (.m4a) file as they arrive;
+ * The file starts with an `moov` without samples, then every `fragmentDuration` the buffered packets are written as one `moof` + `mdat` fragment, so nothing but the current fragment is kept in memory;
+ * Each fragment is flushed to disk when it is written, so after a crash the file plays up to the last complete fragment; `finish` fills in the total duration and appends a fragment random access table;
+ */
+@interface DHFragmentedMP4Writer : NSObject
+
+/**
+ * Duration of each fragment in seconds; Default value is 1;
+ */
+@property (nonatomic) NSTimeInterval fragmentDuration;
+
+/**
+ * Number of fragments written so far;
+ */
+@property (nonatomic, readonly) NSUInteger numberOfFragments;
+
+/**
+ * Create the file and write the header, for the packets of AudioToolbox's AAC encoder, whose 2112 priming frames are cut off by an edit list;
+ * @param filePath the .m4a file, replaced if it exists
+ * @param audioFormat the AAC format of the packets
+ * @return nil if the file can not be created or ADTS/MP4 can not describe the format
+ */
+- (instancetype) initWithFilePath:(NSString *)filePath
+                      audioFormat:(AudioStreamBasicDescription)audioFormat;
+
+/**
+ * Create the file and write the header, for the packets of any AAC encoder;
+ * @param numberOfPrimingFrames frames the encoder put before the audio, e.g. `DHAACEncoderBackend.encoderDelay`; Skipped by players through the edit list
+ */
+- (instancetype) initWithFilePath:(NSString *)filePath
+                      audioFormat:(AudioStreamBasicDescription)audioFormat
+            numberOfPrimingFrames:(UInt32)numberOfPrimingFrames;
+
+/**
+ * Append raw AAC packets, e.g. the output of `AudioConverterFillComplexBuffer`;
+ */
+- (void) appendPackets:(const void *)bytes
+    packetDescriptions:(const AudioStreamPacketDescription *)packetDescriptions
+       numberOfPackets:(UInt32)numberOfPackets;
+
+/**
+ * Write the last fragment, the total duration and the random access table, and close the file;
+ */
+- (void) finish;
+
+@end
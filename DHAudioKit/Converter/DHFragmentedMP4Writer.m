@@ -0,0 +1,453 @@
+//
+//  DHFragmentedMP4Writer.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHFragmentedMP4Writer.h"
+#import "DHADTSUtilities.h"
+
+// See: ISO/IEC 14496-12 (ISO base media file format) and ISO/IEC 14496-14 (MP4 file format)
+
+static const UInt32 kTrackID = 1;
+static const UInt32 kAACObjectTypeIndication = 0x40;
+static const NSTimeInterval kDefaultFragmentDuration = 1;
+static const UInt32 kDefaultNumberOfPrimingFrames = 2112;       //AudioToolbox's AAC encoder
+
+#pragma mark - Box Writing
+static void appendUInt8(NSMutableData *data, uint8_t value)
+{
+    [data appendBytes:&value length:1];
+}
+
+static void appendUInt16(NSMutableData *data, uint16_t value)
+{
+    uint8_t bytes[2] = {(uint8_t)(value >> 8), (uint8_t)value};
+    [data appendBytes:bytes length:2];
+}
+
+static void appendUInt32(NSMutableData *data, uint32_t value)
+{
+    uint8_t bytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    [data appendBytes:bytes length:4];
+}
+
+static void appendUInt64(NSMutableData *data, uint64_t value)
+{
+    appendUInt32(data, (uint32_t)(value >> 32));
+    appendUInt32(data, (uint32_t)value);
+}
+
+static void appendZeros(NSMutableData *data, NSUInteger length)
+{
+    [data increaseLengthBy:length];
+}
+
+static void writeUInt32(NSMutableData *data, NSUInteger offset, uint32_t value)
+{
+    uint8_t bytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    [data replaceBytesInRange:NSMakeRange(offset, 4) withBytes:bytes];
+}
+
+/**
+ * Start a box and return its offset; The size is filled in by `endBox`;
+ */
+static NSUInteger beginBox(NSMutableData *data, const char *type)
+{
+    NSUInteger offset = [data length];
+    appendUInt32(data, 0);
+    [data appendBytes:type length:4];
+    return offset;
+}
+
+static NSUInteger beginFullBox(NSMutableData *data, const char *type, uint8_t version, uint32_t flags)
+{
+    NSUInteger offset = beginBox(data, type);
+    appendUInt32(data, ((uint32_t)version << 24) | (flags & 0xFFFFFF));
+    return offset;
+}
+
+static void endBox(NSMutableData *data, NSUInteger offset)
+{
+    writeUInt32(data, offset, (uint32_t)([data length] - offset));
+}
+
+static void appendUnityMatrix(NSMutableData *data)
+{
+    const uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (int i = 0; i < 9; i++) {
+        appendUInt32(data, matrix[i]);
+    }
+}
+
+/**
+ * An MPEG-4 descriptor with a one byte length; The descriptors written here are all shorter than 128 bytes;
+ */
+static void appendDescriptor(NSMutableData *data, uint8_t tag, NSData *payload)
+{
+    appendUInt8(data, tag);
+    appendUInt8(data, (uint8_t)[payload length]);
+    [data appendData:payload];
+}
+
+@interface DHFragmentedMP4Writer ()
+@property (nonatomic, strong) NSFileHandle *fileHandle;
+@property (nonatomic) AudioStreamBasicDescription audioFormat;
+@property (nonatomic) int frequencyIndex;
+@property (nonatomic) int channelConfiguration;
+@property (nonatomic) UInt32 numberOfPrimingFrames;
+
+//Fragment being buffered
+@property (nonatomic, strong) NSMutableData *fragmentPayload;
+@property (nonatomic, strong) NSMutableData *fragmentSampleSizes;
+@property (nonatomic) UInt32 numberOfFragmentSamples;
+
+@property (nonatomic) UInt64 decodeTime;
+@property (nonatomic) UInt64 fileOffset;
+@property (nonatomic) UInt64 fragmentDurationFieldOffset;
+@property (nonatomic) UInt64 editDurationFieldOffset;
+@property (nonatomic, readwrite) NSUInteger numberOfFragments;
+
+//Random access entries: decode time and moof offset of every fragment
+@property (nonatomic, strong) NSMutableData *randomAccessEntries;
+@end
+
+@implementation DHFragmentedMP4Writer
+
+- (instancetype) initWithFilePath:(NSString *)filePath
+                      audioFormat:(AudioStreamBasicDescription)audioFormat
+{
+    return [self initWithFilePath:filePath
+                      audioFormat:audioFormat
+            numberOfPrimingFrames:kDefaultNumberOfPrimingFrames];
+}
+
+- (instancetype) initWithFilePath:(NSString *)filePath
+                      audioFormat:(AudioStreamBasicDescription)audioFormat
+            numberOfPrimingFrames:(UInt32)numberOfPrimingFrames
+{
+    self = [super init];
+    if (self) {
+        _audioFormat = audioFormat;
+        _numberOfPrimingFrames = numberOfPrimingFrames;
+        _fragmentDuration = kDefaultFragmentDuration;
+        _frequencyIndex = DHADTSFrequencyIndexForSampleRate(audioFormat.mSampleRate);
+        _channelConfiguration = DHADTSChannelConfigurationForNumberOfChannels(audioFormat.mChannelsPerFrame);
+        if (_frequencyIndex < 0 || _channelConfiguration == 0 || audioFormat.mFramesPerPacket == 0) {
+            return nil;
+        }
+        if (![[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil]) {
+            return nil;
+        }
+        _fileHandle = [NSFileHandle fileHandleForWritingAtPath:filePath];
+        if (_fileHandle == nil) {
+            return nil;
+        }
+        _fragmentPayload = [NSMutableData data];
+        _fragmentSampleSizes = [NSMutableData data];
+        _randomAccessEntries = [NSMutableData data];
+        [self writeData:[self headerData]];
+        [self.fileHandle synchronizeFile];
+    }
+    return self;
+}
+
+- (void) writeData:(NSData *)data
+{
+    [self.fileHandle writeData:data];
+    self.fileOffset += [data length];
+}
+
+#pragma mark - Packets
+- (void) appendPackets:(const void *)bytes
+    packetDescriptions:(const AudioStreamPacketDescription *)packetDescriptions
+       numberOfPackets:(UInt32)numberOfPackets
+{
+    if (self.fileHandle == nil) {
+        return;
+    }
+    UInt64 samplesPerFragment = MAX((UInt64)(self.fragmentDuration * self.audioFormat.mSampleRate / self.audioFormat.mFramesPerPacket), 1);
+    for (UInt32 i = 0; i < numberOfPackets; i++) {
+        UInt32 packetLength = packetDescriptions[i].mDataByteSize;
+        [self.fragmentPayload appendBytes:(const uint8_t *)bytes + packetDescriptions[i].mStartOffset length:packetLength];
+        appendUInt32(self.fragmentSampleSizes, packetLength);
+        self.numberOfFragmentSamples++;
+        if (self.numberOfFragmentSamples >= samplesPerFragment) {
+            [self writeFragment];
+        }
+    }
+}
+
+- (void) finish
+{
+    if (self.fileHandle == nil) {
+        return;
+    }
+    [self writeFragment];
+    [self writeRandomAccessTable];
+    
+    //The total duration in `mehd`; It stays 0 (unknown) in a file that was not finished
+    [self.fileHandle seekToFileOffset:self.fragmentDurationFieldOffset];
+    NSMutableData *duration = [NSMutableData data];
+    appendUInt64(duration, self.decodeTime);
+    [self.fileHandle writeData:duration];
+    
+    //The played duration in `elst`, without the priming frames
+    [self.fileHandle seekToFileOffset:self.editDurationFieldOffset];
+    NSMutableData *editDuration = [NSMutableData data];
+    appendUInt64(editDuration, self.decodeTime > self.numberOfPrimingFrames ? self.decodeTime - self.numberOfPrimingFrames : 0);
+    [self.fileHandle writeData:editDuration];
+    
+    [self.fileHandle synchronizeFile];
+    [self.fileHandle closeFile];
+    self.fileHandle = nil;
+}
+
+#pragma mark - Header
+- (NSData *) headerData
+{
+    NSMutableData *data = [NSMutableData data];
+    UInt32 timeScale = (UInt32)self.audioFormat.mSampleRate;
+    
+    NSUInteger ftyp = beginBox(data, "ftyp");
+    [data appendBytes:"M4A " length:4];
+    appendUInt32(data, 0);
+    [data appendBytes:"M4A isomiso6mp41" length:16];
+    endBox(data, ftyp);
+    
+    NSUInteger moov = beginBox(data, "moov");
+    NSUInteger mvhd = beginFullBox(data, "mvhd", 0, 0);
+    appendUInt32(data, 0);                  //creation time
+    appendUInt32(data, 0);                  //modification time
+    appendUInt32(data, timeScale);
+    appendUInt32(data, 0);                  //duration, carried by the fragments
+    appendUInt32(data, 0x00010000);         //rate 1.0
+    appendUInt16(data, 0x0100);             //volume 1.0
+    appendZeros(data, 10);
+    appendUnityMatrix(data);
+    appendZeros(data, 24);
+    appendUInt32(data, kTrackID + 1);       //next track ID
+    endBox(data, mvhd);
+    
+    NSUInteger trak = beginBox(data, "trak");
+    NSUInteger tkhd = beginFullBox(data, "tkhd", 0, 0x000003);    //enabled, in movie
+    appendUInt32(data, 0);
+    appendUInt32(data, 0);
+    appendUInt32(data, kTrackID);
+    appendUInt32(data, 0);
+    appendUInt32(data, 0);                  //duration
+    appendZeros(data, 8);
+    appendUInt16(data, 0);                  //layer
+    appendUInt16(data, 0);                  //alternate group
+    appendUInt16(data, 0x0100);             //volume
+    appendUInt16(data, 0);
+    appendUnityMatrix(data);
+    appendUInt32(data, 0);                  //width
+    appendUInt32(data, 0);                  //height
+    endBox(data, tkhd);
+    
+    //The priming frames the encoder starts with are decoded but not played; Until `finish` the edit runs to the end of the fragments
+    NSUInteger edts = beginBox(data, "edts");
+    NSUInteger elst = beginFullBox(data, "elst", 1, 0);
+    appendUInt32(data, 1);                  //entry count
+    self.editDurationFieldOffset = [data length];
+    appendUInt64(data, 0);                  //segment duration, filled in by `finish`
+    appendUInt64(data, self.numberOfPrimingFrames);     //media time
+    appendUInt16(data, 1);                  //media rate 1.0
+    appendUInt16(data, 0);
+    endBox(data, elst);
+    endBox(data, edts);
+    
+    NSUInteger mdia = beginBox(data, "mdia");
+    NSUInteger mdhd = beginFullBox(data, "mdhd", 0, 0);
+    appendUInt32(data, 0);
+    appendUInt32(data, 0);
+    appendUInt32(data, timeScale);
+    appendUInt32(data, 0);
+    appendUInt16(data, 0x55C4);             //language "und"
+    appendUInt16(data, 0);
+    endBox(data, mdhd);
+    
+    NSUInteger hdlr = beginFullBox(data, "hdlr", 0, 0);
+    appendUInt32(data, 0);
+    [data appendBytes:"soun" length:4];
+    appendZeros(data, 12);
+    [data appendBytes:"SoundHandler" length:13];
+    endBox(data, hdlr);
+    
+    NSUInteger minf = beginBox(data, "minf");
+    NSUInteger smhd = beginFullBox(data, "smhd", 0, 0);
+    appendUInt16(data, 0);                  //balance
+    appendUInt16(data, 0);
+    endBox(data, smhd);
+    
+    NSUInteger dinf = beginBox(data, "dinf");
+    NSUInteger dref = beginFullBox(data, "dref", 0, 0);
+    appendUInt32(data, 1);
+    NSUInteger url = beginFullBox(data, "url ", 0, 0x000001);     //media in the same file
+    endBox(data, url);
+    endBox(data, dref);
+    endBox(data, dinf);
+    
+    NSUInteger stbl = beginBox(data, "stbl");
+    [self appendSampleDescriptionToData:data];
+    //The sample tables are empty, the samples are described by the fragments
+    NSUInteger stts = beginFullBox(data, "stts", 0, 0);
+    appendUInt32(data, 0);
+    endBox(data, stts);
+    NSUInteger stsc = beginFullBox(data, "stsc", 0, 0);
+    appendUInt32(data, 0);
+    endBox(data, stsc);
+    NSUInteger stsz = beginFullBox(data, "stsz", 0, 0);
+    appendUInt32(data, 0);
+    appendUInt32(data, 0);
+    endBox(data, stsz);
+    NSUInteger stco = beginFullBox(data, "stco", 0, 0);
+    appendUInt32(data, 0);
+    endBox(data, stco);
+    endBox(data, stbl);
+    endBox(data, minf);
+    endBox(data, mdia);
+    endBox(data, trak);
+    
+    NSUInteger mvex = beginBox(data, "mvex");
+    NSUInteger mehd = beginFullBox(data, "mehd", 1, 0);
+    self.fragmentDurationFieldOffset = [data length];
+    appendUInt64(data, 0);                  //fragment duration, filled in by `finish`
+    endBox(data, mehd);
+    NSUInteger trex = beginFullBox(data, "trex", 0, 0);
+    appendUInt32(data, kTrackID);
+    appendUInt32(data, 1);                  //sample description index
+    appendUInt32(data, self.audioFormat.mFramesPerPacket);
+    appendUInt32(data, 0);                  //sample size
+    appendUInt32(data, 0);                  //sample flags
+    endBox(data, trex);
+    endBox(data, mvex);
+    endBox(data, moov);
+    
+    return data;
+}
+
+- (void) appendSampleDescriptionToData:(NSMutableData *)data
+{
+    NSUInteger stsd = beginFullBox(data, "stsd", 0, 0);
+    appendUInt32(data, 1);
+    
+    NSUInteger mp4a = beginBox(data, "mp4a");
+    appendZeros(data, 6);
+    appendUInt16(data, 1);                  //data reference index
+    appendZeros(data, 8);
+    appendUInt16(data, self.audioFormat.mChannelsPerFrame);
+    appendUInt16(data, 16);                 //sample size
+    appendUInt16(data, 0);
+    appendUInt16(data, 0);
+    UInt32 sampleRate = (UInt32)self.audioFormat.mSampleRate;
+    appendUInt32(data, sampleRate <= 0xFFFF ? sampleRate << 16 : 0);
+    
+    NSUInteger esds = beginFullBox(data, "esds", 0, 0);
+    //AudioSpecificConfig: object type, frequency index, channel configuration
+    NSMutableData *audioSpecificConfig = [NSMutableData data];
+    appendUInt16(audioSpecificConfig, (uint16_t)((DHADTS_PROFILE_AAC_LC << 11) | (self.frequencyIndex << 7) | (self.channelConfiguration << 3)));
+    
+    NSMutableData *decoderConfig = [NSMutableData data];
+    appendUInt8(decoderConfig, kAACObjectTypeIndication);
+    appendUInt8(decoderConfig, (0x05 << 2) | 0x01);     //audio stream
+    appendUInt8(decoderConfig, 0);                      //buffer size, 24 bits
+    appendUInt16(decoderConfig, 0);
+    appendUInt32(decoderConfig, 0);                     //max bitrate
+    appendUInt32(decoderConfig, 0);                     //average bitrate
+    appendDescriptor(decoderConfig, 0x05, audioSpecificConfig);
+    
+    NSMutableData *slConfig = [NSMutableData data];
+    appendUInt8(slConfig, 0x02);
+    
+    NSMutableData *elementaryStream = [NSMutableData data];
+    appendUInt16(elementaryStream, kTrackID);
+    appendUInt8(elementaryStream, 0);
+    appendDescriptor(elementaryStream, 0x04, decoderConfig);
+    appendDescriptor(elementaryStream, 0x06, slConfig);
+    
+    appendDescriptor(data, 0x03, elementaryStream);
+    endBox(data, esds);
+    endBox(data, mp4a);
+    endBox(data, stsd);
+}
+
+#pragma mark - Fragments
+- (void) writeFragment
+{
+    if (self.numberOfFragmentSamples == 0) {
+        return;
+    }
+    NSMutableData *data = [NSMutableData data];
+    NSUInteger moof = beginBox(data, "moof");
+    NSUInteger mfhd = beginFullBox(data, "mfhd", 0, 0);
+    appendUInt32(data, (uint32_t)self.numberOfFragments + 1);     //sequence number
+    endBox(data, mfhd);
+    
+    NSUInteger traf = beginBox(data, "traf");
+    NSUInteger tfhd = beginFullBox(data, "tfhd", 0, 0x020008);   //default base is moof, default sample duration
+    appendUInt32(data, kTrackID);
+    appendUInt32(data, self.audioFormat.mFramesPerPacket);
+    endBox(data, tfhd);
+    
+    NSUInteger tfdt = beginFullBox(data, "tfdt", 1, 0);
+    appendUInt64(data, self.decodeTime);
+    endBox(data, tfdt);
+    
+    NSUInteger trun = beginFullBox(data, "trun", 0, 0x000201);   //data offset, sample sizes
+    appendUInt32(data, self.numberOfFragmentSamples);
+    NSUInteger dataOffsetField = [data length];
+    appendUInt32(data, 0);
+    [data appendData:self.fragmentSampleSizes];
+    endBox(data, trun);
+    endBox(data, traf);
+    endBox(data, moof);
+    
+    //The samples start right after the mdat header
+    writeUInt32(data, dataOffsetField, (uint32_t)([data length] - moof + 8));
+    
+    appendUInt32(data, (uint32_t)([self.fragmentPayload length] + 8));
+    [data appendBytes:"mdat" length:4];
+    
+    appendUInt64(self.randomAccessEntries, self.decodeTime);
+    appendUInt64(self.randomAccessEntries, self.fileOffset);
+    
+    [self writeData:data];
+    [self writeData:self.fragmentPayload];
+    [self.fileHandle synchronizeFile];
+    
+    self.decodeTime += (UInt64)self.numberOfFragmentSamples * self.audioFormat.mFramesPerPacket;
+    self.numberOfFragments++;
+    [self.fragmentPayload setLength:0];
+    [self.fragmentSampleSizes setLength:0];
+    self.numberOfFragmentSamples = 0;
+}
+
+- (void) writeRandomAccessTable
+{
+    NSMutableData *data = [NSMutableData data];
+    NSUInteger mfra = beginBox(data, "mfra");
+    NSUInteger tfra = beginFullBox(data, "tfra", 1, 0);
+    appendUInt32(data, kTrackID);
+    appendUInt32(data, 0);                  //traf, trun and sample numbers are 1 byte each
+    appendUInt32(data, (uint32_t)self.numberOfFragments);
+    const uint8_t *entries = [self.randomAccessEntries bytes];
+    for (NSUInteger i = 0; i < self.numberOfFragments; i++) {
+        [data appendBytes:entries + i * 16 length:16];
+        appendUInt8(data, 1);
+        appendUInt8(data, 1);
+        appendUInt8(data, 1);
+    }
+    endBox(data, tfra);
+    NSUInteger mfro = beginFullBox(data, "mfro", 0, 0);
+    appendUInt32(data, 0);
+    endBox(data, mfro);
+    endBox(data, mfra);
+    writeUInt32(data, [data length] - 4, (uint32_t)[data length]);
+    [self writeData:data];
+}
+
+@end
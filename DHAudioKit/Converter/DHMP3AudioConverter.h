@@ -7,7 +7,51 @@
 //
 
 #import "DHAudioConverter.h"
+#import "DHMP3EncoderProfile.h"
 
 @interface DHMP3AudioConverter : DHAudioConverter
 
+/**
+ * The LAME encoder settings; Default value is `[DHMP3EncoderProfile defaultProfile]`;
+ * Its sample rate and number of channels, when set, replace those of `outFormat`, which the output sample rate and the mono downmix follow; Set the profile before the conversion starts, it is rejected with an error while encoding;
+ * `bitRate` sets the bitrate of the active mode, for VBR the quality whose average bitrate is closest;
+ */
+@property (nonatomic, copy) DHMP3EncoderProfile *profile;
+
+/**
+ * Path of a file the MP3 stream is also written to; Default value is nil;
+ * The file is seekable, so when the conversion stops the Xing/LAME tag frame is written over the first frame, which LAME reserves for it; Players can then read duration and seek without scanning the file;
+ * Set the path before the conversion starts, it is rejected with an error while encoding;
+ */
+@property (nonatomic, copy) NSString *outputFilePath;
+
+/**
+ * Number of segments `convertDataConcurrently:` splits the PCM data into;
+ * Default value is 0, which uses one segment per active processor;
+ */
+@property (nonatomic) NSUInteger numberOfConcurrentSegments;
+
+/**
+ * Initializer
+ * @param inFormat Source audio format
+ * @param outFormat Target audio format, see `DHAudioConverterFactory destinationFormatForMP3EncoderProfile:sourceFormat:`
+ * @param profile the LAME encoder settings
+ * @param delegate the delegate
+ * @param delegateQueue the queue on which the delegate is running;
+ */
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                  profile:(DHMP3EncoderProfile *)profile
+                                 delegate:(id<DHAudioConverterDelegate>)delegate
+                            delegateQueue:(dispatch_queue_t)delegateQueue;
+
+/**
+ * Offline conversion for a complete recording; The PCM data is split into segments on MP3 frame boundaries and every segment is encoded by an independent LAME encoder concurrently.
+ * The frames are joined into a single stream that starts with an Xing/LAME header, and the stream is returned in `audioConverter:didFinishConversionWithData:` as a whole, and written to `outputFilePath` if it is set;
+ * Do not mix this method with `convertData:numberOfPackets:` on the same converter;
+ *
+ * @discussion Each segment is encoded with a few frames of overlap on both sides so the psychoacoustic model and the filter bank are primed, and with the bit reservoir disabled so no frame borrows bits from a frame of another segment.
+ */
+- (void) convertDataConcurrently:(NSData *)data;
+
 @end
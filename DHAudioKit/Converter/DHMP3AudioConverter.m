@@ -7,10 +7,26 @@
 //
 
 #import "DHMP3AudioConverter.h"
+#import "DHMP3FrameUtilities.h"
+#import "DHPCMFormatConverter.h"
+#import "DHAudioAttributes.h"
 #import "lame.h"
+
+static const int kDHMP3SegmentOverlapFrames = 4;
+static const int kDHMP3MinimumFramesPerSegment = 64;
+static const int kDHMP3FlushBufferSize = 7200;
+
+//Average bitrates in kbps of LAME's VBR qualities 0 - 9, for a bitrate set while encoding VBR
+static const int kDHMP3VBRQualityBitRates[] = {245, 225, 190, 175, 165, 130, 115, 100, 85, 65};
+
 @interface DHMP3AudioConverter() {
     lame_t lame;
+    unsigned char *mp3Buffer;       //grown on the encode queue to the largest call so far, not on the stack, as its size follows the caller's input
+    int mp3BufferCapacity;
 }
+@property (nonatomic, strong) NSFileHandle *fileHandle;
+@property (nonatomic) BOOL hasStreamingOutput;
+@property (nonatomic, strong) DHPCMFormatConverter *formatConverter;
 @end
 
 @implementation DHMP3AudioConverter
@@ -19,6 +35,19 @@
                         outputAudioFormat:(AudioStreamBasicDescription)outFormat
                                  delegate:(id<DHAudioConverterDelegate>)delegate
                             delegateQueue:(dispatch_queue_t)delegateQueue
+{
+    return [self initWithInputAudioFormat:inFormat
+                        outputAudioFormat:outFormat
+                                  profile:nil
+                                 delegate:delegate
+                            delegateQueue:delegateQueue];
+}
+
+- (instancetype) initWithInputAudioFormat:(AudioStreamBasicDescription)inFormat
+                        outputAudioFormat:(AudioStreamBasicDescription)outFormat
+                                  profile:(DHMP3EncoderProfile *)profile
+                                 delegate:(id<DHAudioConverterDelegate>)delegate
+                            delegateQueue:(dispatch_queue_t)delegateQueue
 {
     self = [super initWithInputAudioFormat:inFormat
                          outputAudioFormat:outFormat
@@ -26,41 +55,197 @@
                              delegateQueue:delegateQueue];
     if (self) {
         encodeQ = dispatch_queue_create("Encode MP3 Queue", NULL);
-        lame = lame_init();
-        lame_set_in_samplerate(lame, inFormat.mSampleRate);
-        lame_set_num_channels(lame, inFormat.mChannelsPerFrame);
-        lame_set_VBR(lame, vbr_default);
-        lame_init_params(lame);
+        _profile = profile ? [profile copy] : [DHMP3EncoderProfile defaultProfile];
+        [self updateOutFormatWithProfile:_profile];
+        AudioStreamBasicDescription encoderInputFormat = [DHPCMFormatConverter signed16BitFormatWithSampleRate:inFormat.mSampleRate
+                                                                                            numberOfChannels:inFormat.mChannelsPerFrame];
+        if ([DHPCMFormatConverter needsConversionFromFormat:inFormat toFormat:encoderInputFormat]) {
+            //LAME takes 16-bit samples; It downmixes to mono itself, so the channels are kept
+            _formatConverter = [[DHPCMFormatConverter alloc] initWithInputFormat:inFormat outputFormat:encoderInputFormat];
+            if (_formatConverter == nil) {
+                [self reportErrorWithErrorCode:-1 message:@"Unsupported input format"];
+                return nil;
+            }
+        }
+        lame = [self createEncoderForSegment:NO];
+        if (lame == NULL) {
+            [self reportErrorWithErrorCode:-1 message:@"Fail to create converter"];
+            return nil;
+        }
+        [self updateOutFormatWithEncoder:lame];
     }
     return self;
 }
 
+#pragma mark - Encoder Profile
+- (void) setProfile:(DHMP3EncoderProfile *)profile
+{
+    //A new encoder would start a new stream in the middle of the output
+    if ([self isEncoding]) {
+        [self reportErrorWithErrorCode:-1 message:@"The encoder profile can not change while encoding"];
+        return;
+    }
+    _profile = [profile copy];
+    [self updateOutFormatWithProfile:_profile];
+    dispatch_async(encodeQ, ^{
+        [self recreateEncoder];
+    });
+}
+
+//The bitrate of the active mode: the constant one for CBR, the average for ABR, and the closest quality for VBR
+- (void) setBitRate:(UInt32)bitRate
+{
+    if ([self isEncoding]) {
+        [self reportErrorWithErrorCode:-1 message:@"The bitrate can not change while encoding"];
+        return;
+    }
+    [super setBitRate:bitRate];
+    DHMP3EncoderProfile *profile = [self.profile copy];
+    profile.bitRate = bitRate / 1000;
+    if (profile.bitRateMode == DHMP3BitRateModeVBR) {
+        profile.vbrQuality = [self vbrQualityForBitRate:profile.bitRate];
+    }
+    self.profile = profile;
+}
+
+- (int) vbrQualityForBitRate:(int)bitRate
+{
+    int quality = 0;
+    int count = (int)(sizeof(kDHMP3VBRQualityBitRates) / sizeof(kDHMP3VBRQualityBitRates[0]));
+    for (int i = 1; i < count; i++) {
+        if (abs(kDHMP3VBRQualityBitRates[i] - bitRate) < abs(kDHMP3VBRQualityBitRates[quality] - bitRate)) {
+            quality = i;
+        }
+    }
+    return quality;
+}
+
+//Data was handed in and the conversion was not stopped yet
+- (BOOL) isEncoding
+{
+    return self.numberOfPacketsReceived > 0 && self.status == DHAudioConverterStatusConverting;
+}
+
+//The sample rate and channels the profile sets win over those of `outFormat`, which the encoder follows
+- (void) updateOutFormatWithProfile:(DHMP3EncoderProfile *)profile
+{
+    AudioStreamBasicDescription outFormat = self.outFormat;
+    if (profile.sampleRate > 0) {
+        outFormat.mSampleRate = profile.sampleRate;
+    }
+    if (profile.numberOfChannels > 0) {
+        outFormat.mChannelsPerFrame = MIN(profile.numberOfChannels, 2);
+    }
+    if (outFormat.mSampleRate > 0) {
+        outFormat.mFramesPerPacket = outFormat.mSampleRate >= DHAudioSampleRate32000 ? 1152 : 576;     //MPEG-1 Layer III frames have 1152 samples, MPEG-2/2.5 have 576
+    }
+    self.outFormat = outFormat;
+}
+
+//Without a sample rate in `outFormat` or the profile LAME picks one, which `outFormat` then describes
+- (void) updateOutFormatWithEncoder:(lame_t)encoder
+{
+    if (self.outFormat.mSampleRate > 0) {
+        return;
+    }
+    AudioStreamBasicDescription outFormat = self.outFormat;
+    outFormat.mSampleRate = lame_get_out_samplerate(encoder);
+    outFormat.mFramesPerPacket = lame_get_framesize(encoder);
+    self.outFormat = outFormat;
+}
+
+- (void) applyProfileToEncoder:(lame_t)encoder
+{
+    DHMP3EncoderProfile *profile = self.profile;
+    //Set even when it equals the input rate, as LAME otherwise picks a rate of its own for low bitrates; 0 lets LAME pick
+    lame_set_out_samplerate(encoder, self.outFormat.mSampleRate);
+    if (self.outFormat.mChannelsPerFrame == 1) {
+        lame_set_mode(encoder, MONO);       //LAME downmixes stereo input itself
+    }
+    switch (profile.bitRateMode) {
+        case DHMP3BitRateModeCBR:
+            lame_set_VBR(encoder, vbr_off);
+            lame_set_brate(encoder, profile.bitRate);
+            break;
+        case DHMP3BitRateModeABR:
+            lame_set_VBR(encoder, vbr_abr);
+            lame_set_VBR_mean_bitrate_kbps(encoder, profile.bitRate);
+            break;
+        case DHMP3BitRateModeVBR:
+        default:
+            lame_set_VBR(encoder, vbr_default);
+            lame_set_VBR_q(encoder, profile.vbrQuality);
+            break;
+    }
+    if (profile.quality >= 0) {
+        lame_set_quality(encoder, profile.quality);
+    }
+}
+
+- (lame_t) createEncoderForSegment:(BOOL)isSegment
+{
+    lame_t encoder = lame_init();
+    lame_set_in_samplerate(encoder, self.inFormat.mSampleRate);
+    lame_set_num_channels(encoder, self.inFormat.mChannelsPerFrame);
+    [self applyProfileToEncoder:encoder];
+    if (isSegment) {
+        //Segments are joined frame by frame, so no frame may point back into the previous segment, and the Xing header is written for the joined stream instead;
+        lame_set_disable_reservoir(encoder, 1);
+        lame_set_bWriteVbrTag(encoder, 0);
+    } else {
+        //LAME reserves the first frame for the Xing/LAME tag, which can only be filled in afterwards on a seekable sink;
+        lame_set_bWriteVbrTag(encoder, self.outputFilePath != nil);
+    }
+    if (lame_init_params(encoder) < 0) {
+        lame_close(encoder);
+        return NULL;
+    }
+    return encoder;
+}
+
+- (void) recreateEncoder
+{
+    if (lame) {
+        lame_close(lame);
+    }
+    lame = [self createEncoderForSegment:NO];
+    if (lame == NULL) {
+        [self reportErrorWithErrorCode:-1 message:@"Fail to create converter"];
+    }
+}
 
 - (void) convertData:(NSData *)data numberOfPackets:(int)numberOfPackets
 {
     if ([data length] == 0) {
         return;
     }
-    
+
     self.numberOfPacketsReceived++;
     dispatch_async(encodeQ, ^{
-        int numberOfSamples = (int)[data length] / sizeof(short) / self.inFormat.mChannelsPerFrame;
-        
-        int mp3BufferSize = (int)[data length] / sizeof(short) / self.inFormat.mChannelsPerFrame;
-        unsigned char mp3Buffer[mp3BufferSize];
-        
-        int encodedBytes;
-        
-        if (self.inFormat.mChannelsPerFrame == 2) {
-            encodedBytes = lame_encode_buffer_interleaved(lame, (short *)[data bytes], numberOfSamples, mp3Buffer, mp3BufferSize);
-        } else {
-            encodedBytes = lame_encode_buffer(lame, (short *)[data bytes], (short *)[data bytes], numberOfSamples, mp3Buffer, mp3BufferSize);
+        if (lame == NULL) {
+            return;
+        }
+        NSData *pcmData = [self signed16BitDataWithData:data];
+        int numberOfSamples = (int)[pcmData length] / sizeof(short) / self.inFormat.mChannelsPerFrame;
+
+        int mp3BufferSize = numberOfSamples * 5 / 4 + kDHMP3FlushBufferSize;     //worst case suggested by lame.h
+        if (![self reserveMP3BufferSize:mp3BufferSize]) {
+            [self reportErrorWithErrorCode:-1 message:@"Fail to allocate conversion buffer"];
+            return;
         }
-        
+
+        int encodedBytes = [self encodeSamples:(short *)[pcmData bytes]
+                               numberOfSamples:numberOfSamples
+                                       encoder:lame
+                                        buffer:mp3Buffer
+                                    bufferSize:mp3BufferSize];
+
         if (encodedBytes < 0) {
             [self reportErrorWithErrorCode:encodedBytes message:@"Fail to convert data"];
         } else {
             NSData *encodedData = [NSData dataWithBytes:mp3Buffer length:encodedBytes];
+            self.hasStreamingOutput = YES;
+            [self writeEncodedData:encodedData];
             dispatch_async(self.delegateQueue, ^{
                 [self.delegate audioConverter:self didFinishConversionWithData:encodedData];
             });
@@ -70,10 +255,352 @@
     });
 }
 
+- (BOOL) reserveMP3BufferSize:(int)size
+{
+    if (size <= mp3BufferCapacity) {
+        return YES;
+    }
+    unsigned char *buffer = realloc(mp3Buffer, size);
+    if (buffer == NULL) {
+        return NO;
+    }
+    mp3Buffer = buffer;
+    mp3BufferCapacity = size;
+    return YES;
+}
+
+- (NSData *) signed16BitDataWithData:(NSData *)data
+{
+    return self.formatConverter ? [self.formatConverter convertData:data] : data;
+}
+
+- (int) encodeSamples:(short *)samples
+      numberOfSamples:(int)numberOfSamples
+              encoder:(lame_t)encoder
+               buffer:(unsigned char *)buffer
+           bufferSize:(int)bufferSize
+{
+    if (self.inFormat.mChannelsPerFrame == 2) {
+        return lame_encode_buffer_interleaved(encoder, samples, numberOfSamples, buffer, bufferSize);
+    }
+    return lame_encode_buffer(encoder, samples, samples, numberOfSamples, buffer, bufferSize);
+}
+
+- (void) stopConversion
+{
+    dispatch_async(encodeQ, ^{
+        [self flushEncoder];
+        [super stopConversion];
+    });
+}
+
+#pragma mark - Output File
+- (void) setOutputFilePath:(NSString *)outputFilePath
+{
+    //The encoder is recreated to reserve the tag frame, which would start a new stream in the middle of the output
+    if ([self isEncoding]) {
+        [self reportErrorWithErrorCode:-1 message:@"The output file can not change while encoding"];
+        return;
+    }
+    _outputFilePath = [outputFilePath copy];
+    dispatch_async(encodeQ, ^{
+        [self recreateEncoder];
+    });
+}
+
+- (void) writeEncodedData:(NSData *)data
+{
+    if (self.outputFilePath == nil || [data length] == 0) {
+        return;
+    }
+    if (self.fileHandle == nil) {
+        [[NSFileManager defaultManager] createFileAtPath:self.outputFilePath contents:nil attributes:nil];
+        self.fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.outputFilePath];
+        if (self.fileHandle == nil) {
+            [self reportErrorWithErrorCode:-1 message:@"Fail to open output file"];
+            return;
+        }
+    }
+    [self.fileHandle writeData:data];
+}
+
+/**
+ * Encode the samples LAME still buffers, and back-patch the Xing/LAME tag into the frame LAME reserved at the beginning of the output file;
+ */
+- (void) flushEncoder
+{
+    if (lame == NULL || !self.hasStreamingOutput) {
+        [self.fileHandle closeFile];
+        self.fileHandle = nil;
+        return;
+    }
+    //The next stream of the converter starts over
+    self.hasStreamingOutput = NO;
+    unsigned char buffer[kDHMP3FlushBufferSize];
+    int flushedBytes = lame_encode_flush(lame, buffer, kDHMP3FlushBufferSize);
+    if (flushedBytes < 0) {
+        [self reportErrorWithErrorCode:flushedBytes message:@"Fail to convert data"];
+    } else if (flushedBytes > 0) {
+        NSData *encodedData = [NSData dataWithBytes:buffer length:flushedBytes];
+        [self writeEncodedData:encodedData];
+        dispatch_async(self.delegateQueue, ^{
+            [self.delegate audioConverter:self didFinishConversionWithData:encodedData];
+        });
+    }
+
+    if (self.fileHandle) {
+        size_t tagLength = lame_get_lametag_frame(lame, buffer, kDHMP3FlushBufferSize);
+        if (tagLength > 0 && tagLength <= kDHMP3FlushBufferSize) {
+            [self.fileHandle seekToFileOffset:0];
+            [self.fileHandle writeData:[NSData dataWithBytes:buffer length:tagLength]];
+        }
+        [self.fileHandle closeFile];
+        self.fileHandle = nil;
+    }
+    //A flushed encoder can not go on, the next stream gets a fresh one
+    [self recreateEncoder];
+}
+
+#pragma mark - Concurrent Conversion
+- (void) convertDataConcurrently:(NSData *)data
+{
+    if ([data length] == 0) {
+        return;
+    }
+
+    self.numberOfPacketsReceived++;
+    dispatch_async(encodeQ, ^{
+        NSData *encodedData = [self concurrentlyEncodedDataWithData:[self signed16BitDataWithData:data]];
+        if (encodedData == nil) {
+            return;
+        }
+        [self writeEncodedData:encodedData];
+        dispatch_async(self.delegateQueue, ^{
+            [self.delegate audioConverter:self didFinishConversionWithData:encodedData];
+        });
+        self.numberOfPacketsConverted++;
+        [self finishConversionIfAllPacketsAreConverted];
+    });
+}
+
+- (NSData *) concurrentlyEncodedDataWithData:(NSData *)data
+{
+    lame_t probe = [self createEncoderForSegment:YES];
+    if (probe == NULL) {
+        [self reportErrorWithErrorCode:-1 message:@"Fail to create converter"];
+        return nil;
+    }
+    int samplesPerFrame = lame_get_framesize(probe);
+    DHMP3XingInfo info = {0};
+    //The version of the LAME that is linked, e.g. "LAME3.100"
+    char encoderVersion[16];
+    snprintf(encoderVersion, sizeof(encoderVersion), "LAME%s", get_lame_short_version());
+    info.encoderVersion = encoderVersion;
+    info.isVBR = lame_get_VBR(probe) != vbr_off;
+    info.quality = 100 - 10 * lame_get_VBR_q(probe) - lame_get_quality(probe);
+    info.vbrMethod = [self lameTagVBRMethodForMode:lame_get_VBR(probe)];
+    info.lowpassFrequency = lame_get_lowpassfreq(probe);
+    info.bitRate = lame_get_VBR(probe) == vbr_abr ? lame_get_VBR_mean_bitrate_kbps(probe) : lame_get_brate(probe);
+    info.encoderDelay = lame_get_encoder_delay(probe);
+    int outputSampleRate = lame_get_out_samplerate(probe);
+    lame_close(probe);
+
+    NSUInteger numberOfSamples = [data length] / sizeof(short) / self.inFormat.mChannelsPerFrame;
+    NSUInteger numberOfOutputSamples = (NSUInteger)((unsigned long long)numberOfSamples * outputSampleRate / (NSUInteger)self.inFormat.mSampleRate);
+    NSUInteger numberOfFrames = (numberOfOutputSamples + samplesPerFrame - 1) / samplesPerFrame;
+    if (numberOfFrames == 0) {
+        return nil;
+    }
+    //When LAME resamples, segments start on frames whose first sample falls on a whole input sample
+    NSUInteger frameStep = outputSampleRate / [self greatestCommonDivisorOf:(NSUInteger)samplesPerFrame * (NSUInteger)self.inFormat.mSampleRate
+                                                                        and:outputSampleRate];
+    NSUInteger overlapFrames = (kDHMP3SegmentOverlapFrames + frameStep - 1) / frameStep * frameStep;
+    NSUInteger numberOfSegments = self.numberOfConcurrentSegments;
+    if (numberOfSegments == 0) {
+        numberOfSegments = [[NSProcessInfo processInfo] activeProcessorCount];
+    }
+    numberOfSegments = MAX(1, MIN(numberOfSegments, numberOfFrames / MAX(kDHMP3MinimumFramesPerSegment, frameStep)));
+    NSUInteger framesPerSegment = (numberOfFrames + numberOfSegments - 1) / numberOfSegments;
+    framesPerSegment = (framesPerSegment + frameStep - 1) / frameStep * frameStep;
+    numberOfSegments = (numberOfFrames + framesPerSegment - 1) / framesPerSegment;
+
+    NSMutableArray *segments = [NSMutableArray arrayWithCapacity:numberOfSegments];
+    for (NSUInteger i = 0; i < numberOfSegments; i++) {
+        [segments addObject:[NSNull null]];
+    }
+    __block int errorCode = 0;
+    dispatch_apply(numberOfSegments, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t index) {
+        int segmentError = 0;
+        NSData *segment = [self encodedSegmentWithData:data
+                                            firstFrame:index * framesPerSegment
+                                             lastFrame:MIN(numberOfFrames, (index + 1) * framesPerSegment)
+                                       samplesPerFrame:samplesPerFrame
+                                      outputSampleRate:outputSampleRate
+                                         overlapFrames:overlapFrames
+                                         isLastSegment:index == numberOfSegments - 1
+                                                 error:&segmentError];
+        @synchronized (segments) {
+            if (segment) {
+                segments[index] = segment;
+            } else {
+                errorCode = segmentError;
+            }
+        }
+    });
+    if (errorCode != 0) {
+        [self reportErrorWithErrorCode:errorCode message:@"Fail to convert data"];
+        return nil;
+    }
+
+    DHMP3FrameHeader reference;
+    NSData *firstSegment = [segments firstObject];
+    if (!DHMP3ParseFrameHeader([firstSegment bytes], [firstSegment length], &reference)) {
+        [self reportErrorWithErrorCode:-1 message:@"Fail to convert data"];
+        return nil;
+    }
+    size_t xingLength = DHMP3XingFrameLength(&reference);
+    NSMutableData *encodedData = [NSMutableData dataWithLength:xingLength];
+    for (NSData *segment in segments) {
+        [encodedData appendData:segment];
+    }
+
+    //Index the joined frames for the Xing TOC
+    const uint8_t *audioBytes = (const uint8_t *)[encodedData bytes] + xingLength;
+    NSUInteger audioLength = [encodedData length] - xingLength;
+    NSMutableData *frameOffsets = [NSMutableData dataWithCapacity:numberOfFrames * sizeof(uint32_t)];
+    NSUInteger offset = 0;
+    DHMP3FrameHeader header;
+    while (offset < audioLength && DHMP3ParseFrameHeader(audioBytes + offset, audioLength - offset, &header)) {
+        uint32_t frameOffset = (uint32_t)offset;
+        [frameOffsets appendBytes:&frameOffset length:sizeof(frameOffset)];
+        offset += header.frameLength;
+    }
+    info.numberOfFrames = (uint32_t)([frameOffsets length] / sizeof(uint32_t));
+    info.numberOfAudioBytes = (uint32_t)audioLength;
+    info.frameOffsets = [frameOffsets bytes];
+    info.musicCRC = DHMP3CRC16(0, audioBytes, audioLength);
+    NSInteger padding = (NSInteger)info.numberOfFrames * samplesPerFrame - info.encoderDelay - (NSInteger)numberOfOutputSamples;
+    info.encoderPadding = (int)MAX(0, padding);
+    DHMP3WriteXingFrame(&reference, &info, [encodedData mutableBytes], xingLength);
+
+    return encodedData;
+}
+
+/**
+ * Encode the frames [firstFrame, lastFrame) of the PCM data with a fresh encoder;
+ * The encoder is fed `overlapFrames` extra frames on both sides, and the frames encoded from the overlap are dropped afterwards;
+ */
+- (NSData *) encodedSegmentWithData:(NSData *)data
+                         firstFrame:(NSUInteger)firstFrame
+                          lastFrame:(NSUInteger)lastFrame
+                    samplesPerFrame:(int)samplesPerFrame
+                   outputSampleRate:(int)outputSampleRate
+                      overlapFrames:(NSUInteger)overlapFrames
+                      isLastSegment:(BOOL)isLastSegment
+                              error:(int *)error
+{
+    lame_t encoder = [self createEncoderForSegment:YES];
+    if (encoder == NULL) {
+        *error = -1;
+        return nil;
+    }
+    int numberOfChannels = self.inFormat.mChannelsPerFrame;
+    NSUInteger numberOfSamples = [data length] / sizeof(short) / numberOfChannels;
+    NSUInteger leadingFrames = MIN(overlapFrames, firstFrame);
+    NSUInteger startSample = [self inputSampleForFrame:firstFrame - leadingFrames
+                                       samplesPerFrame:samplesPerFrame
+                                      outputSampleRate:outputSampleRate];
+    NSUInteger endSample = numberOfSamples;
+    if (!isLastSegment) {
+        endSample = MIN(numberOfSamples, [self inputSampleForFrame:lastFrame + overlapFrames
+                                                   samplesPerFrame:samplesPerFrame
+                                                  outputSampleRate:outputSampleRate]);
+    }
+    int segmentSamples = (int)(endSample - startSample);
+    int bufferSize = segmentSamples * 5 / 4 + 2 * kDHMP3FlushBufferSize;
+    NSMutableData *encodedData = [NSMutableData dataWithLength:bufferSize];
+    unsigned char *buffer = [encodedData mutableBytes];
+
+    int encodedBytes = [self encodeSamples:(short *)[data bytes] + startSample * numberOfChannels
+                           numberOfSamples:segmentSamples
+                                   encoder:encoder
+                                    buffer:buffer
+                                bufferSize:bufferSize];
+    if (encodedBytes >= 0) {
+        int flushedBytes = lame_encode_flush(encoder, buffer + encodedBytes, bufferSize - encodedBytes);
+        encodedBytes = flushedBytes < 0 ? flushedBytes : encodedBytes + flushedBytes;
+    }
+    lame_close(encoder);
+    if (encodedBytes < 0) {
+        *error = encodedBytes;
+        return nil;
+    }
+
+    //Keep only the frames that belong to this segment
+    NSUInteger numberOfKeptFrames = isLastSegment ? NSUIntegerMax - leadingFrames : lastFrame - firstFrame;
+    NSUInteger frameIndex = 0;
+    NSUInteger offset = 0;
+    NSUInteger keptStart = 0;
+    DHMP3FrameHeader header;
+    while (frameIndex < leadingFrames + numberOfKeptFrames && offset < (NSUInteger)encodedBytes &&
+           DHMP3ParseFrameHeader(buffer + offset, encodedBytes - offset, &header)) {
+        if (frameIndex == leadingFrames) {
+            keptStart = offset;
+        }
+        offset += header.frameLength;
+        frameIndex++;
+    }
+    if (frameIndex <= leadingFrames) {
+        return [NSData data];
+    }
+    return [encodedData subdataWithRange:NSMakeRange(keptStart, MIN(offset, (NSUInteger)encodedBytes) - keptStart)];
+}
+
+- (NSUInteger) inputSampleForFrame:(NSUInteger)frame
+                   samplesPerFrame:(int)samplesPerFrame
+                  outputSampleRate:(int)outputSampleRate
+{
+    return (NSUInteger)((unsigned long long)frame * samplesPerFrame * (NSUInteger)self.inFormat.mSampleRate / outputSampleRate);
+}
+
+- (NSUInteger) greatestCommonDivisorOf:(NSUInteger)a and:(NSUInteger)b
+{
+    while (b != 0) {
+        NSUInteger remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+- (int) lameTagVBRMethodForMode:(vbr_mode)mode
+{
+    switch (mode) {
+        case vbr_off:
+            return 1;
+        case vbr_abr:
+            return 2;
+        case vbr_rh:
+            return 3;
+        default:
+            return 4;
+    }
+}
 
 - (void) cleanUpResource
 {
-    lame_close(lame);
+    if (lame) {
+        lame_close(lame);
+        lame = NULL;
+    }
+    free(mp3Buffer);
+    mp3Buffer = NULL;
+    mp3BufferCapacity = 0;
+}
+
+- (void) dealloc
+{
+    [self cleanUpResource];
 }
 
 @end
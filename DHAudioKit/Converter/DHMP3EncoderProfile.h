@@ -0,0 +1,64 @@
+//
+//  DHMP3EncoderProfile.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, DHMP3BitRateMode) {
+    DHMP3BitRateModeVBR,
+    DHMP3BitRateModeABR,
+    DHMP3BitRateModeCBR,
+};
+
+/**
+ * The LAME settings used by `DHMP3AudioConverter`;
+ * The output sample rate and number of channels, when set, replace those of the converter's `outFormat`; `DHAudioConverterFactory destinationFormatForMP3EncoderProfile:sourceFormat:` builds the matching destination format;
+ */
+@interface DHMP3EncoderProfile : NSObject <NSCopying>
+
+/**
+ * CBR, ABR or VBR; Default value is DHMP3BitRateModeVBR;
+ */
+@property (nonatomic) DHMP3BitRateMode bitRateMode;
+
+/**
+ * Bitrate in kbps; The constant bitrate for CBR, the target average bitrate for ABR; Ignored for VBR;
+ */
+@property (nonatomic) int bitRate;
+
+/**
+ * VBR quality, 0 (best, largest) - 9 (worst, smallest); Only used for VBR; Default value is 4;
+ */
+@property (nonatomic) int vbrQuality;
+
+/**
+ * Encoder algorithm quality passed to `lame_set_quality`, 0 (best, slowest) - 9 (worst, fastest);
+ * Default value is -1, which keeps LAME's own default;
+ */
+@property (nonatomic) int quality;
+
+/**
+ * Output sample rate; 0 keeps the source sample rate; LAME resamples when it differs from the source;
+ */
+@property (nonatomic) Float64 sampleRate;
+
+/**
+ * Number of output channels; 0 keeps the source channels, 1 downmixes stereo input to mono;
+ */
+@property (nonatomic) UInt32 numberOfChannels;
+
+/**
+ * VBR with LAME's default quality at the source sample rate and channels;
+ */
++ (instancetype) defaultProfile;
+
+/**
+ * Fast profile for voice notes: 32 kbps CBR, 16 kHz mono, quality 7;
+ */
++ (instancetype) voiceProfile;
+
+@end
@@ -0,0 +1,58 @@
+//
+//  DHMP3EncoderProfile.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHMP3EncoderProfile.h"
+#import "DHAudioAttributes.h"
+
+static const int kDefaultVBRQuality = 4;
+static const int kDefaultQuality = -1;
+static const int kVoiceBitRate = 32;
+static const int kVoiceQuality = 7;
+
+@implementation DHMP3EncoderProfile
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self) {
+        _bitRateMode = DHMP3BitRateModeVBR;
+        _vbrQuality = kDefaultVBRQuality;
+        _quality = kDefaultQuality;
+    }
+    return self;
+}
+
++ (instancetype) defaultProfile
+{
+    return [[DHMP3EncoderProfile alloc] init];
+}
+
++ (instancetype) voiceProfile
+{
+    DHMP3EncoderProfile *profile = [[DHMP3EncoderProfile alloc] init];
+    profile.bitRateMode = DHMP3BitRateModeCBR;
+    profile.bitRate = kVoiceBitRate;
+    profile.quality = kVoiceQuality;
+    profile.sampleRate = DHAudioSampleRate16000;
+    profile.numberOfChannels = 1;
+    return profile;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    DHMP3EncoderProfile *profile = [[DHMP3EncoderProfile allocWithZone:zone] init];
+    profile.bitRateMode = self.bitRateMode;
+    profile.bitRate = self.bitRate;
+    profile.vbrQuality = self.vbrQuality;
+    profile.quality = self.quality;
+    profile.sampleRate = self.sampleRate;
+    profile.numberOfChannels = self.numberOfChannels;
+    return profile;
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+//  DHMP3FrameUtilities.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <string.h>
+
+#include "DHMP3FrameUtilities.h"
+
+// See: http://www.mp3-tech.org/programmer/frame_header.html
+// And: http://gabriel.mp3-tech.org/mp3infotag.html
+
+#define XING_TAG_LENGTH 120     //"Xing" + flags + frames + bytes + TOC + quality
+#define LAME_TAG_LENGTH 36
+#define XING_FLAGS 0x0F         //frames, bytes, TOC and quality fields are present
+
+static const int kMPEG1BitRates[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+static const int kMPEG2BitRates[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+static const int kMPEG1SampleRates[3] = {44100, 48000, 32000};
+
+static void writeUInt32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+static void writeUInt16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)(value >> 8);
+    bytes[1] = (uint8_t)value;
+}
+
+static int frameLength(DHMP3Version version, int bitRate, int sampleRate, int padding)
+{
+    int coefficient = version == DHMP3VersionMPEG1 ? 144000 : 72000;
+    return coefficient * bitRate / sampleRate + padding;
+}
+
+int DHMP3ParseFrameHeader(const uint8_t *bytes, size_t length, DHMP3FrameHeader *header)
+{
+    if (length < DHMP3_FRAME_HEADER_LENGTH || bytes[0] != 0xFF || (bytes[1] & 0xE0) != 0xE0) {
+        return 0;
+    }
+    int versionBits = (bytes[1] >> 3) & 0x03;
+    int layerBits = (bytes[1] >> 1) & 0x03;
+    int bitRateIndex = (bytes[2] >> 4) & 0x0F;
+    int sampleRateIndex = (bytes[2] >> 2) & 0x03;
+    if (versionBits == 1 || layerBits != 1 || bitRateIndex == 0 || bitRateIndex == 15 || sampleRateIndex == 3) {
+        return 0;
+    }
+    DHMP3Version version = (DHMP3Version)versionBits;
+    int sampleRate = kMPEG1SampleRates[sampleRateIndex];
+    if (version == DHMP3VersionMPEG2) {
+        sampleRate /= 2;
+    } else if (version == DHMP3VersionMPEG25) {
+        sampleRate /= 4;
+    }
+    int isMono = ((bytes[3] >> 6) & 0x03) == 3;
+
+    memcpy(header->raw, bytes, DHMP3_FRAME_HEADER_LENGTH);
+    header->version = version;
+    header->bitRate = version == DHMP3VersionMPEG1 ? kMPEG1BitRates[bitRateIndex] : kMPEG2BitRates[bitRateIndex];
+    header->sampleRate = sampleRate;
+    header->isMono = isMono;
+    header->samplesPerFrame = version == DHMP3VersionMPEG1 ? 1152 : 576;
+    header->frameLength = frameLength(version, header->bitRate, sampleRate, (bytes[2] >> 1) & 0x01);
+    if (version == DHMP3VersionMPEG1) {
+        header->sideInfoLength = isMono ? 17 : 32;
+    } else {
+        header->sideInfoLength = isMono ? 9 : 17;
+    }
+    return 1;
+}
+
+static int xingBitRateIndex(const DHMP3FrameHeader *reference)
+{
+    const int *bitRates = reference->version == DHMP3VersionMPEG1 ? kMPEG1BitRates : kMPEG2BitRates;
+    int required = DHMP3_FRAME_HEADER_LENGTH + reference->sideInfoLength + XING_TAG_LENGTH + LAME_TAG_LENGTH;
+    for (int i = 1; i < 15; i++) {
+        if (frameLength(reference->version, bitRates[i], reference->sampleRate, 0) >= required) {
+            return i;
+        }
+    }
+    return 14;
+}
+
+size_t DHMP3XingFrameLength(const DHMP3FrameHeader *reference)
+{
+    const int *bitRates = reference->version == DHMP3VersionMPEG1 ? kMPEG1BitRates : kMPEG2BitRates;
+    return frameLength(reference->version, bitRates[xingBitRateIndex(reference)], reference->sampleRate, 0);
+}
+
+size_t DHMP3WriteXingFrame(const DHMP3FrameHeader *reference,
+                           const DHMP3XingInfo *info,
+                           uint8_t *buffer,
+                           size_t capacity)
+{
+    size_t length = DHMP3XingFrameLength(reference);
+    if (capacity < length) {
+        return 0;
+    }
+    memset(buffer, 0, length);
+
+    //Frame header: same version, layer, sample rate and channel mode as the audio, no CRC, no padding
+    buffer[0] = 0xFF;
+    buffer[1] = reference->raw[1] | 0x01;
+    buffer[2] = (uint8_t)((xingBitRateIndex(reference) << 4) | (reference->raw[2] & 0x0C));
+    buffer[3] = reference->raw[3];
+
+    //Xing tag; the side info stays zeroed
+    uint8_t *xing = buffer + DHMP3_FRAME_HEADER_LENGTH + reference->sideInfoLength;
+    memcpy(xing, info->isVBR ? "Xing" : "Info", 4);
+    writeUInt32(xing + 4, XING_FLAGS);
+    writeUInt32(xing + 8, info->numberOfFrames);
+    writeUInt32(xing + 12, info->numberOfAudioBytes + (uint32_t)length);
+
+    uint8_t *toc = xing + 16;
+    double totalBytes = (double)info->numberOfAudioBytes + length;
+    for (int i = 0; i < DHMP3_XING_TOC_LENGTH; i++) {
+        double position;
+        if (info->frameOffsets && info->numberOfFrames > 0) {
+            uint32_t frameIndex = (uint32_t)((uint64_t)i * info->numberOfFrames / DHMP3_XING_TOC_LENGTH);
+            position = length + info->frameOffsets[frameIndex];
+        } else {
+            position = length + (double)info->numberOfAudioBytes * i / DHMP3_XING_TOC_LENGTH;
+        }
+        int value = (int)(256.0 * position / totalBytes);
+        toc[i] = (uint8_t)(value > 255 ? 255 : value);
+    }
+    writeUInt32(xing + 116, (uint32_t)info->quality);
+
+    //LAME tag
+    uint8_t *lame = xing + XING_TAG_LENGTH;
+    size_t versionLength = info->encoderVersion ? strlen(info->encoderVersion) : 0;
+    memcpy(lame, info->encoderVersion, versionLength > 9 ? 9 : versionLength);
+    lame[9] = (uint8_t)(info->vbrMethod & 0x0F);
+    lame[10] = (uint8_t)(info->lowpassFrequency / 100 > 255 ? 255 : info->lowpassFrequency / 100);
+    lame[20] = (uint8_t)(info->bitRate > 255 ? 255 : info->bitRate);
+    int delay = info->encoderDelay & 0xFFF;
+    int padding = info->encoderPadding & 0xFFF;
+    lame[21] = (uint8_t)(delay >> 4);
+    lame[22] = (uint8_t)(((delay & 0x0F) << 4) | (padding >> 8));
+    lame[23] = (uint8_t)padding;
+    writeUInt32(lame + 28, info->numberOfAudioBytes + (uint32_t)length);
+    writeUInt16(lame + 32, info->musicCRC);
+    writeUInt16(lame + 34, DHMP3CRC16(0, buffer, (size_t)(lame + 34 - buffer)));
+
+    return length;
+}
+
+uint16_t DHMP3CRC16(uint16_t crc, const uint8_t *bytes, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,81 @@
+//
+//  DHMP3FrameUtilities.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHMP3FrameUtilities_h
+#define DHMP3FrameUtilities_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHMP3_FRAME_HEADER_LENGTH 4
+#define DHMP3_XING_TOC_LENGTH 100
+
+typedef enum {
+    DHMP3VersionMPEG25 = 0,
+    DHMP3VersionMPEG2 = 2,
+    DHMP3VersionMPEG1 = 3,
+} DHMP3Version;
+
+/**
+ * The fields of a Layer III frame header that are needed to walk and rebuild a stream;
+ */
+typedef struct {
+    uint8_t raw[DHMP3_FRAME_HEADER_LENGTH];
+    DHMP3Version version;
+    int bitRate;            //kbps
+    int sampleRate;
+    int isMono;
+    int samplesPerFrame;
+    int frameLength;        //in bytes, including the header itself
+    int sideInfoLength;
+} DHMP3FrameHeader;
+
+/**
+ * Describes the stream that an Xing/Info frame with a LAME tag is written for;
+ */
+typedef struct {
+    const char *encoderVersion;     //at most 9 characters are written, e.g. "LAME3.100"
+    int isVBR;                      //"Xing" for VBR streams, "Info" for CBR streams
+    int quality;
+    int vbrMethod;                  //LAME tag VBR method: 1 CBR, 2 ABR, 3-5 VBR
+    int lowpassFrequency;
+    int bitRate;                    //kbps; ABR target or CBR bitrate, 0 if unknown
+    int encoderDelay;
+    int encoderPadding;
+    uint32_t numberOfFrames;        //audio frames, not counting the Xing/Info frame
+    uint32_t numberOfAudioBytes;    //audio bytes, not counting the Xing/Info frame
+    const uint32_t *frameOffsets;   //offset of each audio frame from the first audio frame; NULL for a linear TOC
+    uint16_t musicCRC;
+} DHMP3XingInfo;
+
+/**
+ * Parse a Layer III frame header;
+ * @return 1 if `bytes` starts with a valid Layer III header, 0 otherwise;
+ */
+int DHMP3ParseFrameHeader(const uint8_t *bytes, size_t length, DHMP3FrameHeader *header);
+
+/**
+ * Size of the Xing/Info frame that `DHMP3WriteXingFrame` writes for streams like `reference`;
+ */
+size_t DHMP3XingFrameLength(const DHMP3FrameHeader *reference);
+
+/**
+ * Write an Xing/Info frame with a LAME tag that matches the version, sample rate and channel mode of `reference`;
+ * @return the number of bytes written, 0 if `capacity` is too small;
+ */
+size_t DHMP3WriteXingFrame(const DHMP3FrameHeader *reference,
+                           const DHMP3XingInfo *info,
+                           uint8_t *buffer,
+                           size_t capacity);
+
+/**
+ * CRC-16 as used by the LAME tag (polynomial 0x8005, reflected);
+ */
+uint16_t DHMP3CRC16(uint16_t crc, const uint8_t *bytes, size_t length);
+
+#endif /* DHMP3FrameUtilities_h */
@@ -8,6 +8,18 @@
 
 #import "DHAudioConverter.h"
 
+/**
+ * Encodes 20 ms packets with the Opus multistream API, so 1 to 8 channels are supported, see `DHOpusUtilities.h` for the channel order;
+ * Every packet is delivered behind its length, see `DHOpusWritePacketLength`; Mono and stereo packets are plain Opus packets;
+ */
 @interface DHOpusAudioConverter : DHAudioConverter
 
+/**
+ * Number of 20 ms frames merged into one packet by the Opus repacketizer, 1 - 6 (up to 120 ms); Default value is 1, for interactive use;
+ * Larger packets save the per-packet framing and container overhead of uploads and storage, `DHOpusDecoder` decodes them as they are;
+ * Only mono and stereo streams are merged, the self-delimited streams of a multistream packet can not be; A packet is closed early when the encoder switches mode or bandwidth, or when it would exceed 1275 bytes;
+ * Set it before the conversion starts;
+ */
+@property (nonatomic) NSUInteger framesPerPacket;
+
 @end
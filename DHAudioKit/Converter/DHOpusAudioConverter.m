@@ -7,17 +7,26 @@
 //
 
 #import "DHOpusAudioConverter.h"
-#import "opus.h"
+#import "DHAudioResampler.h"
+#import "DHPCMFormatConverter.h"
+#import "DHOpusUtilities.h"
+#import "opus_multistream.h"
 
 #define OPUS_OUTPUT_BUFFER_SIZE 4000
 #define OPUS_DEFAULT_BITRATE 27800
+#define OPUS_MAXIMUM_FRAMES_PER_PACKET 6     //6 frames of 20 ms, the longest Opus packet is 120 ms
 
 @interface DHOpusAudioConverter () {
 }
-@property (nonatomic) OpusEncoder *encoder;
+@property (nonatomic) OpusMSEncoder *encoder;
+@property (nonatomic) int numberOfStreams;
 @property (nonatomic) int pcmBufferSize;
 @property (nonatomic, strong) NSMutableData *buffer;    //用来确保每次encode的PCM frame大小都为固定为可识别的frameSize
-@property (nonatomic) NSInteger numberOfBytesReceived;
+@property (nonatomic) BOOL encodesFloat;       //float input is encoded with opus_encode_float, without going through 16 bit
+@property (nonatomic, strong) DHPCMFormatConverter *formatConverter;
+@property (nonatomic, strong) DHAudioResampler *resampler;
+@property (nonatomic) OpusRepacketizer *repacketizer;
+@property (nonatomic, strong) NSMutableArray<NSData *> *pendingFrames;    //encoded frames of the packet being merged, the repacketizer points into them
 @end
 
 @implementation DHOpusAudioConverter
@@ -33,20 +42,62 @@
                                   delegate:delegate
                              delegateQueue:delegateQueue];
     if (self){
+        //Mono and stereo are one stream, whose packets are plain Opus packets; 3 - 8 channels are coupled into streams by the surround encoder
+        DHOpusChannelMapping channelMapping;
+        if (!DHOpusChannelMappingForNumberOfChannels(outFormat.mChannelsPerFrame, &channelMapping)) {
+            [self reportErrorWithErrorCode:OPUS_BAD_ARG message:@"Opus supports 1 to 8 channels"];
+            return nil;
+        }
         int error;
-        _encoder = opus_encoder_create(outFormat.mSampleRate, outFormat.mChannelsPerFrame, OPUS_APPLICATION_VOIP, &error);
+        int numberOfCoupledStreams;
+        _encoder = opus_multistream_surround_encoder_create(outFormat.mSampleRate, outFormat.mChannelsPerFrame, channelMapping.mappingFamily,
+                                                            &_numberOfStreams, &numberOfCoupledStreams, channelMapping.mapping,
+                                                            OPUS_APPLICATION_VOIP, &error);
         if (error != OPUS_OK) {
             [self reportErrorWithErrorCode:error message:@"Fail to create converter"];
             return nil;
         }
         
-        opus_encoder_ctl(self.encoder, OPUS_SET_VBR(1));
-        opus_encoder_ctl(self.encoder, OPUS_SET_BITRATE(self.bitRate));
-        opus_encoder_ctl(self.encoder, OPUS_SET_COMPLEXITY(8));
-        opus_encoder_ctl(self.encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+        opus_multistream_encoder_ctl(self.encoder, OPUS_SET_VBR(1));
+        opus_multistream_encoder_ctl(self.encoder, OPUS_SET_BITRATE(self.bitRate));
+        opus_multistream_encoder_ctl(self.encoder, OPUS_SET_COMPLEXITY(8));
+        opus_multistream_encoder_ctl(self.encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
         
-        _pcmBufferSize = outFormat.mSampleRate * 0.02 * sizeof(opus_int16) * outFormat.mChannelsPerFrame;  //20ms per frame
+        _encodesFloat = (inFormat.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+        int sampleSize = _encodesFloat ? sizeof(float) : sizeof(opus_int16);
+        //Whole frames first, so the size stays a multiple of a frame
+        int framesPerOpusFrame = (int)lround(outFormat.mSampleRate * 0.02);
+        _pcmBufferSize = framesPerOpusFrame * sampleSize * outFormat.mChannelsPerFrame;  //20ms per frame
+        AudioStreamBasicDescription encoderInputFormat;
+        if (_encodesFloat) {
+            encoderInputFormat = [DHPCMFormatConverter float32FormatWithSampleRate:inFormat.mSampleRate
+                                                                   numberOfChannels:outFormat.mChannelsPerFrame];
+        } else {
+            encoderInputFormat = [DHPCMFormatConverter signed16BitFormatWithSampleRate:inFormat.mSampleRate
+                                                                      numberOfChannels:outFormat.mChannelsPerFrame];
+        }
+        if ([DHPCMFormatConverter needsConversionFromFormat:inFormat toFormat:encoderInputFormat]) {
+            //The encoder takes 16-bit or float samples with its own number of channels
+            _formatConverter = [[DHPCMFormatConverter alloc] initWithInputFormat:inFormat outputFormat:encoderInputFormat];
+            if (_formatConverter == nil) {
+                [self reportErrorWithErrorCode:OPUS_BAD_ARG message:@"Unsupported input format"];
+                return nil;
+            }
+        }
+        if (inFormat.mSampleRate != outFormat.mSampleRate) {
+            //Opus only encodes 8, 12, 16, 24 and 48 kHz
+            _resampler = [[DHAudioResampler alloc] initWithInputFormat:encoderInputFormat
+                                                      outputSampleRate:outFormat.mSampleRate
+                                                               quality:DHResamplerQualityMedium];
+            if (_resampler == nil) {
+                [self reportErrorWithErrorCode:OPUS_BAD_ARG message:@"Fail to create resampler"];
+                return nil;
+            }
+        }
         _buffer = [NSMutableData data];
+        _framesPerPacket = 1;
+        _repacketizer = opus_repacketizer_create();
+        _pendingFrames = [NSMutableArray array];
         encodeQ = dispatch_queue_create("Opus Encode Queue", NULL);
         outBufferSize = OPUS_OUTPUT_BUFFER_SIZE;
     }
@@ -59,17 +110,35 @@
     if ([data length] == 0) {
         return;
     }
-    self.numberOfBytesReceived += [data length];
-    if (self.numberOfBytesReceived >= self.pcmBufferSize) {
-        self.numberOfPacketsReceived++;
-        self.numberOfBytesReceived -= self.pcmBufferSize;
-    }
     dispatch_async(encodeQ, ^{
-        [self.buffer appendData:data];
-        if ([self.buffer length] < self.pcmBufferSize) {
-            return;
+        NSData *pcmData = self.formatConverter ? [self.formatConverter convertData:data] : data;
+        [self.buffer appendData:self.resampler ? [self.resampler resampleData:pcmData] : pcmData];
+        [self encodeBufferedFrames];
+    });
+}
+
+- (void) stopConversion
+{
+    dispatch_async(encodeQ, ^{
+        if (self.resampler) {
+            //The resampler holds back half a filter of input
+            [self.buffer appendData:[self.resampler flush]];
+            [self encodeBufferedFrames];
         }
-        opus_int16 *pcmFrame = malloc(self.pcmBufferSize);
+        [self deliverPendingFrames];
+        //After the deliveries above on the delegate queue, so every frame handed to the encoder has been counted as converted
+        dispatch_async(self.delegateQueue, ^{
+            [super stopConversion];
+        });
+    });
+}
+
+- (void) encodeBufferedFrames
+{
+    while ([self.buffer length] >= self.pcmBufferSize) {
+        //Received packets are counted from the frames handed to the encoder, as the input does not split into 20 ms evenly at every rate, e.g. 220.5 frames at 11.025 kHz
+        self.numberOfPacketsReceived++;
+        void *pcmFrame = malloc(self.pcmBufferSize);
         memcpy(pcmFrame, [self.buffer bytes], self.pcmBufferSize);
         
         if ([self.buffer length] > self.pcmBufferSize) {
@@ -79,36 +148,127 @@
         }
         
         outBuffer = malloc(outBufferSize * sizeof(uint8_t));
-        int encodedBytes = opus_encode(self.encoder, pcmFrame, self.pcmBufferSize / sizeof(opus_int16) / self.outFormat.mChannelsPerFrame, outBuffer, OPUS_OUTPUT_BUFFER_SIZE);
-        NSMutableData *encodedData = [[NSMutableData alloc] initWithCapacity:outBufferSize];
-        
-        [encodedData appendBytes:&encodedBytes length:1];
-        [encodedData appendBytes:outBuffer length:encodedBytes];
-        dispatch_async(self.delegateQueue, ^{
-            [self.delegate audioConverter:self didFinishConversionWithData:encodedData];
-            self.numberOfPacketsConverted++;
-            [self finishConversionIfAllPacketsAreConverted];
-        });
+        int encodedBytes;
+        if (self.encodesFloat) {
+            int frameSize = self.pcmBufferSize / sizeof(float) / self.outFormat.mChannelsPerFrame;
+            encodedBytes = opus_multistream_encode_float(self.encoder, pcmFrame, frameSize, outBuffer, DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH);
+        } else {
+            int frameSize = self.pcmBufferSize / sizeof(opus_int16) / self.outFormat.mChannelsPerFrame;
+            encodedBytes = opus_multistream_encode(self.encoder, pcmFrame, frameSize, outBuffer, DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH);
+        }
+        free(pcmFrame);
+        NSData *frame = encodedBytes < 0 ? nil : [NSData dataWithBytes:outBuffer length:encodedBytes];
+        free(outBuffer);
+        outBuffer = NULL;
+        if (frame == nil) {
+            [self reportErrorWithErrorCode:encodedBytes message:@"Fail to convert data"];
+            [self deliverFramedData:nil numberOfFrames:1];
+        } else {
+            [self appendEncodedFrame:frame];
+        }
+    }
+}
+
+#pragma mark - Repacketizing
+- (void) setFramesPerPacket:(NSUInteger)framesPerPacket
+{
+    _framesPerPacket = MAX(1, MIN(framesPerPacket, OPUS_MAXIMUM_FRAMES_PER_PACKET));
+}
+
+/**
+ * Merge the frame into the packet being built, and deliver the packet once it holds `framesPerPacket` frames;
+ * The repacketizer only merges frames of the same mode, bandwidth and duration, a frame that differs closes the packet and starts the next one;
+ */
+- (void) appendEncodedFrame:(NSData *)frame
+{
+    BOOL canRepacketize = self.framesPerPacket > 1 && self.numberOfStreams == 1;
+    if (!canRepacketize) {
+        [self deliverFramedData:[self framedDataWithPacket:[frame bytes] length:(int)[frame length]] numberOfFrames:1];
+        return;
+    }
+    if (opus_repacketizer_cat(self.repacketizer, [frame bytes], (opus_int32)[frame length]) != OPUS_OK) {
+        [self deliverPendingFrames];
+        opus_repacketizer_cat(self.repacketizer, [frame bytes], (opus_int32)[frame length]);
+    }
+    [self.pendingFrames addObject:frame];
+    if ([self.pendingFrames count] >= self.framesPerPacket) {
+        [self deliverPendingFrames];
+    }
+}
+
+/**
+ * Deliver the merged packet, split in two or more when it would not fit the length framing;
+ */
+- (void) deliverPendingFrames
+{
+    NSUInteger numberOfFrames = [self.pendingFrames count];
+    if (numberOfFrames == 0) {
+        return;
+    }
+    NSMutableData *framedData = [NSMutableData data];
+    unsigned char packet[DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH];
+    int numberOfOpusFrames = opus_repacketizer_get_nb_frames(self.repacketizer);
+    int begin = 0;
+    while (begin < numberOfOpusFrames) {
+        int end = numberOfOpusFrames;
+        opus_int32 length = opus_repacketizer_out_range(self.repacketizer, begin, end, packet, sizeof(packet));
+        while (length == OPUS_BUFFER_TOO_SMALL && end > begin + 1) {
+            end--;
+            length = opus_repacketizer_out_range(self.repacketizer, begin, end, packet, sizeof(packet));
+        }
+        if (length < 0) {
+            [self reportErrorWithErrorCode:length message:@"Fail to repacketize data"];
+            break;
+        }
+        [framedData appendData:[self framedDataWithPacket:packet length:length]];
+        begin = end;
+    }
+    opus_repacketizer_init(self.repacketizer);
+    [self.pendingFrames removeAllObjects];
+    [self deliverFramedData:framedData numberOfFrames:numberOfFrames];
+}
+
+- (NSData *) framedDataWithPacket:(const unsigned char *)packet length:(int)length
+{
+    NSMutableData *framedData = [NSMutableData dataWithCapacity:length + 2];
+    uint8_t lengthHeader[2];
+    [framedData appendBytes:lengthHeader length:DHOpusWritePacketLength(lengthHeader, length)];
+    [framedData appendBytes:packet length:length];
+    return framedData;
+}
+
+/**
+ * @param numberOfFrames the 20 ms frames in `framedData`, which are counted as converted packets
+ */
+- (void) deliverFramedData:(NSData *)framedData numberOfFrames:(NSUInteger)numberOfFrames
+{
+    dispatch_async(self.delegateQueue, ^{
+        if ([framedData length] > 0) {
+            [self.delegate audioConverter:self didFinishConversionWithData:framedData];
+        }
+        self.numberOfPacketsConverted += numberOfFrames;
+        [self finishConversionIfAllPacketsAreConverted];
     });
 }
 
 - (void) setBitRate:(UInt32)bitRate
 {
     [super setBitRate:bitRate];
-    opus_encoder_ctl(self.encoder, OPUS_SET_BITRATE(bitRate));
+    opus_multistream_encoder_ctl(self.encoder, OPUS_SET_BITRATE(bitRate));
 }
 
 - (UInt32) bitRate
 {
     if ([super bitRate] == 0) {
-        return OPUS_DEFAULT_BITRATE;
+        return OPUS_DEFAULT_BITRATE * MAX(self.numberOfStreams, 1);
     }
     return [super bitRate];
 }
 
 - (void) cleanUpResource
 {
-    opus_encoder_destroy(self.encoder);
+    opus_multistream_encoder_destroy(self.encoder);
+    opus_repacketizer_destroy(self.repacketizer);
 }
 @end
 
@@ -0,0 +1,248 @@
+//
+//  DHOpusUtilities.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "DHOpusUtilities.h"
+
+// Channel Mapping
+
+//Streams, coupled streams and channel mapping of mapping family 1, indexed by number of channels - 1, as in RFC 7845 and libopus
+static const DHOpusChannelMapping kChannelMappings[DHOPUS_MAXIMUM_NUMBER_OF_CHANNELS] = {
+    {0, 1, 0, {0}},
+    {0, 1, 1, {0, 1}},
+    {1, 2, 1, {0, 2, 1}},
+    {1, 2, 2, {0, 1, 2, 3}},
+    {1, 3, 2, {0, 4, 1, 2, 3}},
+    {1, 4, 2, {0, 4, 1, 2, 3, 5}},
+    {1, 4, 3, {0, 4, 1, 2, 3, 5, 6}},
+    {1, 5, 3, {0, 6, 1, 2, 3, 4, 5, 7}},
+};
+
+int DHOpusChannelMappingForNumberOfChannels(int numberOfChannels, DHOpusChannelMapping *mapping)
+{
+    if (numberOfChannels < 1 || numberOfChannels > DHOPUS_MAXIMUM_NUMBER_OF_CHANNELS) {
+        return 0;
+    }
+    *mapping = kChannelMappings[numberOfChannels - 1];
+    return 1;
+}
+
+// Packet Framing
+
+size_t DHOpusWritePacketLength(uint8_t *header, size_t packetLength)
+{
+    if (packetLength < 252) {
+        header[0] = (uint8_t)packetLength;
+        return 1;
+    }
+    if (packetLength > DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH) {
+        return 0;
+    }
+    header[0] = (uint8_t)(252 + (packetLength & 3));
+    header[1] = (uint8_t)((packetLength - header[0]) >> 2);
+    return 2;
+}
+
+size_t DHOpusReadPacketLength(const uint8_t *bytes, size_t length, size_t *packetLength)
+{
+    if (length < 1) {
+        return 0;
+    }
+    if (bytes[0] < 252) {
+        *packetLength = bytes[0];
+        return 1;
+    }
+    if (length < 2) {
+        return 0;
+    }
+    *packetLength = 4 * (size_t)bytes[1] + bytes[0];
+    return 2;
+}
+
+//Frame durations in 2.5 ms units, indexed by TOC configuration: SILK 10/20/40/60 ms, Hybrid 10/20 ms, CELT 2.5/5/10/20 ms
+static const uint8_t kFrameDurations[32] = {
+    4, 8, 16, 24, 4, 8, 16, 24, 4, 8, 16, 24,
+    4, 8, 4, 8,
+    1, 2, 4, 8, 1, 2, 4, 8, 1, 2, 4, 8, 1, 2, 4, 8,
+};
+
+#define OPUS_MAXIMUM_PACKET_DURATION 48     //120 ms in 2.5 ms units
+
+//Duration in 2.5 ms units, 0 if the packet is malformed
+static int packetDuration(const uint8_t *packet, size_t length)
+{
+    if (length < 1) {
+        return 0;
+    }
+    int frameDuration = kFrameDurations[packet[0] >> 3];
+    int numberOfFrames;
+    switch (packet[0] & 3) {
+        case 0:
+            numberOfFrames = 1;
+            break;
+        case 1:
+        case 2:
+            numberOfFrames = 2;
+            break;
+        default:
+            if (length < 2) {
+                return 0;
+            }
+            numberOfFrames = packet[1] & 0x3F;
+            break;
+    }
+    int duration = frameDuration * numberOfFrames;
+    return duration <= OPUS_MAXIMUM_PACKET_DURATION ? duration : 0;
+}
+
+int DHOpusPacketNumberOfSamples(const uint8_t *packet, size_t length, int sampleRate)
+{
+    return packetDuration(packet, length) * sampleRate / 400;
+}
+
+// Encoder Delay
+
+int DHOpusEncoderDelay(int sampleRate)
+{
+    return sampleRate * 13 / 2000;
+}
+
+// Packet Index
+
+static int appendPacket(DHOpusPacketIndex *index, uint64_t offset, uint16_t span, uint8_t duration)
+{
+    if (index->numberOfPackets == index->capacity) {
+        size_t capacity = index->capacity > 0 ? index->capacity * 2 : 1024;
+        uint16_t *spans = realloc(index->spans, capacity * sizeof(uint16_t));
+        if (spans == NULL) {
+            return 0;
+        }
+        index->spans = spans;
+        uint8_t *durations = realloc(index->durations, capacity * sizeof(uint8_t));
+        if (durations == NULL) {
+            return 0;
+        }
+        index->durations = durations;
+        DHOpusPacketIndexCheckpoint *checkpoints = realloc(index->checkpoints, (capacity / DHOPUS_INDEX_CHECKPOINT_INTERVAL + 1) * sizeof(DHOpusPacketIndexCheckpoint));
+        if (checkpoints == NULL) {
+            return 0;
+        }
+        index->checkpoints = checkpoints;
+        index->capacity = capacity;
+    }
+    if (index->numberOfPackets % DHOPUS_INDEX_CHECKPOINT_INTERVAL == 0) {
+        DHOpusPacketIndexCheckpoint *checkpoint = &index->checkpoints[index->numberOfPackets / DHOPUS_INDEX_CHECKPOINT_INTERVAL];
+        checkpoint->offset = offset;
+        checkpoint->frame = index->numberOfFrames;
+    }
+    index->spans[index->numberOfPackets] = span;
+    index->durations[index->numberOfPackets] = duration;
+    index->numberOfPackets++;
+    index->numberOfFrames += (uint64_t)duration * (uint64_t)index->sampleRate / 400;
+    return 1;
+}
+
+int DHOpusPacketIndexBuild(DHOpusPacketIndex *index, const uint8_t *bytes, size_t length, int sampleRate)
+{
+    memset(index, 0, sizeof(DHOpusPacketIndex));
+    index->sampleRate = sampleRate;
+    size_t offset = 0;
+    int previousDuration = 0;
+    while (offset < length) {
+        size_t packetLength = 0;
+        size_t headerLength = DHOpusReadPacketLength(bytes + offset, length - offset, &packetLength);
+        if (headerLength == 0 || packetLength > DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH || packetLength > length - offset - headerLength) {
+            break;
+        }
+        //An empty packet is a lost one, the decoder conceals it with the duration of the previous packet
+        int duration = packetLength > 0 ? packetDuration(bytes + offset + headerLength, packetLength) : previousDuration;
+        if (duration == 0) {
+            break;
+        }
+        if (!appendPacket(index, offset, (uint16_t)(headerLength + packetLength), (uint8_t)duration)) {
+            DHOpusPacketIndexDestroy(index);
+            return 0;
+        }
+        previousDuration = duration;
+        offset += headerLength + packetLength;
+    }
+    return index->numberOfPackets > 0;
+}
+
+void DHOpusPacketIndexDestroy(DHOpusPacketIndex *index)
+{
+    free(index->spans);
+    free(index->durations);
+    free(index->checkpoints);
+    memset(index, 0, sizeof(DHOpusPacketIndex));
+}
+
+uint64_t DHOpusPacketIndexOffsetOfPacket(const DHOpusPacketIndex *index, size_t packet)
+{
+    if (index->numberOfPackets == 0) {
+        return 0;
+    }
+    if (packet > index->numberOfPackets) {
+        packet = index->numberOfPackets;
+    }
+    size_t checkpoint = packet / DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    size_t first = checkpoint * DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    if (first == index->numberOfPackets) {
+        //The end of the stream right on a checkpoint boundary, step back one block
+        checkpoint--;
+        first -= DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    }
+    uint64_t offset = index->checkpoints[checkpoint].offset;
+    for (size_t i = first; i < packet; i++) {
+        offset += index->spans[i];
+    }
+    return offset;
+}
+
+uint64_t DHOpusPacketIndexFrameOfPacket(const DHOpusPacketIndex *index, size_t packet)
+{
+    if (packet >= index->numberOfPackets) {
+        return index->numberOfFrames;
+    }
+    size_t checkpoint = packet / DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    uint64_t units = 0;
+    for (size_t i = checkpoint * DHOPUS_INDEX_CHECKPOINT_INTERVAL; i < packet; i++) {
+        units += index->durations[i];
+    }
+    return index->checkpoints[checkpoint].frame + units * (uint64_t)index->sampleRate / 400;
+}
+
+size_t DHOpusPacketIndexPacketForFrame(const DHOpusPacketIndex *index, uint64_t frame)
+{
+    if (index->numberOfPackets == 0) {
+        return 0;
+    }
+    //Last checkpoint at or before `frame`
+    size_t low = 0;
+    size_t high = (index->numberOfPackets - 1) / DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    while (low < high) {
+        size_t middle = (low + high + 1) / 2;
+        if (index->checkpoints[middle].frame <= frame) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    size_t packet = low * DHOPUS_INDEX_CHECKPOINT_INTERVAL;
+    uint64_t packetFrame = index->checkpoints[low].frame;
+    while (packet + 1 < index->numberOfPackets) {
+        uint64_t nextFrame = packetFrame + (uint64_t)index->durations[packet] * (uint64_t)index->sampleRate / 400;
+        if (nextFrame > frame) {
+            break;
+        }
+        packetFrame = nextFrame;
+        packet++;
+    }
+    return packet;
+}
@@ -0,0 +1,118 @@
+//
+//  DHOpusUtilities.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHOpusUtilities_h
+#define DHOpusUtilities_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHOPUS_MAXIMUM_NUMBER_OF_CHANNELS 8
+#define DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH 1275
+
+// Channel Mapping
+
+/**
+ * How the channels of a stream are spread over the Opus streams of a multistream packet;
+ * Mono and stereo are a single stream (mapping family 0), so their packets are plain Opus packets; 3 to 8 channels use the Vorbis channel order of mapping family 1, e.g. L, C, R, Ls, Rs, LFE for 5.1;
+ * See: https://tools.ietf.org/html/rfc7845#section-5.1.1
+ */
+typedef struct {
+    int mappingFamily;
+    int numberOfStreams;
+    int numberOfCoupledStreams;
+    unsigned char mapping[DHOPUS_MAXIMUM_NUMBER_OF_CHANNELS];
+} DHOpusChannelMapping;
+
+/**
+ * @return 0 if Opus has no standard mapping for `numberOfChannels`
+ */
+int DHOpusChannelMappingForNumberOfChannels(int numberOfChannels, DHOpusChannelMapping *mapping);
+
+// Packet Framing
+
+/**
+ * The converter writes every packet behind its length, coded like the frame lengths inside an Opus packet: 1 byte below 252, 2 bytes up to `DHOPUS_MAXIMUM_FRAMED_PACKET_LENGTH`;
+ * See: https://tools.ietf.org/html/rfc6716#section-3.2.1
+ *
+ * @param header 2 bytes
+ * @return number of bytes written, 0 if the packet is too long
+ */
+size_t DHOpusWritePacketLength(uint8_t *header, size_t packetLength);
+
+/**
+ * @param packetLength set to the length of the packet that follows the header
+ * @return number of header bytes, 0 if `length` bytes do not hold the whole header
+ */
+size_t DHOpusReadPacketLength(const uint8_t *bytes, size_t length, size_t *packetLength);
+
+/**
+ * Duration of an Opus packet from its TOC byte (and frame count byte), without decoding it;
+ * See: https://tools.ietf.org/html/rfc6716#section-3.1
+ * @return number of samples per channel at `sampleRate`, 0 if the packet is malformed
+ */
+int DHOpusPacketNumberOfSamples(const uint8_t *packet, size_t length, int sampleRate);
+
+// Encoder Delay
+
+/**
+ * Frames of delay the libopus encoder puts in front of the audio, 6.5 ms at any rate: 2.5 ms of look ahead plus 4 ms of delay compensation;
+ * The length-framed stream has no header to carry it, so the player assumes it, as an Ogg stream's pre-skip would tell;
+ * See: https://tools.ietf.org/html/rfc7845#section-4.2
+ * @return number of frames at `sampleRate`
+ */
+int DHOpusEncoderDelay(int sampleRate);
+
+// Packet Index
+
+#define DHOPUS_INDEX_CHECKPOINT_INTERVAL 64
+
+typedef struct {
+    uint64_t offset;
+    uint64_t frame;
+} DHOpusPacketIndexCheckpoint;
+
+/**
+ * Offsets and start times of the packets of a length-framed stream, built by reading only the framing and TOC bytes, for an exact duration and seeking without decoding;
+ * Each packet costs 3 bytes: the distance to the next packet and its duration in 2.5 ms units; The offset and first frame of every 64th packet are kept as a checkpoint, so a lookup is a binary search plus at most 63 additions;
+ * The scan stops at the first malformed or truncated packet;
+ */
+typedef struct {
+    uint16_t *spans;
+    uint8_t *durations;
+    DHOpusPacketIndexCheckpoint *checkpoints;
+    size_t numberOfPackets;
+    size_t capacity;
+    int sampleRate;
+    uint64_t numberOfFrames;
+} DHOpusPacketIndex;
+
+/**
+ * Index a stream written by `DHOpusAudioConverter`; Returns 0 if no packet is found or the allocation fails;
+ * @param sampleRate the rate frames are counted at, the rate the stream is decoded to
+ */
+int DHOpusPacketIndexBuild(DHOpusPacketIndex *index, const uint8_t *bytes, size_t length, int sampleRate);
+
+void DHOpusPacketIndexDestroy(DHOpusPacketIndex *index);
+
+/**
+ * Byte offset of the length header of packet `packet`; `numberOfPackets` gives the end of the last packet;
+ */
+uint64_t DHOpusPacketIndexOffsetOfPacket(const DHOpusPacketIndex *index, size_t packet);
+
+/**
+ * First PCM frame of packet `packet`; `numberOfPackets` gives `numberOfFrames`;
+ */
+uint64_t DHOpusPacketIndexFrameOfPacket(const DHOpusPacketIndex *index, size_t packet);
+
+/**
+ * The packet that contains PCM frame `frame`, clamped to the last packet;
+ */
+size_t DHOpusPacketIndexPacketForFrame(const DHOpusPacketIndex *index, uint64_t frame);
+
+#endif /* DHOpusUtilities_h */
@@ -0,0 +1,63 @@
+//
+//  DHPCMFormatConverter.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "DHSampleFormatConversion.h"
+
+/**
+ * Sample format and channel conversion stage between two interleaved Linear PCM formats of the same sample rate, e.g. to feed float or 24-bit input to a codec that takes 16-bit samples;
+ * Supported samples are signed 16, 24 and 32-bit integers and 32-bit floats, native endian; The channel counts have to match, or be mono and stereo; See `DHSampleFormatConversion.h` for the kernels;
+ * Not thread safe, call it from one queue;
+ */
+@interface DHPCMFormatConverter : NSObject
+
+@property (nonatomic, readonly) AudioStreamBasicDescription inputFormat;
+@property (nonatomic, readonly) AudioStreamBasicDescription outputFormat;
+
+/**
+ * Initializer
+ * @return nil if either format or the channel mapping is not supported
+ */
+- (instancetype) initWithInputFormat:(AudioStreamBasicDescription)inFormat
+                        outputFormat:(AudioStreamBasicDescription)outFormat;
+
+/**
+ * Convert whole frames; A partial frame at the end of `data` is dropped;
+ * @return nil if the memory could not be allocated
+ */
+- (NSData *) convertData:(NSData *)data;
+
+/**
+ * Convert into a caller owned buffer, without allocating once the scratch buffer is large enough;
+ * @param output `numberOfFrames * outputFormat.mBytesPerFrame` bytes
+ * @return NO if the scratch buffer could not grow
+ */
+- (BOOL) convertFrames:(const void *)input
+        numberOfFrames:(UInt32)numberOfFrames
+              toBuffer:(void *)output;
+
+/**
+ * Whether the two formats differ in a way this class converts; NO when they are the same, so no stage is needed;
+ */
++ (BOOL) needsConversionFromFormat:(AudioStreamBasicDescription)inFormat
+                          toFormat:(AudioStreamBasicDescription)outFormat;
+
+/**
+ * 16-bit signed packed interleaved Linear PCM, the format the codecs of the kit take;
+ */
++ (AudioStreamBasicDescription) signed16BitFormatWithSampleRate:(Float64)sampleRate
+                                               numberOfChannels:(UInt32)numberOfChannels;
+
+/**
+ * 32-bit float packed interleaved Linear PCM;
+ */
++ (AudioStreamBasicDescription) float32FormatWithSampleRate:(Float64)sampleRate
+                                           numberOfChannels:(UInt32)numberOfChannels;
+
+@end
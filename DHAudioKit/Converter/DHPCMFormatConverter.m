@@ -0,0 +1,224 @@
+//
+//  DHPCMFormatConverter.m
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import "DHPCMFormatConverter.h"
+
+typedef NS_ENUM(NSInteger, DHPCMSampleType) {
+    DHPCMSampleTypeUnsupported,
+    DHPCMSampleTypeInt16,
+    DHPCMSampleTypeInt24,
+    DHPCMSampleTypeInt32,
+    DHPCMSampleTypeFloat32,
+};
+
+static DHPCMSampleType DHPCMSampleTypeOfFormat(AudioStreamBasicDescription format)
+{
+    UInt32 flags = format.mFormatFlags;
+    if (format.mFormatID != kAudioFormatLinearPCM ||
+        (flags & kAudioFormatFlagIsNonInterleaved) ||
+        (flags & kAudioFormatFlagIsBigEndian) != (kAudioFormatFlagsNativeEndian & kAudioFormatFlagIsBigEndian) ||
+        format.mChannelsPerFrame == 0 ||
+        format.mBytesPerFrame != format.mBitsPerChannel / 8 * format.mChannelsPerFrame) {
+        return DHPCMSampleTypeUnsupported;
+    }
+    if (flags & kAudioFormatFlagIsFloat) {
+        return format.mBitsPerChannel == 32 ? DHPCMSampleTypeFloat32 : DHPCMSampleTypeUnsupported;
+    }
+    if (!(flags & kAudioFormatFlagIsSignedInteger)) {
+        return DHPCMSampleTypeUnsupported;
+    }
+    switch (format.mBitsPerChannel) {
+        case 16:
+            return DHPCMSampleTypeInt16;
+        case 24:
+            return DHPCMSampleTypeInt24;
+        case 32:
+            return DHPCMSampleTypeInt32;
+        default:
+            return DHPCMSampleTypeUnsupported;
+    }
+}
+
+@interface DHPCMFormatConverter () {
+    float *scratch;
+    size_t scratchCapacity;     //in samples
+}
+@property (nonatomic, readwrite) AudioStreamBasicDescription inputFormat;
+@property (nonatomic, readwrite) AudioStreamBasicDescription outputFormat;
+@property (nonatomic) DHPCMSampleType inputSampleType;
+@property (nonatomic) DHPCMSampleType outputSampleType;
+@end
+
+@implementation DHPCMFormatConverter
+
+- (instancetype) initWithInputFormat:(AudioStreamBasicDescription)inFormat
+                        outputFormat:(AudioStreamBasicDescription)outFormat
+{
+    self = [super init];
+    if (self) {
+        _inputSampleType = DHPCMSampleTypeOfFormat(inFormat);
+        _outputSampleType = DHPCMSampleTypeOfFormat(outFormat);
+        UInt32 inChannels = inFormat.mChannelsPerFrame;
+        UInt32 outChannels = outFormat.mChannelsPerFrame;
+        BOOL canMapChannels = inChannels == outChannels || (inChannels <= 2 && outChannels <= 2);
+        if (_inputSampleType == DHPCMSampleTypeUnsupported ||
+            _outputSampleType == DHPCMSampleTypeUnsupported ||
+            inFormat.mSampleRate != outFormat.mSampleRate ||
+            !canMapChannels) {
+            return nil;
+        }
+        _inputFormat = inFormat;
+        _outputFormat = outFormat;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(scratch);
+}
+
+#pragma mark - Conversion
+- (NSData *) convertData:(NSData *)data
+{
+    UInt32 numberOfFrames = (UInt32)([data length] / self.inputFormat.mBytesPerFrame);
+    if (numberOfFrames == 0) {
+        return [NSData data];
+    }
+    NSMutableData *output = [NSMutableData dataWithLength:numberOfFrames * self.outputFormat.mBytesPerFrame];
+    if (output == nil || ![self convertFrames:[data bytes] numberOfFrames:numberOfFrames toBuffer:[output mutableBytes]]) {
+        return nil;
+    }
+    return output;
+}
+
+/**
+ * 16 bit to 16 bit only maps the channels; Everything else goes through float: the input samples are widened, the channels are mapped, and the result is narrowed into `output`;
+ */
+- (BOOL) convertFrames:(const void *)input
+        numberOfFrames:(UInt32)numberOfFrames
+              toBuffer:(void *)output
+{
+    UInt32 inChannels = self.inputFormat.mChannelsPerFrame;
+    UInt32 outChannels = self.outputFormat.mChannelsPerFrame;
+    if (self.inputSampleType == self.outputSampleType && inChannels == outChannels) {
+        memcpy(output, input, numberOfFrames * self.inputFormat.mBytesPerFrame);
+        return YES;
+    }
+    if (self.inputSampleType == DHPCMSampleTypeInt16 && self.outputSampleType == DHPCMSampleTypeInt16) {
+        if (inChannels == 2) {
+            DHSampleFormatStereoToMonoInt16(input, output, numberOfFrames);
+        } else {
+            DHSampleFormatMonoToStereoInt16(input, output, numberOfFrames);
+        }
+        return YES;
+    }
+
+    size_t numberOfInputSamples = (size_t)numberOfFrames * inChannels;
+    size_t numberOfOutputSamples = (size_t)numberOfFrames * outChannels;
+    if (![self reserveScratchForNumberOfSamples:numberOfInputSamples + numberOfOutputSamples]) {
+        return NO;
+    }
+    const float *samples = [self float32SamplesFromSamples:input numberOfSamples:numberOfInputSamples];
+    if (inChannels != outChannels) {
+        float *mapped = self.outputSampleType == DHPCMSampleTypeFloat32 ? output : scratch + numberOfInputSamples;
+        if (inChannels == 2) {
+            DHSampleFormatStereoToMonoFloat32(samples, mapped, numberOfFrames);
+        } else {
+            DHSampleFormatMonoToStereoFloat32(samples, mapped, numberOfFrames);
+        }
+        samples = mapped;
+    }
+    [self writeFloat32Samples:samples numberOfSamples:numberOfOutputSamples toBuffer:output];
+    return YES;
+}
+
+- (const float *) float32SamplesFromSamples:(const void *)input numberOfSamples:(size_t)numberOfSamples
+{
+    switch (self.inputSampleType) {
+        case DHPCMSampleTypeInt16:
+            DHSampleFormatInt16ToFloat32(input, scratch, numberOfSamples);
+            return scratch;
+        case DHPCMSampleTypeInt24:
+            DHSampleFormatInt24ToFloat32(input, scratch, numberOfSamples);
+            return scratch;
+        case DHPCMSampleTypeInt32:
+            DHSampleFormatInt32ToFloat32(input, scratch, numberOfSamples);
+            return scratch;
+        default:
+            return input;
+    }
+}
+
+- (void) writeFloat32Samples:(const float *)samples numberOfSamples:(size_t)numberOfSamples toBuffer:(void *)output
+{
+    switch (self.outputSampleType) {
+        case DHPCMSampleTypeInt16:
+            DHSampleFormatFloat32ToInt16(samples, output, numberOfSamples);
+            break;
+        case DHPCMSampleTypeInt24:
+            DHSampleFormatFloat32ToInt24(samples, output, numberOfSamples);
+            break;
+        case DHPCMSampleTypeInt32:
+            DHSampleFormatFloat32ToInt32(samples, output, numberOfSamples);
+            break;
+        default:
+            if (samples != output) {
+                memcpy(output, samples, numberOfSamples * sizeof(float));
+            }
+            break;
+    }
+}
+
+- (BOOL) reserveScratchForNumberOfSamples:(size_t)numberOfSamples
+{
+    if (numberOfSamples <= scratchCapacity) {
+        return YES;
+    }
+    float *newScratch = realloc(scratch, numberOfSamples * sizeof(float));
+    if (newScratch == NULL) {
+        return NO;
+    }
+    scratch = newScratch;
+    scratchCapacity = numberOfSamples;
+    return YES;
+}
+
+#pragma mark - Formats
++ (BOOL) needsConversionFromFormat:(AudioStreamBasicDescription)inFormat
+                          toFormat:(AudioStreamBasicDescription)outFormat
+{
+    return DHPCMSampleTypeOfFormat(inFormat) != DHPCMSampleTypeOfFormat(outFormat) ||
+           inFormat.mChannelsPerFrame != outFormat.mChannelsPerFrame;
+}
+
++ (AudioStreamBasicDescription) signed16BitFormatWithSampleRate:(Float64)sampleRate
+                                               numberOfChannels:(UInt32)numberOfChannels
+{
+    AudioStreamBasicDescription format = {0};
+    format.mFormatID = kAudioFormatLinearPCM;
+    format.mSampleRate = sampleRate;
+    format.mChannelsPerFrame = numberOfChannels;
+    format.mBitsPerChannel = 16;
+    format.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+    format.mBytesPerPacket = format.mBytesPerFrame = format.mBitsPerChannel / 8 * format.mChannelsPerFrame;
+    format.mFramesPerPacket = 1;
+    return format;
+}
+
++ (AudioStreamBasicDescription) float32FormatWithSampleRate:(Float64)sampleRate
+                                           numberOfChannels:(UInt32)numberOfChannels
+{
+    AudioStreamBasicDescription format = [self signed16BitFormatWithSampleRate:sampleRate numberOfChannels:numberOfChannels];
+    format.mBitsPerChannel = 32;
+    format.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+    format.mBytesPerPacket = format.mBytesPerFrame = format.mBitsPerChannel / 8 * format.mChannelsPerFrame;
+    return format;
+}
+
+@end
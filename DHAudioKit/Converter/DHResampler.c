@@ -0,0 +1,338 @@
+//
+//  DHResampler.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DH_RESAMPLER_NEON 1
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DH_RESAMPLER_SSE 1
+#endif
+
+#include "DHResampler.h"
+
+#define MAXIMUM_NUMBER_OF_PHASES 4096
+#define PI 3.14159265358979323846
+
+typedef struct {
+    int numberOfTaps;
+    double rolloff;         //cutoff relative to the lower Nyquist frequency
+    double beta;            //Kaiser window shape
+} DHResamplerPreset;
+
+static const DHResamplerPreset kPresets[] = {
+    {16, 0.85, 6.0},
+    {32, 0.91, 8.0},
+    {64, 0.95, 10.0},
+};
+
+struct DHResampler {
+    int numberOfChannels;
+    int upFactor;               //L
+    int downFactor;             //M
+    int numberOfTaps;           //multiple of 4
+    float *filterBank;          //L phases of numberOfTaps coefficients
+    float *history;             //one run of historyCapacity frames per channel
+    size_t historyCapacity;
+    size_t historyLength;
+    size_t inputIndex;          //the output at inputIndex + phase / L is computed next
+    int phase;
+    uint64_t numberOfInputFrames;
+    uint64_t numberOfOutputFrames;
+};
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0) {
+        int remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+//Zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static void buildFilterBank(DHResampler *resampler, double cutoff, double beta)
+{
+    int taps = resampler->numberOfTaps;
+    int halfTaps = taps / 2;
+    double windowNormalization = besselI0(beta);
+    for (int phase = 0; phase < resampler->upFactor; phase++) {
+        float *filter = resampler->filterBank + (size_t)phase * taps;
+        double sum = 0;
+        for (int k = 0; k < taps; k++) {
+            //Distance from the tap to the output position, in input samples
+            double distance = (k - (halfTaps - 1)) - (double)phase / resampler->upFactor;
+            double x = 2.0 * cutoff * distance;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(PI * x) / (PI * x);
+            double position = distance / halfTaps;
+            double window = fabs(position) >= 1.0 ? 0.0 : besselI0(beta * sqrt(1.0 - position * position)) / windowNormalization;
+            double coefficient = 2.0 * cutoff * sinc * window;
+            filter[k] = (float)coefficient;
+            sum += coefficient;
+        }
+        //Unity gain at DC for every phase
+        for (int k = 0; k < taps; k++) {
+            filter[k] = (float)(filter[k] / sum);
+        }
+    }
+}
+
+static inline float dotProduct(const float *samples, const float *filter, int numberOfTaps)
+{
+#if DH_RESAMPLER_NEON
+    float32x4_t accumulator = vdupq_n_f32(0);
+    for (int k = 0; k < numberOfTaps; k += 4) {
+        accumulator = vmlaq_f32(accumulator, vld1q_f32(samples + k), vld1q_f32(filter + k));
+    }
+    float32x2_t pair = vadd_f32(vget_low_f32(accumulator), vget_high_f32(accumulator));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#elif DH_RESAMPLER_SSE
+    __m128 accumulator = _mm_setzero_ps();
+    for (int k = 0; k < numberOfTaps; k += 4) {
+        accumulator = _mm_add_ps(accumulator, _mm_mul_ps(_mm_loadu_ps(samples + k), _mm_loadu_ps(filter + k)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, accumulator);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum = 0;
+    for (int k = 0; k < numberOfTaps; k++) {
+        sum += samples[k] * filter[k];
+    }
+    return sum;
+#endif
+}
+
+static inline int16_t clampToInt16(float sample)
+{
+    float scaled = sample * 32768.0f;
+    if (scaled >= 32767.0f) {
+        return INT16_MAX;
+    }
+    if (scaled <= -32768.0f) {
+        return INT16_MIN;
+    }
+    return (int16_t)lrintf(scaled);
+}
+
+DHResampler *DHResamplerCreate(int inputSampleRate, int outputSampleRate, int numberOfChannels, DHResamplerQuality quality)
+{
+    if (inputSampleRate <= 0 || outputSampleRate <= 0 || numberOfChannels <= 0 || quality < DHResamplerQualityLow || quality > DHResamplerQualityHigh) {
+        return NULL;
+    }
+    int divisor = greatestCommonDivisor(inputSampleRate, outputSampleRate);
+    int upFactor = outputSampleRate / divisor;
+    int downFactor = inputSampleRate / divisor;
+    if (upFactor > MAXIMUM_NUMBER_OF_PHASES) {
+        return NULL;
+    }
+    DHResampler *resampler = calloc(1, sizeof(DHResampler));
+    if (resampler == NULL) {
+        return NULL;
+    }
+    const DHResamplerPreset *preset = &kPresets[quality];
+    double ratio = (double)upFactor / downFactor;
+    int numberOfTaps = preset->numberOfTaps;
+    if (ratio < 1.0) {
+        numberOfTaps = (int)ceil(numberOfTaps / ratio);
+        numberOfTaps = (numberOfTaps + 3) & ~3;
+    }
+    resampler->numberOfChannels = numberOfChannels;
+    resampler->upFactor = upFactor;
+    resampler->downFactor = downFactor;
+    resampler->numberOfTaps = numberOfTaps;
+    resampler->filterBank = malloc((size_t)upFactor * numberOfTaps * sizeof(float));
+    if (resampler->filterBank == NULL) {
+        DHResamplerDestroy(resampler);
+        return NULL;
+    }
+    buildFilterBank(resampler, 0.5 * (ratio < 1.0 ? ratio : 1.0) * preset->rolloff, preset->beta);
+    DHResamplerReset(resampler);
+    return resampler;
+}
+
+void DHResamplerDestroy(DHResampler *resampler)
+{
+    if (resampler == NULL) {
+        return;
+    }
+    free(resampler->filterBank);
+    free(resampler->history);
+    free(resampler);
+}
+
+void DHResamplerReset(DHResampler *resampler)
+{
+    //Half a filter of silence in front, so the first output lines up with the first input frame
+    size_t lead = (size_t)resampler->numberOfTaps / 2 - 1;
+    if (resampler->history) {
+        memset(resampler->history, 0, resampler->historyCapacity * resampler->numberOfChannels * sizeof(float));
+    }
+    resampler->historyLength = lead;
+    resampler->inputIndex = lead;
+    resampler->phase = 0;
+    resampler->numberOfInputFrames = 0;
+    resampler->numberOfOutputFrames = 0;
+}
+
+size_t DHResamplerMaximumOutputFrames(const DHResampler *resampler, size_t numberOfFrames)
+{
+    uint64_t available = resampler->historyLength + numberOfFrames + (size_t)resampler->numberOfTaps / 2;
+    return (size_t)(available * resampler->upFactor / resampler->downFactor) + 2;
+}
+
+static int reserveHistory(DHResampler *resampler, size_t numberOfFrames)
+{
+    size_t required = resampler->historyLength + numberOfFrames;
+    if (required <= resampler->historyCapacity) {
+        return 1;
+    }
+    size_t capacity = resampler->historyCapacity > 0 ? resampler->historyCapacity : 1024;
+    while (capacity < required) {
+        capacity *= 2;
+    }
+    float *history = calloc(capacity * resampler->numberOfChannels, sizeof(float));
+    if (history == NULL) {
+        return 0;
+    }
+    for (int channel = 0; channel < resampler->numberOfChannels; channel++) {
+        if (resampler->history) {
+            memcpy(history + channel * capacity, resampler->history + channel * resampler->historyCapacity, resampler->historyLength * sizeof(float));
+        }
+    }
+    free(resampler->history);
+    resampler->history = history;
+    resampler->historyCapacity = capacity;
+    return 1;
+}
+
+static size_t appendFrames(DHResampler *resampler, const void *input, int isFloat, size_t numberOfFrames)
+{
+    if (!reserveHistory(resampler, numberOfFrames)) {
+        return 0;
+    }
+    int channels = resampler->numberOfChannels;
+    for (int channel = 0; channel < channels; channel++) {
+        float *destination = resampler->history + channel * resampler->historyCapacity + resampler->historyLength;
+        if (input == NULL) {
+            memset(destination, 0, numberOfFrames * sizeof(float));
+        } else if (isFloat) {
+            const float *samples = input;
+            for (size_t i = 0; i < numberOfFrames; i++) {
+                destination[i] = samples[i * channels + channel];
+            }
+        } else {
+            const int16_t *samples = input;
+            for (size_t i = 0; i < numberOfFrames; i++) {
+                destination[i] = samples[i * channels + channel] * (1.0f / 32768.0f);
+            }
+        }
+    }
+    resampler->historyLength += numberOfFrames;
+    return numberOfFrames;
+}
+
+static size_t produceFrames(DHResampler *resampler, void *output, int isFloat, uint64_t limit)
+{
+    int channels = resampler->numberOfChannels;
+    int taps = resampler->numberOfTaps;
+    size_t halfTaps = (size_t)taps / 2;
+    size_t produced = 0;
+    while (resampler->inputIndex + halfTaps < resampler->historyLength && produced < limit) {
+        const float *filter = resampler->filterBank + (size_t)resampler->phase * taps;
+        size_t first = resampler->inputIndex + 1 - halfTaps;
+        for (int channel = 0; channel < channels; channel++) {
+            const float *samples = resampler->history + channel * resampler->historyCapacity + first;
+            float sample = dotProduct(samples, filter, taps);
+            if (isFloat) {
+                ((float *)output)[produced * channels + channel] = sample;
+            } else {
+                ((int16_t *)output)[produced * channels + channel] = clampToInt16(sample);
+            }
+        }
+        produced++;
+        resampler->phase += resampler->downFactor;
+        resampler->inputIndex += resampler->phase / resampler->upFactor;
+        resampler->phase %= resampler->upFactor;
+    }
+    
+    //Keep only the frames the next output still needs
+    size_t consumed = resampler->inputIndex + 1 - halfTaps;
+    if (consumed > resampler->historyLength) {
+        consumed = resampler->historyLength;
+    }
+    if (consumed > 0) {
+        for (int channel = 0; channel < channels; channel++) {
+            float *run = resampler->history + channel * resampler->historyCapacity;
+            memmove(run, run + consumed, (resampler->historyLength - consumed) * sizeof(float));
+        }
+        resampler->historyLength -= consumed;
+        resampler->inputIndex -= consumed;
+    }
+    resampler->numberOfOutputFrames += produced;
+    return produced;
+}
+
+static size_t process(DHResampler *resampler, const void *input, size_t numberOfFrames, void *output, int isFloat)
+{
+    if (numberOfFrames == 0 || appendFrames(resampler, input, isFloat, numberOfFrames) == 0) {
+        return 0;
+    }
+    resampler->numberOfInputFrames += numberOfFrames;
+    return produceFrames(resampler, output, isFloat, UINT64_MAX);
+}
+
+static size_t flush(DHResampler *resampler, void *output, int isFloat)
+{
+    uint64_t expected = (resampler->numberOfInputFrames * resampler->upFactor + resampler->downFactor - 1) / resampler->downFactor;
+    size_t produced = 0;
+    if (expected > resampler->numberOfOutputFrames && appendFrames(resampler, NULL, isFloat, (size_t)resampler->numberOfTaps / 2)) {
+        produced = produceFrames(resampler, output, isFloat, expected - resampler->numberOfOutputFrames);
+    }
+    DHResamplerReset(resampler);
+    return produced;
+}
+
+size_t DHResamplerProcess(DHResampler *resampler, const int16_t *input, size_t numberOfFrames, int16_t *output)
+{
+    return process(resampler, input, numberOfFrames, output, 0);
+}
+
+size_t DHResamplerFlush(DHResampler *resampler, int16_t *output)
+{
+    return flush(resampler, output, 0);
+}
+
+size_t DHResamplerProcessFloat32(DHResampler *resampler, const float *input, size_t numberOfFrames, float *output)
+{
+    return process(resampler, input, numberOfFrames, output, 1);
+}
+
+size_t DHResamplerFlushFloat32(DHResampler *resampler, float *output)
+{
+    return flush(resampler, output, 1);
+}
@@ -0,0 +1,65 @@
+//
+//  DHResampler.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHResampler_h
+#define DHResampler_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming polyphase windowed-sinc sample rate converter for 16-bit or 32-bit float interleaved PCM;
+ * The rate ratio is reduced to L/M; One Kaiser-windowed sinc filter per phase (L phases) is computed at creation, so each output sample is a single dot product, which runs on NEON or SSE when available;
+ * The input can be fed in chunks of any size, the filter history is carried across calls; It is not thread safe;
+ */
+typedef struct DHResampler DHResampler;
+
+typedef enum {
+    DHResamplerQualityLow,       //16 taps, for voice
+    DHResamplerQualityMedium,    //32 taps
+    DHResamplerQualityHigh,      //64 taps, for music
+} DHResamplerQuality;
+
+/**
+ * @return NULL if the rates are not positive, the channel count is not positive, the reduced ratio has more than 4096 phases, or the allocation fails
+ * @discussion When downsampling, the filters are stretched by the rate ratio so the transition band keeps its width relative to the output rate;
+ */
+DHResampler *DHResamplerCreate(int inputSampleRate, int outputSampleRate, int numberOfChannels, DHResamplerQuality quality);
+
+void DHResamplerDestroy(DHResampler *resampler);
+
+/**
+ * Upper bound of the frames `DHResamplerProcess` produces from `numberOfFrames` input frames; Size output buffers with it;
+ */
+size_t DHResamplerMaximumOutputFrames(const DHResampler *resampler, size_t numberOfFrames);
+
+/**
+ * Resample `numberOfFrames` frames; Output is delayed by half the filter length, `DHResamplerFlush` returns the tail;
+ * @param output at least `DHResamplerMaximumOutputFrames` frames
+ * @return number of frames written to `output`, 0 if the history could not grow
+ */
+size_t DHResamplerProcess(DHResampler *resampler, const int16_t *input, size_t numberOfFrames, int16_t *output);
+
+/**
+ * Output the frames held back by the filter delay, so the total output is exactly `input frames * outputSampleRate / inputSampleRate` rounded up; Then the resampler is reset;
+ * @param output at least `DHResamplerMaximumOutputFrames(resampler, 0)` frames
+ */
+size_t DHResamplerFlush(DHResampler *resampler, int16_t *output);
+
+/**
+ * The same as `DHResamplerProcess` and `DHResamplerFlush` for float samples, which are neither scaled nor clipped; Do not mix them with the 16-bit functions within a stream;
+ */
+size_t DHResamplerProcessFloat32(DHResampler *resampler, const float *input, size_t numberOfFrames, float *output);
+size_t DHResamplerFlushFloat32(DHResampler *resampler, float *output);
+
+/**
+ * Drop the history, to start a new stream;
+ */
+void DHResamplerReset(DHResampler *resampler);
+
+#endif /* DHResampler_h */
@@ -0,0 +1,652 @@
+//
+//  DHSampleFormatConversion.c
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#include <math.h>
+#include <pthread.h>
+
+#if defined(__aarch64__) || defined(__arm64__)
+#include <arm_neon.h>
+#define DH_SAMPLE_FORMAT_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DH_SAMPLE_FORMAT_SSE2 1
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#include <immintrin.h>
+#define DH_SAMPLE_FORMAT_AVX2 1
+#define DH_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "DHSampleFormatConversion.h"
+
+#define INT16_SCALE 32768.0f
+#define INT32_SCALE 2147483648.0f
+#define INT24_SCALE 8388608.0f
+#define INT32_LARGEST_FLOAT 2147483520.0f       //INT32_MAX is not a float, this is the float right below 2^31
+
+typedef struct {
+    void (*int16ToFloat32)(const int16_t *input, float *output, size_t count);
+    void (*float32ToInt16)(const float *input, int16_t *output, size_t count);
+    void (*int32ToFloat32)(const int32_t *input, float *output, size_t count);
+    void (*float32ToInt32)(const float *input, int32_t *output, size_t count);
+    void (*deinterleaveStereoFloat32)(const float *input, float *left, float *right, size_t numberOfFrames);
+    void (*interleaveStereoFloat32)(const float *left, const float *right, float *output, size_t numberOfFrames);
+    void (*stereoToMonoInt16)(const int16_t *input, int16_t *output, size_t numberOfFrames);
+    void (*stereoToMonoFloat32)(const float *input, float *output, size_t numberOfFrames);
+    void (*monoToStereoInt16)(const int16_t *input, int16_t *output, size_t numberOfFrames);
+    void (*monoToStereoFloat32)(const float *input, float *output, size_t numberOfFrames);
+} DHSampleFormatKernels;
+
+static inline float clamp(float value, float minimum, float maximum)
+{
+    return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+// Scalar
+
+static void scalarInt16ToFloat32(const int16_t *input, float *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        output[i] = input[i] * (1.0f / INT16_SCALE);
+    }
+}
+
+static void scalarFloat32ToInt16(const float *input, int16_t *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        output[i] = (int16_t)lrintf(clamp(input[i] * INT16_SCALE, -INT16_SCALE, INT16_SCALE - 1.0f));
+    }
+}
+
+static void scalarInt32ToFloat32(const int32_t *input, float *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        output[i] = (float)input[i] * (1.0f / INT32_SCALE);
+    }
+}
+
+static void scalarFloat32ToInt32(const float *input, int32_t *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        output[i] = (int32_t)lrintf(clamp(input[i] * INT32_SCALE, -INT32_SCALE, INT32_LARGEST_FLOAT));
+    }
+}
+
+static void scalarDeinterleaveStereoFloat32(const float *input, float *left, float *right, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        left[i] = input[2 * i];
+        right[i] = input[2 * i + 1];
+    }
+}
+
+static void scalarInterleaveStereoFloat32(const float *left, const float *right, float *output, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        output[2 * i] = left[i];
+        output[2 * i + 1] = right[i];
+    }
+}
+
+static void scalarStereoToMonoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        output[i] = (int16_t)((input[2 * i] + input[2 * i + 1]) >> 1);
+    }
+}
+
+static void scalarStereoToMonoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        output[i] = (input[2 * i] + input[2 * i + 1]) * 0.5f;
+    }
+}
+
+static void scalarMonoToStereoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        output[2 * i] = output[2 * i + 1] = input[i];
+    }
+}
+
+static void scalarMonoToStereoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    for (size_t i = 0; i < numberOfFrames; i++) {
+        output[2 * i] = output[2 * i + 1] = input[i];
+    }
+}
+
+static const DHSampleFormatKernels kScalarKernels = {
+    scalarInt16ToFloat32,
+    scalarFloat32ToInt16,
+    scalarInt32ToFloat32,
+    scalarFloat32ToInt32,
+    scalarDeinterleaveStereoFloat32,
+    scalarInterleaveStereoFloat32,
+    scalarStereoToMonoInt16,
+    scalarStereoToMonoFloat32,
+    scalarMonoToStereoInt16,
+    scalarMonoToStereoFloat32,
+};
+
+// NEON, 8 samples per iteration; The scalar kernels finish the tail
+
+#if DH_SAMPLE_FORMAT_NEON
+static void neonInt16ToFloat32(const int16_t *input, float *output, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(1.0f / INT16_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t samples = vld1q_s16(input + i);
+        vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), scale));
+        vst1q_f32(output + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), scale));
+    }
+    scalarInt16ToFloat32(input + i, output + i, count - i);
+}
+
+static void neonFloat32ToInt16(const float *input, int16_t *output, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(INT16_SCALE);
+    const float32x4_t minimum = vdupq_n_f32(-INT16_SCALE);
+    const float32x4_t maximum = vdupq_n_f32(INT16_SCALE - 1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t low = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i), scale), minimum), maximum);
+        float32x4_t high = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i + 4), scale), minimum), maximum);
+        vst1q_s16(output + i, vcombine_s16(vmovn_s32(vcvtnq_s32_f32(low)), vmovn_s32(vcvtnq_s32_f32(high))));
+    }
+    scalarFloat32ToInt16(input + i, output + i, count - i);
+}
+
+static void neonInt32ToFloat32(const int32_t *input, float *output, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(1.0f / INT32_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(input + i)), scale));
+    }
+    scalarInt32ToFloat32(input + i, output + i, count - i);
+}
+
+static void neonFloat32ToInt32(const float *input, int32_t *output, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(INT32_SCALE);
+    const float32x4_t minimum = vdupq_n_f32(-INT32_SCALE);
+    const float32x4_t maximum = vdupq_n_f32(INT32_LARGEST_FLOAT);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t samples = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i), scale), minimum), maximum);
+        vst1q_s32(output + i, vcvtnq_s32_f32(samples));
+    }
+    scalarFloat32ToInt32(input + i, output + i, count - i);
+}
+
+static void neonDeinterleaveStereoFloat32(const float *input, float *left, float *right, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        float32x4x2_t frames = vld2q_f32(input + 2 * i);
+        vst1q_f32(left + i, frames.val[0]);
+        vst1q_f32(right + i, frames.val[1]);
+    }
+    scalarDeinterleaveStereoFloat32(input + 2 * i, left + i, right + i, numberOfFrames - i);
+}
+
+static void neonInterleaveStereoFloat32(const float *left, const float *right, float *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        float32x4x2_t frames = {{vld1q_f32(left + i), vld1q_f32(right + i)}};
+        vst2q_f32(output + 2 * i, frames);
+    }
+    scalarInterleaveStereoFloat32(left + i, right + i, output + 2 * i, numberOfFrames - i);
+}
+
+static void neonStereoToMonoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 8 <= numberOfFrames; i += 8) {
+        int16x8x2_t frames = vld2q_s16(input + 2 * i);
+        vst1q_s16(output + i, vhaddq_s16(frames.val[0], frames.val[1]));
+    }
+    scalarStereoToMonoInt16(input + 2 * i, output + i, numberOfFrames - i);
+}
+
+static void neonStereoToMonoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        float32x4x2_t frames = vld2q_f32(input + 2 * i);
+        vst1q_f32(output + i, vmulq_f32(vaddq_f32(frames.val[0], frames.val[1]), half));
+    }
+    scalarStereoToMonoFloat32(input + 2 * i, output + i, numberOfFrames - i);
+}
+
+static void neonMonoToStereoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 8 <= numberOfFrames; i += 8) {
+        int16x8_t samples = vld1q_s16(input + i);
+        int16x8x2_t frames = {{samples, samples}};
+        vst2q_s16(output + 2 * i, frames);
+    }
+    scalarMonoToStereoInt16(input + i, output + 2 * i, numberOfFrames - i);
+}
+
+static void neonMonoToStereoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        float32x4_t samples = vld1q_f32(input + i);
+        float32x4x2_t frames = {{samples, samples}};
+        vst2q_f32(output + 2 * i, frames);
+    }
+    scalarMonoToStereoFloat32(input + i, output + 2 * i, numberOfFrames - i);
+}
+
+static const DHSampleFormatKernels kNEONKernels = {
+    neonInt16ToFloat32,
+    neonFloat32ToInt16,
+    neonInt32ToFloat32,
+    neonFloat32ToInt32,
+    neonDeinterleaveStereoFloat32,
+    neonInterleaveStereoFloat32,
+    neonStereoToMonoInt16,
+    neonStereoToMonoFloat32,
+    neonMonoToStereoInt16,
+    neonMonoToStereoFloat32,
+};
+#endif
+
+// SSE2, 8 samples per iteration; The scalar kernels finish the tail
+
+#if DH_SAMPLE_FORMAT_SSE2
+static void sse2Int16ToFloat32(const int16_t *input, float *output, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / INT16_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(input + i));
+        //Put every sample in the high half of a 32-bit lane, then shift it down with its sign
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+    scalarInt16ToFloat32(input + i, output + i, count - i);
+}
+
+static void sse2Float32ToInt16(const float *input, int16_t *output, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(INT16_SCALE);
+    const __m128 minimum = _mm_set1_ps(-INT16_SCALE);
+    const __m128 maximum = _mm_set1_ps(INT16_SCALE - 1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 low = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), minimum), maximum);
+        __m128 high = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), minimum), maximum);
+        __m128i samples = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128((__m128i *)(output + i), samples);
+    }
+    scalarFloat32ToInt16(input + i, output + i, count - i);
+}
+
+static void sse2Int32ToFloat32(const int32_t *input, float *output, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / INT32_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(input + i));
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+    scalarInt32ToFloat32(input + i, output + i, count - i);
+}
+
+static void sse2Float32ToInt32(const float *input, int32_t *output, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(INT32_SCALE);
+    const __m128 minimum = _mm_set1_ps(-INT32_SCALE);
+    const __m128 maximum = _mm_set1_ps(INT32_LARGEST_FLOAT);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 samples = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), minimum), maximum);
+        _mm_storeu_si128((__m128i *)(output + i), _mm_cvtps_epi32(samples));
+    }
+    scalarFloat32ToInt32(input + i, output + i, count - i);
+}
+
+static void sse2DeinterleaveStereoFloat32(const float *input, float *left, float *right, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        __m128 first = _mm_loadu_ps(input + 2 * i);
+        __m128 second = _mm_loadu_ps(input + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    scalarDeinterleaveStereoFloat32(input + 2 * i, left + i, right + i, numberOfFrames - i);
+}
+
+static void sse2InterleaveStereoFloat32(const float *left, const float *right, float *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(output + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(output + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    scalarInterleaveStereoFloat32(left + i, right + i, output + 2 * i, numberOfFrames - i);
+}
+
+static void sse2StereoToMonoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    size_t i = 0;
+    for (; i + 8 <= numberOfFrames; i += 8) {
+        //Multiply-add with 1 sums each left/right pair into a 32-bit lane
+        __m128i low = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(input + 2 * i)), ones);
+        __m128i high = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(input + 2 * i + 8)), ones);
+        __m128i samples = _mm_packs_epi32(_mm_srai_epi32(low, 1), _mm_srai_epi32(high, 1));
+        _mm_storeu_si128((__m128i *)(output + i), samples);
+    }
+    scalarStereoToMonoInt16(input + 2 * i, output + i, numberOfFrames - i);
+}
+
+static void sse2StereoToMonoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        __m128 first = _mm_loadu_ps(input + 2 * i);
+        __m128 second = _mm_loadu_ps(input + 2 * i + 4);
+        __m128 left = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+    scalarStereoToMonoFloat32(input + 2 * i, output + i, numberOfFrames - i);
+}
+
+static void sse2MonoToStereoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 8 <= numberOfFrames; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(input + i));
+        _mm_storeu_si128((__m128i *)(output + 2 * i), _mm_unpacklo_epi16(samples, samples));
+        _mm_storeu_si128((__m128i *)(output + 2 * i + 8), _mm_unpackhi_epi16(samples, samples));
+    }
+    scalarMonoToStereoInt16(input + i, output + 2 * i, numberOfFrames - i);
+}
+
+static void sse2MonoToStereoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    size_t i = 0;
+    for (; i + 4 <= numberOfFrames; i += 4) {
+        __m128 samples = _mm_loadu_ps(input + i);
+        _mm_storeu_ps(output + 2 * i, _mm_unpacklo_ps(samples, samples));
+        _mm_storeu_ps(output + 2 * i + 4, _mm_unpackhi_ps(samples, samples));
+    }
+    scalarMonoToStereoFloat32(input + i, output + 2 * i, numberOfFrames - i);
+}
+
+static const DHSampleFormatKernels kSSE2Kernels = {
+    sse2Int16ToFloat32,
+    sse2Float32ToInt16,
+    sse2Int32ToFloat32,
+    sse2Float32ToInt32,
+    sse2DeinterleaveStereoFloat32,
+    sse2InterleaveStereoFloat32,
+    sse2StereoToMonoInt16,
+    sse2StereoToMonoFloat32,
+    sse2MonoToStereoInt16,
+    sse2MonoToStereoFloat32,
+};
+#endif
+
+// AVX2, 16 samples per iteration for the integer <-> float conversions; The channel layout kernels are the SSE2 ones
+
+#if DH_SAMPLE_FORMAT_AVX2
+DH_AVX2 static void avx2Int16ToFloat32(const int16_t *input, float *output, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / INT16_SCALE);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i low = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(input + i)));
+        __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(input + i + 8)));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+        _mm256_storeu_ps(output + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+    }
+    sse2Int16ToFloat32(input + i, output + i, count - i);
+}
+
+DH_AVX2 static void avx2Float32ToInt16(const float *input, int16_t *output, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+    const __m256 minimum = _mm256_set1_ps(-INT16_SCALE);
+    const __m256 maximum = _mm256_set1_ps(INT16_SCALE - 1.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 low = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(input + i), scale), minimum), maximum);
+        __m256 high = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(input + i + 8), scale), minimum), maximum);
+        //The pack works per 128-bit lane, the permute puts the quarters back in order
+        __m256i samples = _mm256_packs_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+        _mm256_storeu_si256((__m256i *)(output + i), _mm256_permute4x64_epi64(samples, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    sse2Float32ToInt16(input + i, output + i, count - i);
+}
+
+DH_AVX2 static void avx2Int32ToFloat32(const int32_t *input, float *output, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / INT32_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i samples = _mm256_loadu_si256((const __m256i *)(input + i));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    sse2Int32ToFloat32(input + i, output + i, count - i);
+}
+
+DH_AVX2 static void avx2Float32ToInt32(const float *input, int32_t *output, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(INT32_SCALE);
+    const __m256 minimum = _mm256_set1_ps(-INT32_SCALE);
+    const __m256 maximum = _mm256_set1_ps(INT32_LARGEST_FLOAT);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 samples = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(input + i), scale), minimum), maximum);
+        _mm256_storeu_si256((__m256i *)(output + i), _mm256_cvtps_epi32(samples));
+    }
+    sse2Float32ToInt32(input + i, output + i, count - i);
+}
+
+static const DHSampleFormatKernels kAVX2Kernels = {
+    avx2Int16ToFloat32,
+    avx2Float32ToInt16,
+    avx2Int32ToFloat32,
+    avx2Float32ToInt32,
+    sse2DeinterleaveStereoFloat32,
+    sse2InterleaveStereoFloat32,
+    sse2StereoToMonoInt16,
+    sse2StereoToMonoFloat32,
+    sse2MonoToStereoInt16,
+    sse2MonoToStereoFloat32,
+};
+#endif
+
+// Dispatch
+
+static const DHSampleFormatKernels *activeKernels = &kScalarKernels;
+static DHSampleFormatImplementation activeImplementation = DHSampleFormatImplementationScalar;
+static pthread_once_t dispatchOnce = PTHREAD_ONCE_INIT;
+
+static const DHSampleFormatKernels *kernelsForImplementation(DHSampleFormatImplementation implementation)
+{
+    switch (implementation) {
+        case DHSampleFormatImplementationScalar:
+            return &kScalarKernels;
+#if DH_SAMPLE_FORMAT_NEON
+        case DHSampleFormatImplementationNEON:
+            return &kNEONKernels;
+#endif
+#if DH_SAMPLE_FORMAT_SSE2
+        case DHSampleFormatImplementationSSE2:
+            return &kSSE2Kernels;
+#endif
+#if DH_SAMPLE_FORMAT_AVX2
+        case DHSampleFormatImplementationAVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &kAVX2Kernels : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static void selectFastestImplementation(void)
+{
+    //arm64 always has NEON and x86-64 always has SSE2, only AVX2 has to be checked
+    const DHSampleFormatImplementation candidates[] = {
+        DHSampleFormatImplementationAVX2,
+        DHSampleFormatImplementationNEON,
+        DHSampleFormatImplementationSSE2,
+    };
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        const DHSampleFormatKernels *kernels = kernelsForImplementation(candidates[i]);
+        if (kernels != NULL) {
+            activeKernels = kernels;
+            activeImplementation = candidates[i];
+            return;
+        }
+    }
+}
+
+static inline const DHSampleFormatKernels *kernels(void)
+{
+    pthread_once(&dispatchOnce, selectFastestImplementation);
+    return activeKernels;
+}
+
+DHSampleFormatImplementation DHSampleFormatActiveImplementation(void)
+{
+    kernels();
+    return activeImplementation;
+}
+
+int DHSampleFormatSelectImplementation(DHSampleFormatImplementation implementation)
+{
+    kernels();
+    const DHSampleFormatKernels *selected = kernelsForImplementation(implementation);
+    if (selected == NULL) {
+        return 0;
+    }
+    activeKernels = selected;
+    activeImplementation = implementation;
+    return 1;
+}
+
+// Integer <-> Float
+
+void DHSampleFormatInt16ToFloat32(const int16_t *input, float *output, size_t count)
+{
+    kernels()->int16ToFloat32(input, output, count);
+}
+
+void DHSampleFormatFloat32ToInt16(const float *input, int16_t *output, size_t count)
+{
+    kernels()->float32ToInt16(input, output, count);
+}
+
+void DHSampleFormatInt32ToFloat32(const int32_t *input, float *output, size_t count)
+{
+    kernels()->int32ToFloat32(input, output, count);
+}
+
+void DHSampleFormatFloat32ToInt32(const float *input, int32_t *output, size_t count)
+{
+    kernels()->float32ToInt32(input, output, count);
+}
+
+//Packed 24-bit samples do not line up with vector lanes, the byte shuffling costs more than the conversion
+void DHSampleFormatInt24ToFloat32(const uint8_t *input, float *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++, input += 3) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        int32_t sample = (int32_t)((uint32_t)input[0] << 24 | (uint32_t)input[1] << 16 | (uint32_t)input[2] << 8) >> 8;
+#else
+        int32_t sample = (int32_t)((uint32_t)input[2] << 24 | (uint32_t)input[1] << 16 | (uint32_t)input[0] << 8) >> 8;
+#endif
+        output[i] = sample * (1.0f / INT24_SCALE);
+    }
+}
+
+void DHSampleFormatFloat32ToInt24(const float *input, uint8_t *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++, output += 3) {
+        int32_t sample = (int32_t)lrintf(clamp(input[i] * INT24_SCALE, -INT24_SCALE, INT24_SCALE - 1.0f));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        output[0] = (uint8_t)(sample >> 16);
+        output[1] = (uint8_t)(sample >> 8);
+        output[2] = (uint8_t)sample;
+#else
+        output[0] = (uint8_t)sample;
+        output[1] = (uint8_t)(sample >> 8);
+        output[2] = (uint8_t)(sample >> 16);
+#endif
+    }
+}
+
+// Channel Layout
+
+void DHSampleFormatDeinterleaveFloat32(const float *input, float *const *outputs, int numberOfChannels, size_t numberOfFrames)
+{
+    if (numberOfChannels == 2) {
+        kernels()->deinterleaveStereoFloat32(input, outputs[0], outputs[1], numberOfFrames);
+        return;
+    }
+    for (int channel = 0; channel < numberOfChannels; channel++) {
+        float *output = outputs[channel];
+        for (size_t i = 0; i < numberOfFrames; i++) {
+            output[i] = input[i * numberOfChannels + channel];
+        }
+    }
+}
+
+void DHSampleFormatInterleaveFloat32(const float *const *inputs, float *output, int numberOfChannels, size_t numberOfFrames)
+{
+    if (numberOfChannels == 2) {
+        kernels()->interleaveStereoFloat32(inputs[0], inputs[1], output, numberOfFrames);
+        return;
+    }
+    for (int channel = 0; channel < numberOfChannels; channel++) {
+        const float *input = inputs[channel];
+        for (size_t i = 0; i < numberOfFrames; i++) {
+            output[i * numberOfChannels + channel] = input[i];
+        }
+    }
+}
+
+void DHSampleFormatStereoToMonoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    kernels()->stereoToMonoInt16(input, output, numberOfFrames);
+}
+
+void DHSampleFormatStereoToMonoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    kernels()->stereoToMonoFloat32(input, output, numberOfFrames);
+}
+
+void DHSampleFormatMonoToStereoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames)
+{
+    kernels()->monoToStereoInt16(input, output, numberOfFrames);
+}
+
+void DHSampleFormatMonoToStereoFloat32(const float *input, float *output, size_t numberOfFrames)
+{
+    kernels()->monoToStereoFloat32(input, output, numberOfFrames);
+}
@@ -0,0 +1,72 @@
+//
+//  DHSampleFormatConversion.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHSampleFormatConversion_h
+#define DHSampleFormatConversion_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sample format kernels for Linear PCM: integer <-> float32, interleave/deinterleave and mono <-> stereo;
+ * Every kernel but the packed 24-bit ones has a scalar, a NEON (arm64), an SSE2 and, for the integer <-> float conversions, an AVX2 version; The fastest one the CPU supports is picked at the first call, the versions produce the same samples;
+ * Float samples are in [-1, 1); Conversions to integers round to nearest and saturate; Integers are native endian, 24-bit samples are 3 packed bytes;
+ * `count` is a number of samples, `numberOfFrames` a number of frames; Input and output must not overlap;
+ */
+
+typedef enum {
+    DHSampleFormatImplementationScalar,
+    DHSampleFormatImplementationNEON,
+    DHSampleFormatImplementationSSE2,
+    DHSampleFormatImplementationAVX2,
+} DHSampleFormatImplementation;
+
+/**
+ * The implementation the kernels run on;
+ */
+DHSampleFormatImplementation DHSampleFormatActiveImplementation(void);
+
+/**
+ * Force an implementation, e.g. to compare it with the scalar one; Not synchronized with kernels running on other threads;
+ * @return 0 if the CPU or the build does not support it, the active implementation is unchanged then
+ */
+int DHSampleFormatSelectImplementation(DHSampleFormatImplementation implementation);
+
+// Integer <-> Float
+
+void DHSampleFormatInt16ToFloat32(const int16_t *input, float *output, size_t count);
+void DHSampleFormatFloat32ToInt16(const float *input, int16_t *output, size_t count);
+
+void DHSampleFormatInt32ToFloat32(const int32_t *input, float *output, size_t count);
+void DHSampleFormatFloat32ToInt32(const float *input, int32_t *output, size_t count);
+
+void DHSampleFormatInt24ToFloat32(const uint8_t *input, float *output, size_t count);
+void DHSampleFormatFloat32ToInt24(const float *input, uint8_t *output, size_t count);
+
+// Channel Layout
+
+/**
+ * Split interleaved frames into one buffer per channel;
+ * @param outputs `numberOfChannels` buffers of `numberOfFrames` samples
+ */
+void DHSampleFormatDeinterleaveFloat32(const float *input, float *const *outputs, int numberOfChannels, size_t numberOfFrames);
+void DHSampleFormatInterleaveFloat32(const float *const *inputs, float *output, int numberOfChannels, size_t numberOfFrames);
+
+/**
+ * Average of the two channels; For 16 bit it is rounded down, like `(left + right) >> 1`;
+ */
+void DHSampleFormatStereoToMonoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames);
+void DHSampleFormatStereoToMonoFloat32(const float *input, float *output, size_t numberOfFrames);
+
+/**
+ * Copy the channel to both sides;
+ */
+void DHSampleFormatMonoToStereoInt16(const int16_t *input, int16_t *output, size_t numberOfFrames);
+void DHSampleFormatMonoToStereoFloat32(const float *input, float *output, size_t numberOfFrames);
+
+#endif /* DHSampleFormatConversion_h */
@@ -7,24 +7,18 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "DHAudioSampleRates.h"
 
 @interface DHAudioAttributes : NSObject
 
+/**
+ * The AAC sampling frequencies, in MPEG-4 sampling frequency index order, e.g. `DHAudioSampleRate44100`; Built from `DHAUDIO_SAMPLE_RATES`, which the ADTS tables share;
+ */
+#define DHAUDIO_SAMPLE_RATE_CASE(rate) DHAudioSampleRate##rate = rate,
 typedef NS_ENUM(NSInteger, DHAudioSampleRate) {
-    DHAudioSampleRate96000 = 96000,
-    DHAudioSampleRate88200 = 88200,
-    DHAudioSampleRate64000 = 64000,
-    DHAudioSampleRate48000 = 48000,
-    DHAudioSampleRate44100 = 44100,
-    DHAudioSampleRate32000 = 32000,
-    DHAudioSampleRate24000 = 24000,
-    DHAudioSampleRate22050 = 22050,
-    DHAudioSampleRate16000 = 16000,
-    DHAudioSampleRate12000 = 12000,
-    DHAudioSampleRate11025 = 11025,
-    DHAudioSampleRate8000 = 8000,
-    DHAudioSampleRate7350 = 7350
+    DHAUDIO_SAMPLE_RATES(DHAUDIO_SAMPLE_RATE_CASE)
 };
+#undef DHAUDIO_SAMPLE_RATE_CASE
 
 
 typedef NS_ENUM(NSInteger, DHAudioType) {
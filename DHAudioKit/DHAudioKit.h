@@ -27,14 +27,24 @@ FOUNDATION_EXPORT const unsigned char DHAudioKitVersionString[];
 //Converters
 #import "DHAudioConverter.h"
 #import "DHAACAudioConverter.h"
+#import "DHAACEncoderBackend.h"
+#import "DHAudioToolboxAACEncoderBackend.h"
+#import "DHFDKAACEncoderBackend.h"
+#import "DHFragmentedMP4Writer.h"
 #import "DHMP3AudioConverter.h"
+#import "DHMP3EncoderProfile.h"
 #import "DHOpusAudioConverter.h"
+#import "DHAudioResampler.h"
+#import "DHPCMFormatConverter.h"
 #import "DHAudioConverterFactory.h"
 
 //FilePlayers
 #import "DHAudioFilePlayer.h"
 #import "DHPCMAudioFilePlayer.h"
+#import "DHAACAudioFilePlayer.h"
 #import "DHOpusAudioFilePlayer.h"
+#import "DHQueueAudioFilePlayer.h"
+#import "DHDecodedAudioCache.h"
 #import "DHAudioFilePlayerFactory.h"
 
 //Views
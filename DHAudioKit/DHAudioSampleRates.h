@@ -0,0 +1,31 @@
+//
+//  DHAudioSampleRates.h
+//  DHAudio
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#ifndef DHAudioSampleRates_h
+#define DHAudioSampleRates_h
+
+/**
+ * The AAC sampling frequencies, in MPEG-4 sampling frequency index order; The one list both `DHAudioSampleRate` and the ADTS tables are built from;
+ * Plain C, so the C modules can use it; `X(rate)` is expanded once per rate;
+ */
+#define DHAUDIO_SAMPLE_RATES(X) \
+    X(96000) \
+    X(88200) \
+    X(64000) \
+    X(48000) \
+    X(44100) \
+    X(32000) \
+    X(24000) \
+    X(22050) \
+    X(16000) \
+    X(12000) \
+    X(11025) \
+    X(8000) \
+    X(7350)
+
+#endif /* DHAudioSampleRates_h */
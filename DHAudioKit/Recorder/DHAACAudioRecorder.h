@@ -10,4 +10,11 @@
 
 @interface DHAACAudioRecorder : DHAudioRecorder
 
+/**
+ * Path of an .m4a file the recording is also written to, as fragmented MP4; Default value is nil;
+ * The file is playable and seekable while recording goes on, see `DHAACAudioConverter outputFilePath`;
+ * Set it before recording starts;
+ */
+@property (nonatomic, copy) NSString *outputFilePath;
+
 @end
@@ -8,6 +8,7 @@
 
 #import "DHAACAudioRecorder.h"
 #import "DHAudioConverterFactory.h"
+#import "DHAACAudioConverter.h"
 
 @interface DHAACAudioRecorder()<DHAudioConverterDelegate>
 @property (nonatomic, strong) DHAudioConverter *converter;
@@ -39,6 +40,12 @@
     return self;
 }
 
+- (void) setOutputFilePath:(NSString *)outputFilePath
+{
+    _outputFilePath = [outputFilePath copy];
+    ((DHAACAudioConverter *)self.converter).outputFilePath = outputFilePath;
+}
+
 - (void) processPCMData:(NSData *)pcmData
         numberOfPackets:(int)numberOfPackets
 {
@@ -113,6 +113,7 @@ didChangeAudioSessionRoute:(NSDictionary *)userInfo;
         numberOfChannels = 1
         bitsPerChannel = 16
         flags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked
+ * Formats the AudioQueue does not record itself, like packed 24-bit or 32-bit integers, are recorded as float and converted, see `DHPCMFormatConverter`;
  */
 @property (nonatomic, readonly) AudioStreamBasicDescription audioFormat;
 
@@ -7,6 +7,7 @@
 //
 
 #import "DHAudioRecorder.h"
+#import "DHPCMFormatConverter.h"
 #import <AudioToolbox/AudioToolbox.h>
 #import <AVFoundation/AVFoundation.h>
 
@@ -49,7 +50,9 @@ void HandleInputBuffer(
 }
 
 - (AQRecorderState) aqData;
+- (NSData *) recordedDataWithCapturedData:(NSData *)data;
 @property (nonatomic) NSTimeInterval duration;
+@property (nonatomic, strong) DHPCMFormatConverter *captureConverter;      //nil when the AudioQueue records `audioFormat` itself
 @property (nonatomic) ALTYAudioRecorderStatus status;
 @end
 
@@ -85,7 +88,12 @@ void HandleInputBuffer(
         _packetDuration = packetDuration;
         _delegate = delegate;
         _delegateQueue = delegateQueue;
-        iAqData.mDataFormat = audioFormat;
+        AudioStreamBasicDescription captureFormat = [DHAudioRecorder captureFormatForFormat:audioFormat];
+        if ([DHPCMFormatConverter needsConversionFromFormat:captureFormat toFormat:audioFormat]) {
+            _captureConverter = [[DHPCMFormatConverter alloc] initWithInputFormat:captureFormat outputFormat:audioFormat];
+        }
+        //A format the kernels do not convert is handed to the AudioQueue as it is
+        iAqData.mDataFormat = _captureConverter ? captureFormat : audioFormat;
         _status = ALTYAudioRecorderStatusNotStarted;
     }
     return self;
@@ -252,6 +260,24 @@ void HandleInputBuffer(
     return numBytesForTime < maxBufferSize ? numBytesForTime : maxBufferSize;
 }
 
+//AudioQueue records 16-bit integer or 32-bit float samples; Other Linear PCM, e.g. packed 24-bit, is captured as float and converted with the shared kernels, see `DHPCMFormatConverter`
++ (AudioStreamBasicDescription) captureFormatForFormat:(AudioStreamBasicDescription)format
+{
+    if (format.mFormatID != kAudioFormatLinearPCM) {
+        return format;
+    }
+    if (!(format.mFormatFlags & kAudioFormatFlagIsFloat) && format.mBitsPerChannel <= 16) {
+        return [DHPCMFormatConverter signed16BitFormatWithSampleRate:format.mSampleRate numberOfChannels:format.mChannelsPerFrame];
+    }
+    return [DHPCMFormatConverter float32FormatWithSampleRate:format.mSampleRate numberOfChannels:format.mChannelsPerFrame];
+}
+
+//Called on the AudioQueue's thread
+- (NSData *) recordedDataWithCapturedData:(NSData *)data
+{
+    return self.captureConverter ? [self.captureConverter convertData:data] : data;
+}
+
 - (void) processPCMData:(NSData *)pcmData
         numberOfPackets:(int)numberOfPackets
 {
@@ -369,7 +395,7 @@ void HandleInputBuffer(
     if ([recorder.delegate respondsToSelector:@selector(audioRecorder:didRecordData:numberOfPackets:)]) {
         NSData *data = [NSData dataWithBytes:inBuffer->mAudioData
                                       length:inBuffer->mAudioDataByteSize];
-        [recorder processPCMData:data
+        [recorder processPCMData:[recorder recordedDataWithCapturedData:data]
                  numberOfPackets:inNumPackets];
     }
     if ([recorder aqData].mIsRunning == 0) {
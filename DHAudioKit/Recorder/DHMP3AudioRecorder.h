@@ -7,7 +7,21 @@
 //
 
 #import "DHAudioRecorder.h"
+#import "DHMP3EncoderProfile.h"
 
 @interface DHMP3AudioRecorder : DHAudioRecorder
 
+/**
+ * The LAME encoder settings used for the recording, e.g. `[DHMP3EncoderProfile voiceProfile]`;
+ * Default value is nil, which uses `[DHMP3EncoderProfile defaultProfile]`; Set it before recording starts;
+ */
+@property (nonatomic, copy) DHMP3EncoderProfile *encoderProfile;
+
+/**
+ * Path of a file the recorded MP3 stream is also written to; Default value is nil;
+ * When recording finishes, an Xing/LAME header with a seek table is written at the beginning of the file, so `DHAudioFilePlayer` can get the duration and seek without scanning it;
+ * Set it before recording starts;
+ */
+@property (nonatomic, copy) NSString *outputFilePath;
+
 @end
@@ -8,6 +8,7 @@
 
 #import "DHMP3AudioRecorder.h"
 #import "DHAudioConverterFactory.h"
+#import "DHMP3AudioConverter.h"
 
 @interface DHMP3AudioRecorder()<DHAudioConverterDelegate>
 @property (nonatomic, strong) DHAudioConverter *converter;
@@ -26,15 +27,13 @@
 - (DHAudioConverter *) converter
 {
     if (!_converter) {
-        AudioStreamBasicDescription destinationFormat = [DHAudioConverterFactory
-                                                         defaultDestinationFormatForAudioType:DHAudioTypeMP3
-                                                         sourceFormat:self.audioFormat];
-        _converter = [DHAudioConverterFactory audioConverterFromType:DHAudioTypeLinearPCM
-                                                          sourceFormat:self.audioFormat
-                                                                toType:DHAudioTypeMP3
-                                                     destinationFormat:destinationFormat
-                                                              delegate:self
-                                                         delegateQueue:self.delegateQueue];
+        _converter = [DHAudioConverterFactory mp3AudioConverterWithProfile:self.encoderProfile ?: [DHMP3EncoderProfile defaultProfile]
+                                                              sourceFormat:self.audioFormat
+                                                                  delegate:self
+                                                             delegateQueue:self.delegateQueue];
+        if (self.outputFilePath) {
+            ((DHMP3AudioConverter *)_converter).outputFilePath = self.outputFilePath;
+        }
     }
     return _converter;
 }
@@ -0,0 +1,199 @@
+//
+//  DHAACAudioConverterTests.m
+//  DHAudioKitTests
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "DHAACAudioConverter.h"
+
+static const UInt32 kStubPacketSize = 8;
+static const UInt32 kStubMaximumPacketSize = 16;
+static const UInt32 kFramesPerPacket = 1024;
+static const UInt32 kStubEncoderDelay = 2112;
+static const NSUInteger kADTSHeaderLength = 7;
+static const NSTimeInterval kConversionTimeout = 2;
+
+/**
+ * Writes one packet of `kStubPacketSize` bytes for every call and holds nothing back, so the packets the converter gets are known;
+ */
+@interface DHStubAACEncoderBackend : NSObject<DHAACEncoderBackend>
+@end
+
+@implementation DHStubAACEncoderBackend
+
+@synthesize bitRate;
+
+- (UInt32) maximumOutputPacketSize
+{
+    return kStubMaximumPacketSize;
+}
+
+- (UInt32) encoderDelay
+{
+    return kStubEncoderDelay;
+}
+
+- (OSStatus) encodeFrames:(const void *)frames
+           numberOfFrames:(UInt32)numberOfFrames
+             outputBuffer:(uint8_t *)outputBuffer
+         outputBufferSize:(UInt32)outputBufferSize
+       packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+          numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    if (*ioNumberOfPackets == 0 || outputBufferSize < kStubPacketSize) {
+        return kAudio_ParamError;
+    }
+    memset(outputBuffer, 0xAA, kStubPacketSize);
+    packetDescriptions[0].mStartOffset = 0;
+    packetDescriptions[0].mDataByteSize = kStubPacketSize;
+    packetDescriptions[0].mVariableFramesInPacket = 0;
+    *ioNumberOfPackets = 1;
+    return noErr;
+}
+
+- (OSStatus) drainToOutputBuffer:(uint8_t *)outputBuffer
+                outputBufferSize:(UInt32)outputBufferSize
+              packetDescriptions:(AudioStreamPacketDescription *)packetDescriptions
+                 numberOfPackets:(UInt32 *)ioNumberOfPackets
+{
+    *ioNumberOfPackets = 0;
+    return noErr;
+}
+
+- (void) reset
+{
+
+}
+
+@end
+
+@interface DHAACAudioConverterTests : XCTestCase<DHAudioConverterDelegate>
+@property (nonatomic, strong) DHAACAudioConverter *converter;
+@property (nonatomic, strong) dispatch_queue_t delegateQueue;
+@property (nonatomic, strong) XCTestExpectation *conversionExpectation;
+@property (nonatomic, strong) XCTestExpectation *stopExpectation;
+@property (nonatomic, strong) NSData *convertedData;
+@property (nonatomic) NSUInteger numberOfBufferAllocations;
+@property (nonatomic) NSUInteger allocatedBufferSize;
+@end
+
+@implementation DHAACAudioConverterTests
+
+- (void) setUp
+{
+    [super setUp];
+    AudioStreamBasicDescription inFormat = {0};
+    inFormat.mSampleRate = 44100;
+    inFormat.mFormatID = kAudioFormatLinearPCM;
+    inFormat.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+    inFormat.mChannelsPerFrame = 1;
+    inFormat.mBitsPerChannel = 16;
+    inFormat.mBytesPerFrame = 2;
+    inFormat.mFramesPerPacket = 1;
+    inFormat.mBytesPerPacket = 2;
+
+    AudioStreamBasicDescription outFormat = {0};
+    outFormat.mSampleRate = 44100;
+    outFormat.mFormatID = kAudioFormatMPEG4AAC;
+    outFormat.mChannelsPerFrame = 1;
+    outFormat.mFramesPerPacket = kFramesPerPacket;
+
+    //The delegate queue is a weak property of the converter
+    self.delegateQueue = dispatch_queue_create("DHAACAudioConverterTests Delegate Queue", NULL);
+    self.converter = [[DHAACAudioConverter alloc] initWithInputAudioFormat:inFormat
+                                                         outputAudioFormat:outFormat
+                                                                   backend:[[DHStubAACEncoderBackend alloc] init]
+                                                                  delegate:self
+                                                             delegateQueue:self.delegateQueue];
+    XCTAssertNotNil(self.converter);
+}
+
+- (void) tearDown
+{
+    self.converter = nil;
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+/**
+ * Convert whole AAC packets of silence and wait for the converted data;
+ */
+- (NSData *) convertPackets:(UInt32)numberOfPackets
+{
+    self.conversionExpectation = [self expectationWithDescription:@"Conversion"];
+    NSMutableData *data = [NSMutableData dataWithLength:numberOfPackets * kFramesPerPacket * self.converter.inFormat.mBytesPerFrame];
+    [self.converter convertData:data numberOfPackets:numberOfPackets * kFramesPerPacket];
+    [self waitForExpectationsWithTimeout:kConversionTimeout handler:nil];
+    return self.convertedData;
+}
+
+- (NSUInteger) bufferSizeForPacketCount:(NSUInteger)packetCount
+{
+    return packetCount * (kStubMaximumPacketSize + sizeof(AudioStreamPacketDescription));
+}
+
+#pragma mark - Tests
+- (void) testBuffersAreReusedForCallsOfTheSameSize
+{
+    for (int i = 0; i < 4; i++) {
+        NSData *data = [self convertPackets:2];
+        XCTAssertEqual([data length], 2 * (kADTSHeaderLength + kStubPacketSize));
+        XCTAssertEqual(self.numberOfBufferAllocations, (NSUInteger)1);
+    }
+    //Two packets of input and the 3 packets of the encoder's delay
+    XCTAssertEqual(self.allocatedBufferSize, [self bufferSizeForPacketCount:2 + 3]);
+}
+
+- (void) testBuffersOnlyGrowForLargerCalls
+{
+    [self convertPackets:2];
+    XCTAssertEqual(self.numberOfBufferAllocations, (NSUInteger)1);
+
+    [self convertPackets:4];
+    XCTAssertEqual(self.numberOfBufferAllocations, (NSUInteger)2);
+    XCTAssertEqual(self.allocatedBufferSize, [self bufferSizeForPacketCount:4 + 3]);
+
+    //Smaller calls fit in the grown buffers
+    [self convertPackets:1];
+    [self convertPackets:4];
+    XCTAssertEqual(self.numberOfBufferAllocations, (NSUInteger)2);
+}
+
+- (void) testBuffersAreReleasedAfterStopping
+{
+    [self convertPackets:2];
+    XCTAssertGreaterThan(self.allocatedBufferSize, (NSUInteger)0);
+
+    self.stopExpectation = [self expectationWithDescription:@"Stop"];
+    [self.converter stopConversion];
+    [self waitForExpectationsWithTimeout:kConversionTimeout handler:nil];
+
+    //The buffers are released on the encode queue after the delegate has been notified
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"allocatedBufferSize == 0"] evaluatedWithObject:self.converter handler:nil];
+    [self waitForExpectationsWithTimeout:kConversionTimeout handler:nil];
+}
+
+#pragma mark - DHAudioConverterDelegate
+- (void) audioConverter:(DHAudioConverter *)converter didFinishConversionWithData:(NSData *)data
+{
+    //The counters are read here, after the encode queue has written them and before the next call
+    self.convertedData = data;
+    self.numberOfBufferAllocations = self.converter.numberOfBufferAllocations;
+    self.allocatedBufferSize = self.converter.allocatedBufferSize;
+    [self.conversionExpectation fulfill];
+}
+
+- (void) audioConverter:(DHAudioConverter *)converter didFailToConvertWithError:(NSError *)error
+{
+    XCTFail(@"%@", error);
+}
+
+- (void) audioConverterDidStopConversion:(DHAudioConverter *)converter
+{
+    [self.stopExpectation fulfill];
+}
+
+@end
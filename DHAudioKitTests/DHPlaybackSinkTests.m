@@ -0,0 +1,122 @@
+//
+//  DHPlaybackSinkTests.m
+//  DHAudioKitTests
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "DHPlaybackSink.h"
+
+static const size_t kNumberOfFrames = 10000;
+static const size_t kFramesPerBuffer = 512;
+static const size_t kBytesPerFrame = 4;
+static const DHPlaybackSinkFormat kSinkFormat = {44100, 2, 16, 0};
+static const NSUInteger kWAVHeaderLength = 44;
+static const NSTimeInterval kRenderTimeout = 2;
+
+@interface DHPlaybackSinkTests : XCTestCase {
+    DHPlaybackEngine engine;
+    DHPlaybackSink sink;
+}
+@property (nonatomic, strong) NSData *pcmData;
+@property (nonatomic, strong) NSString *filePath;
+@end
+
+@implementation DHPlaybackSinkTests
+
+- (void) setUp
+{
+    [super setUp];
+    //Every sample differs from its neighbours, so a dropped or repeated frame shows
+    NSMutableData *pcmData = [NSMutableData dataWithLength:kNumberOfFrames * kBytesPerFrame];
+    int16_t *samples = [pcmData mutableBytes];
+    for (size_t i = 0; i < kNumberOfFrames * 2; i++) {
+        samples[i] = (int16_t)(i * 7919);
+    }
+    self.pcmData = pcmData;
+    self.filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"sink_%@.wav", [[NSUUID UUID] UUIDString]]];
+
+    //The whole stream fits in the ring, so the producer is done before rendering starts
+    XCTAssertTrue(DHPlaybackEngineInit(&engine, kBytesPerFrame, kNumberOfFrames, 0));
+    XCTAssertEqual(DHPlaybackEngineWrite(&engine, [pcmData bytes], kNumberOfFrames), kNumberOfFrames);
+    DHPlaybackEngineFinish(&engine);
+}
+
+- (void) tearDown
+{
+    DHPlaybackEngineDestroy(&engine);
+    [[NSFileManager defaultManager] removeItemAtPath:self.filePath error:nil];
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+- (uint32_t) uint32AtOffset:(NSUInteger)offset ofData:(NSData *)data
+{
+    const uint8_t *bytes = (const uint8_t *)[data bytes] + offset;
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+- (uint16_t) uint16AtOffset:(NSUInteger)offset ofData:(NSData *)data
+{
+    const uint8_t *bytes = (const uint8_t *)[data bytes] + offset;
+    return bytes[0] | bytes[1] << 8;
+}
+
+#pragma mark - Tests
+- (void) testFileSinkWritesTheStreamBitIdentically
+{
+    XCTAssertTrue(DHPlaybackSinkOpen(&sink, &engine, kSinkFormat, kFramesPerBuffer, [self.filePath fileSystemRepresentation]));
+    size_t numberOfFramesRendered = 0;
+    size_t numberOfFrames;
+    while ((numberOfFrames = DHPlaybackSinkRenderBuffer(&sink)) > 0) {
+        numberOfFramesRendered += numberOfFrames;
+    }
+    XCTAssertEqual(numberOfFramesRendered, kNumberOfFrames);
+    XCTAssertTrue(DHPlaybackSinkIsFinished(&sink));
+
+    //The clock of the sink is where the engine is, the last frame written is the end of the stream
+    uint64_t currentFrame = 0;
+    XCTAssertTrue(DHPlaybackSinkGetCurrentFrame(&sink, &currentFrame));
+    XCTAssertEqual(currentFrame, (uint64_t)numberOfFramesRendered);
+    XCTAssertEqual(DHPlaybackEngineRenderPosition(&engine), (uint64_t)numberOfFramesRendered);
+    DHPlaybackSinkClose(&sink);
+
+    NSData *file = [NSData dataWithContentsOfFile:self.filePath];
+    XCTAssertEqual([file length], kWAVHeaderLength + [self.pcmData length]);
+    XCTAssertEqualObjects([file subdataWithRange:NSMakeRange(0, 4)], [@"RIFF" dataUsingEncoding:NSASCIIStringEncoding]);
+    XCTAssertEqual([self uint32AtOffset:4 ofData:file], (uint32_t)([file length] - 8));
+    XCTAssertEqualObjects([file subdataWithRange:NSMakeRange(8, 8)], [@"WAVEfmt " dataUsingEncoding:NSASCIIStringEncoding]);
+    XCTAssertEqual([self uint32AtOffset:16 ofData:file], (uint32_t)16);
+    XCTAssertEqual([self uint16AtOffset:20 ofData:file], (uint16_t)1);        //integer PCM
+    XCTAssertEqual([self uint16AtOffset:22 ofData:file], (uint16_t)kSinkFormat.numberOfChannels);
+    XCTAssertEqual([self uint32AtOffset:24 ofData:file], (uint32_t)kSinkFormat.sampleRate);
+    XCTAssertEqual([self uint32AtOffset:28 ofData:file], (uint32_t)(kSinkFormat.sampleRate * kBytesPerFrame));
+    XCTAssertEqual([self uint16AtOffset:32 ofData:file], (uint16_t)kBytesPerFrame);
+    XCTAssertEqual([self uint16AtOffset:34 ofData:file], (uint16_t)kSinkFormat.bitsPerChannel);
+    XCTAssertEqualObjects([file subdataWithRange:NSMakeRange(36, 4)], [@"data" dataUsingEncoding:NSASCIIStringEncoding]);
+    XCTAssertEqual([self uint32AtOffset:40 ofData:file], (uint32_t)[self.pcmData length]);
+    XCTAssertEqualObjects([file subdataWithRange:NSMakeRange(kWAVHeaderLength, [file length] - kWAVHeaderLength)], self.pcmData);
+}
+
+- (void) testNullSinkRendersOnItsThread
+{
+    XCTAssertTrue(DHPlaybackSinkOpen(&sink, &engine, kSinkFormat, kFramesPerBuffer, NULL));
+    XCTAssertTrue(DHPlaybackSinkStart(&sink, 0));
+    //The sink is an ivar, so the render thread and this loop look at the same one
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:kRenderTimeout];
+    while (!DHPlaybackSinkIsFinished(&sink) && [timeout timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertTrue(DHPlaybackSinkIsFinished(&sink));
+    DHPlaybackSinkStop(&sink);
+
+    uint64_t currentFrame = 0;
+    XCTAssertTrue(DHPlaybackSinkGetCurrentFrame(&sink, &currentFrame));
+    XCTAssertEqual(currentFrame, (uint64_t)kNumberOfFrames);
+    XCTAssertEqual(DHPlaybackEngineRenderPosition(&engine), (uint64_t)kNumberOfFrames);
+    DHPlaybackSinkClose(&sink);
+}
+
+@end
@@ -0,0 +1,142 @@
+//
+//  DHTimeStretchTests.m
+//  DHAudioKitTests
+//
+//  Created by Huang Hongsen on 17/6/6.
+//  Copyright © 2017年 Huang Hongsen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "DHTimeStretch.h"
+
+static const double kSampleRate = 48000;
+static const double kToneFrequency = 440;
+static const NSUInteger kNumberOfInputFrames = 48000 * 4;
+
+@interface DHTimeStretchTests : XCTestCase
+@end
+
+@implementation DHTimeStretchTests
+
+#pragma mark - Helpers
+- (NSData *) toneWithNumberOfFrames:(NSUInteger)numberOfFrames numberOfChannels:(int)numberOfChannels
+{
+    NSMutableData *data = [NSMutableData dataWithLength:numberOfFrames * numberOfChannels * sizeof(float)];
+    float *samples = [data mutableBytes];
+    for (NSUInteger i = 0; i < numberOfFrames; i++) {
+        for (int channel = 0; channel < numberOfChannels; channel++) {
+            samples[i * numberOfChannels + channel] = 0.5f * sinf((float)(2 * M_PI * kToneFrequency * i / kSampleRate));
+        }
+    }
+    return data;
+}
+
+/**
+ * Run the float input through a time stretch at `rate` the way the playback engine does: write what is needed, process, read out, and drain at the end;
+ */
+- (NSData *) stretchedDataWithData:(NSData *)data numberOfChannels:(int)numberOfChannels rate:(float)rate
+{
+    DHTimeStretch stretch;
+    if (!DHTimeStretchInit(&stretch, numberOfChannels, 1, kSampleRate)) {
+        return nil;
+    }
+    size_t bytesPerFrame = numberOfChannels * sizeof(float);
+    size_t numberOfFrames = [data length] / bytesPerFrame;
+    NSMutableData *output = [NSMutableData dataWithLength:(NSUInteger)(numberOfFrames / DHTIMESTRETCH_MINIMUM_RATE + kSampleRate) * bytesPerFrame];
+    size_t capacity = [output length] / bytesPerFrame;
+    const uint8_t *input = [data bytes];
+    uint8_t *bytes = [output mutableBytes];
+    size_t position = 0;
+    size_t numberOfOutputFrames = 0;
+    while (position < numberOfFrames) {
+        size_t needed = DHTimeStretchNumberOfFramesNeeded(&stretch);
+        size_t written = DHTimeStretchWrite(&stretch, input + position * bytesPerFrame, MIN(needed, numberOfFrames - position));
+        position += written;
+        if (written < needed) {
+            break;
+        }
+        DHTimeStretchProcess(&stretch, rate);
+        numberOfOutputFrames += DHTimeStretchRead(&stretch, bytes + numberOfOutputFrames * bytesPerFrame, capacity - numberOfOutputFrames);
+    }
+    DHTimeStretchDrain(&stretch);
+    numberOfOutputFrames += DHTimeStretchRead(&stretch, bytes + numberOfOutputFrames * bytesPerFrame, capacity - numberOfOutputFrames);
+    DHTimeStretchDestroy(&stretch);
+    [output setLength:numberOfOutputFrames * bytesPerFrame];
+    return output;
+}
+
+//From the upward zero crossings of the middle half, away from the start and the drained end
+- (double) frequencyOfMonoData:(NSData *)data
+{
+    const float *samples = [data bytes];
+    NSUInteger numberOfFrames = [data length] / sizeof(float);
+    NSUInteger first = numberOfFrames / 4;
+    NSUInteger last = numberOfFrames * 3 / 4;
+    NSUInteger numberOfCrossings = 0;
+    for (NSUInteger i = first + 1; i < last; i++) {
+        if (samples[i - 1] < 0 && samples[i] >= 0) {
+            numberOfCrossings++;
+        }
+    }
+    return numberOfCrossings * kSampleRate / (last - first);
+}
+
+#pragma mark - Tests
+- (void) testOutputLengthFollowsRate
+{
+    NSData *tone = [self toneWithNumberOfFrames:kNumberOfInputFrames numberOfChannels:1];
+    //The drain plays the last window or so at the normal speed
+    double tolerance = 2 * DHTIMESTRETCH_WINDOW_DURATION * kSampleRate;
+    for (float rate = DHTIMESTRETCH_MINIMUM_RATE; rate <= DHTIMESTRETCH_MAXIMUM_RATE; rate += 0.25f) {
+        NSData *output = [self stretchedDataWithData:tone numberOfChannels:1 rate:rate];
+        XCTAssertNotNil(output);
+        double numberOfOutputFrames = [output length] / sizeof(float);
+        XCTAssertEqualWithAccuracy(numberOfOutputFrames, kNumberOfInputFrames / rate, tolerance, @"rate %.2f", rate);
+    }
+}
+
+- (void) testPitchIsKept
+{
+    NSData *tone = [self toneWithNumberOfFrames:kNumberOfInputFrames numberOfChannels:1];
+    for (float rate = DHTIMESTRETCH_MINIMUM_RATE; rate <= DHTIMESTRETCH_MAXIMUM_RATE; rate += 0.25f) {
+        NSData *output = [self stretchedDataWithData:tone numberOfChannels:1 rate:rate];
+        XCTAssertEqualWithAccuracy([self frequencyOfMonoData:output], kToneFrequency, kToneFrequency * 0.01, @"rate %.2f", rate);
+    }
+}
+
+- (void) testPositionReachesTheEndOfTheInput
+{
+    DHTimeStretch stretch;
+    XCTAssertTrue(DHTimeStretchInit(&stretch, 1, 1, kSampleRate));
+    NSData *tone = [self toneWithNumberOfFrames:kNumberOfInputFrames numberOfChannels:1];
+    const float *input = [tone bytes];
+    float output[4096];
+    size_t position = 0;
+    while (position < kNumberOfInputFrames) {
+        size_t needed = DHTimeStretchNumberOfFramesNeeded(&stretch);
+        size_t written = DHTimeStretchWrite(&stretch, input + position, MIN(needed, kNumberOfInputFrames - position));
+        position += written;
+        if (written < needed) {
+            break;
+        }
+        DHTimeStretchProcess(&stretch, 2);
+        while (DHTimeStretchRead(&stretch, output, 4096) > 0) {
+        }
+    }
+    DHTimeStretchDrain(&stretch);
+    while (DHTimeStretchRead(&stretch, output, 4096) > 0) {
+    }
+    XCTAssertEqualWithAccuracy(DHTimeStretchPosition(&stretch), (double)kNumberOfInputFrames, 1);
+    DHTimeStretchDestroy(&stretch);
+}
+
+//48 kHz stereo float, the heaviest format the players render, 4 s at 1.5x; The request's Linux figure was 0.3% of real time
+- (void) testPerformanceOfStereoFloat
+{
+    NSData *tone = [self toneWithNumberOfFrames:kNumberOfInputFrames numberOfChannels:2];
+    [self measureBlock:^{
+        [self stretchedDataWithData:tone numberOfChannels:2 rate:1.5f];
+    }];
+}
+
+@end